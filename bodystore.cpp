@@ -0,0 +1,101 @@
+#include "bodystore.h"
+#include "threadpool.h"
+#include <cfloat>
+
+int BodyStore::addBody(const string& name, const OrbitalElements& el, double rad, double renderRad, const color4& color, int parent,
+                       double rot) {
+    names.push_back(name);
+    parents.push_back(parent);
+    elements.push_back(el);
+    radius.push_back(rad);
+    renderRadius.push_back(renderRad);
+    colors.push_back(color);
+    rotSpeed.push_back(rot);
+    flags.push_back(0);
+    posX.push_back(0.0);  posY.push_back(0.0);  posZ.push_back(0.0);
+    relPos.push_back(vec3(0.0));
+    models.push_back(mat4());
+    return (int) names.size() - 1;
+}
+
+void BodyStore::reserve(size_t n) {
+    names.reserve(n);  parents.reserve(n);  elements.reserve(n);
+    radius.reserve(n);  renderRadius.reserve(n);  colors.reserve(n);  rotSpeed.reserve(n);  flags.reserve(n);
+    posX.reserve(n);  posY.reserve(n);  posZ.reserve(n);
+    relPos.reserve(n);  models.reserve(n);
+}
+
+size_t BodyStore::grow(size_t count, unsigned char f) {
+    size_t first = names.size(), n = first + count;
+    names.resize(n);  parents.resize(n, -1);  elements.resize(n);
+    radius.resize(n, 0.0);  renderRadius.resize(n, 0.0);  colors.resize(n, color4(1.0));  rotSpeed.resize(n, 0.0);  flags.resize(n, f);
+    posX.resize(n, 0.0);  posY.resize(n, 0.0);  posZ.resize(n, 0.0);
+    relPos.resize(n, vec3(0.0));  models.resize(n);
+    return first;
+}
+
+void BodyStore::truncate(size_t n) {
+    if(n >= names.size()) return;
+    names.resize(n);  parents.resize(n);  elements.resize(n);
+    radius.resize(n);  renderRadius.resize(n);  colors.resize(n);  rotSpeed.resize(n);  flags.resize(n);
+    posX.resize(n);  posY.resize(n);  posZ.resize(n);
+    relPos.resize(n);  models.resize(n);
+}
+
+int BodyStore::findBody(const string& name) const {
+    for(int i = 0; i < names.size(); i++) { if(names[i] == name) return i; }
+    return -1;
+}
+
+void BodyStore::updateRange(double t, size_t begin, size_t end, unsigned char mask, unsigned char match) {
+    for(size_t i = begin; i < end; i++) {
+        if((flags[i] & mask) != match) continue;
+        dvec3 p = keplerPosition(elements[i], t);  //Ecliptic (z = north); swap into scene axes (y = north)
+        double x = p.x, y = p.z, z = -p.y;
+        int parent = parents[i];
+        if(parent >= 0) { x += posX[parent];  y += posY[parent];  z += posZ[parent]; }
+        posX[i] = x;  posY[i] = y;  posZ[i] = z;
+    }
+}
+
+void BodyStore::updatePositions(double t, ThreadPool* pool) {
+    if(pool == NULL) {
+        updateRange(t, 0, names.size(), 0, 0);
+        return;
+    }
+    //Sphere bodies first, in order, so every parent is placed before its children; point bodies never have children,
+    //so they can then be split across the pool in any order
+    updateRange(t, 0, names.size(), BODY_POINT, 0);
+    pool->parallelFor(names.size(), [this, t](size_t begin, size_t end) { updateRange(t, begin, end, BODY_POINT, BODY_POINT); });
+}
+
+void BodyStore::cameraRelative(const dvec3& eye) {
+    double nearest = DBL_MAX, farthest = 0;
+    size_t n = names.size();
+    sphereIds.clear();  sphereX.clear();  sphereY.clear();  sphereZ.clear();  sphereR.clear();
+    pointBegin = pointEnd = 0;
+    for(size_t i = 0; i < n; i++) {
+        double dx = posX[i] - eye.x, dy = posY[i] - eye.y, dz = posZ[i] - eye.z;  //Subtract in double, then narrow
+        double r = renderRadius[i];
+        double dist = sqrt(dx*dx + dy*dy + dz*dz);
+        if(dist + r > farthest) farthest = dist + r;
+
+        vec3 rel((GLfloat) dx, (GLfloat) dy, (GLfloat) dz);
+        relPos[i] = rel;
+        if(flags[i] & BODY_POINT) {
+            if(pointEnd == 0) pointBegin = i;
+            pointEnd = i + 1;
+            continue;
+        }
+        if(dist - r < nearest) nearest = dist - r;
+        GLfloat s = (GLfloat) r;
+        sphereIds.push_back((int) i);
+        sphereX.push_back(rel.x);  sphereY.push_back(rel.y);  sphereZ.push_back(rel.z);  sphereR.push_back(s);
+        models[i] = mat4(s, 0, 0, 0,
+                         0, s, 0, 0,
+                         0, 0, s, 0,
+                         rel.x, rel.y, rel.z, 1);  //Translate(rel) * Scale(s), given in column order
+    }
+    nearestSurface = nearest;
+    farthestPoint = farthest;
+}
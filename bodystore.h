@@ -0,0 +1,71 @@
+#ifndef __BODYSTORE_H__
+#define __BODYSTORE_H__
+
+#include "Angel-yjc.h"
+#include "kepler.h"
+#include <string>
+#include <vector>
+
+typedef Angel::vec4     color4;
+
+using namespace std;
+
+class ThreadPool;
+
+enum BodyFlags {
+    BODY_POINT = 1  //Drawn as a single point instead of a sphere (minor planets); never the parent of another body
+};
+
+/***
+ Structure-of-arrays table of every body in the scene (the Sun, planets and moons)
+    - World positions are kept in double precision (AU) so real distances don't lose precision
+    - Positions use the scene's axes: x and z span the ecliptic, y points toward ecliptic north
+    - cameraRelative() subtracts the (double) camera position from every body in one pass and only then converts to
+      float, so the model matrices sent to the shaders never contain large translations
+    - A body's parent must be added before the body itself
+    - Bulk loaders grow() the store once and then fill the new slice of every array directly, possibly from several threads
+ ***/
+class BodyStore {
+public:
+    BodyStore() : nearestSurface(0), farthestPoint(0), pointBegin(0), pointEnd(0) {}
+
+    //Radii are in AU; parent < 0 means the body is fixed at the origin (the Sun)
+    int addBody(const string& name, const OrbitalElements& el, double radius, double renderRadius, const color4& color, int parent,
+                double rotSpeed = 0);
+    void reserve(size_t n);
+    size_t grow(size_t count, unsigned char flags = 0);  //Appends count default bodies; returns the index of the first
+    void truncate(size_t n);  //Drops every body from index n on
+
+    size_t size() const { return names.size(); }
+
+    int findBody(const string& name) const;
+
+    dvec3 position(int i) const { return dvec3(posX[i], posY[i], posZ[i]); }
+
+    void updatePositions(double t, ThreadPool* pool = NULL);  //t: years since J2000; point bodies are split across the pool
+    void cameraRelative(const dvec3& eye);
+
+    vector<string> names;
+    vector<int> parents;
+    vector<OrbitalElements> elements;
+    vector<double> radius;  //Physical radius (AU)
+    vector<double> renderRadius;  //Displayed radius (AU); exaggerated so bodies are visible at system scale
+    vector<color4> colors;
+    vector<double> rotSpeed;  //Rotation speed compared to Earth
+    vector<unsigned char> flags;  //BodyFlags
+    vector<double> posX, posY, posZ;  //World position (AU)
+
+    vector<vec3> relPos;  //Camera-relative position (AU), filled by cameraRelative()
+    vector<mat4> models;  //Camera-relative model matrices, filled by cameraRelative() (left untouched for point bodies)
+    double nearestSurface, farthestPoint;  //Distance range of all rendered surfaces from the last cameraRelative() pass
+                                           //(point bodies only count toward farthestPoint)
+    //Camera-relative bounding spheres of the sphere bodies, packed for culling (frustum.h); filled by cameraRelative()
+    vector<int> sphereIds;
+    vector<GLfloat> sphereX, sphereY, sphereZ, sphereR;
+    size_t pointBegin, pointEnd;  //Index range spanning every point body (empty if there are none)
+
+private:
+    void updateRange(double t, size_t begin, size_t end, unsigned char mask, unsigned char match);  //Bodies with (flags & mask) == match
+};
+
+#endif // __BODYSTORE_H__
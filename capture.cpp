@@ -0,0 +1,315 @@
+#include "capture.h"
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+FrameCapture::FrameCapture() : format(CAPTURE_PNG), nameDigits(0), width(0), height(0), fps(30), out(NULL), nextFrame(0),
+                               stopping(false), failed(false), opened(false), framesWritten(0), captureSeconds(0), stallSeconds(0) {
+    for(int i = 0; i < NUM_PBOS; i++) { pbos[i] = 0;  fences[i] = 0;  pboFrame[i] = -1; }
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+    if(pbos[0] != 0) glDeleteBuffers(NUM_PBOS, pbos);
+}
+
+static bool endsWith(const string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+//Single-quoted for the shell, with each ' written as '\''
+static string shellQuote(const string& s) {
+    string q = "'";
+    for(size_t i = 0; i < s.size(); i++) q += s[i] == '\'' ? string("'\\''") : string(1, s[i]);
+    return q + "'";
+}
+
+bool FrameCapture::open(const string& t, int w, int h, int rate) {
+    width = w;  height = h;  fps = rate;  target = t;
+    if(endsWith(t, ".y4m")) format = CAPTURE_Y4M;
+    else if(endsWith(t, ".mp4") || endsWith(t, ".mkv") || endsWith(t, ".mov") || endsWith(t, ".webm")) format = CAPTURE_FFMPEG;
+    else format = CAPTURE_PNG;
+
+    if(format != CAPTURE_PNG && (w % 2 != 0 || h % 2 != 0)) {
+        cerr << "Capture: 4:2:0 video needs an even width and height, got " << w << "x" << h << endl;
+        return false;
+    }
+    if(format == CAPTURE_PNG) {
+        //Split the pattern once around its one %d or %0Nd; the frame number goes between the halves
+        size_t percent = target.find('%');
+        if(percent == string::npos) {
+            size_t dot = target.find_last_of('.');
+            if(dot == string::npos || target.find('/', dot) != string::npos) dot = target.size();
+            namePrefix = target.substr(0, dot);
+            nameSuffix = dot < target.size() ? target.substr(dot) : ".png";
+            nameDigits = 5;
+        }
+        else {
+            size_t end = percent + 1;
+            while(end < target.size() && isdigit((unsigned char) target[end])) end++;
+            string width = target.substr(percent + 1, end - percent - 1);
+            if(end >= target.size() || target[end] != 'd' || target.find('%', end) != string::npos ||
+               (!width.empty() && (width[0] != '0' || width.size() > 2))) {
+                cerr << "Capture: " << target << " needs exactly one %d or %0Nd for the frame number, and no other %"
+                     << endl;
+                return false;
+            }
+            namePrefix = target.substr(0, percent);
+            nameSuffix = target.substr(end + 1);
+            nameDigits = width.empty() ? 0 : atoi(width.c_str());
+        }
+    }
+    if(format == CAPTURE_Y4M) {
+        out = fopen(target.c_str(), "wb");
+        if(out == NULL) {
+            cerr << "Capture: could not open " << target << endl;
+            return false;
+        }
+    }
+    if(format == CAPTURE_FFMPEG) {
+        if(system("command -v ffmpeg >/dev/null 2>&1") != 0) {
+            cerr << "Capture: ffmpeg is not on the PATH; write a .y4m file instead" << endl;
+            return false;
+        }
+        string cmd = "ffmpeg -loglevel error -y -f yuv4mpegpipe -i - -pix_fmt yuv420p " + shellQuote(target);
+        out = popen(cmd.c_str(), "w");
+        if(out == NULL) {
+            cerr << "Capture: could not start ffmpeg" << endl;
+            return false;
+        }
+    }
+    if(out != NULL) fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+
+    size_t frameBytes = (size_t) width * height * 4;
+    glGenBuffers(NUM_PBOS, pbos);
+    for(int i = 0; i < NUM_PBOS; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frames.resize(QUEUE_FRAMES);
+    for(int i = 0; i < QUEUE_FRAMES; i++) {
+        frames[i].pixels.resize(frameBytes);
+        freeFrames.push_back(&frames[i]);
+    }
+    encoder = thread(&FrameCapture::encoderLoop, this);
+    opened = true;
+    return true;
+}
+
+void FrameCapture::capture() {
+    if(!opened) return;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int slot = nextFrame % NUM_PBOS;
+    if(pboFrame[slot] >= 0) retire(slot);  //Read NUM_PBOS frames ago; normally finished by now
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));  //Returns at once: the copy is queued
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pboFrame[slot] = nextFrame++;
+    captureSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void FrameCapture::retire(int slot) {
+    glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    glDeleteSync(fences[slot]);
+    fences[slot] = 0;
+
+    Frame* f;
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        unique_lock<mutex> lock(mtx);
+        frameFree.wait(lock, [this] { return !freeFrames.empty(); });
+        stallSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        f = freeFrames.back();
+        freeFrames.pop_back();
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, f->pixels.size(), GL_MAP_READ_BIT);
+    if(src != NULL) {
+        memcpy(&f->pixels[0], src, f->pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    f->index = pboFrame[slot];
+    pboFrame[slot] = -1;
+
+    {
+        lock_guard<mutex> lock(mtx);
+        readyFrames.push_back(f);
+    }
+    frameReady.notify_one();
+}
+
+void FrameCapture::finish() {
+    if(!opened) return;
+    for(long i = nextFrame - NUM_PBOS; i < nextFrame; i++) {  //Oldest first, so frames stay in order
+        if(i >= 0 && pboFrame[i % NUM_PBOS] == i) retire(i % NUM_PBOS);
+    }
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    frameReady.notify_one();
+    encoder.join();
+    if(format == CAPTURE_Y4M && out != NULL) fclose(out);
+    if(format == CAPTURE_FFMPEG && out != NULL && pclose(out) != 0) cerr << "Capture: ffmpeg reported an error" << endl;
+    out = NULL;
+    opened = false;
+}
+
+void FrameCapture::encoderLoop() {
+    for(;;) {
+        Frame* f;
+        {
+            unique_lock<mutex> lock(mtx);
+            frameReady.wait(lock, [this] { return stopping || !readyFrames.empty(); });
+            if(readyFrames.empty()) return;
+            f = readyFrames.front();
+            readyFrames.pop_front();
+        }
+        if(!failed) {
+            failed = !writeFrame(*f);
+            if(!failed) framesWritten++;
+        }
+        {
+            lock_guard<mutex> lock(mtx);
+            freeFrames.push_back(f);
+        }
+        frameFree.notify_one();
+    }
+}
+
+bool FrameCapture::writeFrame(const Frame& f) {
+    return format == CAPTURE_PNG ? writePNG(f) : writeY4M(f);
+}
+
+//----------------------------------------------------------------------------
+//  PNG (8-bit RGB, stored deflate blocks)
+//
+
+static unsigned long crcTable[256];
+
+static void makeCrcTable() {
+    for(unsigned long n = 0; n < 256; n++) {
+        unsigned long c = n;
+        for(int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static unsigned long crc32(unsigned long crc, const unsigned char* p, size_t n) {
+    crc ^= 0xffffffffUL;
+    for(size_t i = 0; i < n; i++) crc = crcTable[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffUL;
+}
+
+static void put32(vector<unsigned char>& v, unsigned long x) {
+    v.push_back((x >> 24) & 0xff);  v.push_back((x >> 16) & 0xff);  v.push_back((x >> 8) & 0xff);  v.push_back(x & 0xff);
+}
+
+//Appends a chunk (length, type, data, CRC) to v
+static void pngChunk(vector<unsigned char>& v, const char* type, const unsigned char* data, size_t n) {
+    put32(v, n);
+    size_t start = v.size();
+    v.insert(v.end(), type, type + 4);
+    if(n > 0) v.insert(v.end(), data, data + n);
+    put32(v, crc32(0, &v[start], n + 4));
+}
+
+bool FrameCapture::writePNG(const Frame& f) {
+    if(crcTable[1] == 0) makeCrcTable();  //Only the encoder thread writes PNGs
+
+    //Raw scanlines, top row first: filter byte 0, then RGB
+    size_t rowBytes = (size_t) width * 3 + 1;
+    size_t rawSize = rowBytes * height;
+    vector<unsigned char> raw(rawSize);
+    unsigned long a = 1, b = 0;  //Adler-32 of the raw data
+    for(int y = 0; y < height; y++) {
+        unsigned char* dst = &raw[y * rowBytes];
+        const unsigned char* src = &f.pixels[(size_t) (height - 1 - y) * width * 4];
+        *dst++ = 0;
+        for(int x = 0; x < width; x++, src += 4) { *dst++ = src[0];  *dst++ = src[1];  *dst++ = src[2]; }
+    }
+    for(size_t i = 0; i < rawSize; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    //zlib stream of stored blocks (at most 65535 bytes each)
+    vector<unsigned char> z;
+    z.reserve(rawSize + rawSize / 65535 * 5 + 16);
+    z.push_back(0x78);  z.push_back(0x01);
+    for(size_t pos = 0; pos < rawSize || pos == 0; ) {
+        size_t n = min(rawSize - pos, (size_t) 65535);
+        bool last = (pos + n == rawSize);
+        z.push_back(last ? 1 : 0);
+        z.push_back(n & 0xff);  z.push_back(n >> 8);
+        z.push_back(~n & 0xff);  z.push_back((~n >> 8) & 0xff);
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+        pos += n;
+        if(last) break;
+    }
+    put32(z, (b << 16) | a);
+
+    scratch.clear();
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    scratch.insert(scratch.end(), signature, signature + 8);
+    vector<unsigned char> ihdr;
+    put32(ihdr, width);  put32(ihdr, height);
+    ihdr.push_back(8);  ihdr.push_back(2);  //8-bit RGB
+    ihdr.push_back(0);  ihdr.push_back(0);  ihdr.push_back(0);
+    pngChunk(scratch, "IHDR", &ihdr[0], ihdr.size());
+    pngChunk(scratch, "IDAT", &z[0], z.size());
+    pngChunk(scratch, "IEND", NULL, 0);
+
+    char number[32];
+    snprintf(number, sizeof(number), "%0*ld", nameDigits, f.index);
+    string name = namePrefix + number + nameSuffix;
+    FILE* fp = fopen(name.c_str(), "wb");
+    if(fp == NULL) {
+        cerr << "Capture: could not write " << name << endl;
+        return false;
+    }
+    bool ok = fwrite(&scratch[0], 1, scratch.size(), fp) == scratch.size();
+    ok = (fclose(fp) == 0) && ok;
+    if(!ok) cerr << "Capture: could not write " << name << endl;
+    return ok;
+}
+
+//----------------------------------------------------------------------------
+//  Y4M (full-range BT.601 YUV 4:2:0)
+//
+
+static inline unsigned char clampByte(int v) { return (unsigned char) (v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+bool FrameCapture::writeY4M(const Frame& f) {
+    size_t lumaSize = (size_t) width * height, chromaSize = lumaSize / 4;
+    scratch.resize(lumaSize + 2 * chromaSize);
+    unsigned char *yPlane = &scratch[0], *uPlane = yPlane + lumaSize, *vPlane = uPlane + chromaSize;
+    for(int y = 0; y < height; y++) {
+        const unsigned char* src = &f.pixels[(size_t) (height - 1 - y) * width * 4];
+        unsigned char* dst = yPlane + (size_t) y * width;
+        for(int x = 0; x < width; x++, src += 4) dst[x] = (unsigned char) ((77*src[0] + 150*src[1] + 29*src[2] + 128) >> 8);
+    }
+    for(int y = 0; y < height; y += 2) {
+        const unsigned char* r0 = &f.pixels[(size_t) (height - 1 - y) * width * 4];
+        const unsigned char* r1 = r0 - (size_t) width * 4;
+        for(int x = 0; x < width; x += 2) {
+            const unsigned char *p = r0 + x*4, *q = r1 + x*4;
+            int r = p[0] + p[4] + q[0] + q[4], g = p[1] + p[5] + q[1] + q[5], b = p[2] + p[6] + q[2] + q[6];  //Sums of 2x2
+            size_t i = (size_t) (y / 2) * (width / 2) + x / 2;
+            uPlane[i] = clampByte((-43*r - 85*g + 128*b + (128 << 10) + 512) >> 10);
+            vPlane[i] = clampByte((128*r - 107*g - 21*b + (128 << 10) + 512) >> 10);
+        }
+    }
+    bool ok = fputs("FRAME\n", out) >= 0 && fwrite(&scratch[0], 1, scratch.size(), out) == scratch.size();
+    if(!ok) cerr << "Capture: could not write frame " << f.index << " to " << target << endl;
+    return ok;
+}
@@ -0,0 +1,82 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "Angel-yjc.h"
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/***
+ Frame capture without stalling the renderer on glReadPixels
+    - capture() starts an asynchronous glReadPixels into the next pixel buffer object of a small ring and fences it; the
+      frame read NUM_PBOS captures ago is mapped (its fence has long signaled) and copied into a host buffer
+    - Host buffers go to a background encoder thread through a bounded queue: when all QUEUE_FRAMES buffers are in flight
+      capture() waits for the encoder (backpressure) instead of growing the queue
+    - Output by target name: "*.y4m" raw YUV 4:2:0 video; "*.mp4", "*.mkv", "*.mov", "*.webm" the same stream piped to
+      ffmpeg (when it is on the PATH); anything else a PNG sequence, where a pattern like "frame%05d.png" (one %d or %0Nd,
+      no other %) names the files (without one, the frame number is inserted before the extension)
+    - PNGs are written with stored (uncompressed) deflate blocks, so there is no zlib dependency and encoding costs little
+ ***/
+class FrameCapture {
+public:
+    static const int NUM_PBOS = 3;
+    static const int QUEUE_FRAMES = 4;
+
+    enum Format { CAPTURE_PNG, CAPTURE_Y4M, CAPTURE_FFMPEG };
+
+    FrameCapture();
+    ~FrameCapture();
+
+    //Call with a current GL context; prints the reason to cerr and returns false on failure
+    bool open(const string& target, int width, int height, int fps);
+    void capture();  //Reads back the bound framebuffer after a frame has been drawn
+    void finish();   //Retires every pending readback and waits for the encoder to write it
+
+    long getFrames() const { return framesWritten; }
+    double getCaptureSeconds() const { return captureSeconds; }  //Time spent inside capture() on the render thread
+    double getStallSeconds() const { return stallSeconds; }      //Part of that spent waiting for a free host buffer
+
+private:
+    struct Frame {
+        vector<unsigned char> pixels;  //RGBA, bottom row first (as read from GL)
+        long index;
+    };
+
+    void retire(int slot);  //Maps a finished PBO and hands its pixels to the encoder
+    void encoderLoop();
+    bool writeFrame(const Frame& f);
+    bool writePNG(const Frame& f);
+    bool writeY4M(const Frame& f);
+
+    Format format;
+    string target;
+    string namePrefix, nameSuffix;  //PNG file names: prefix, frame number, suffix
+    int nameDigits;                 //Frame number zero-padded to this width
+    int width, height, fps;
+    FILE* out;  //Y4M file or ffmpeg pipe
+
+    GLuint pbos[NUM_PBOS];
+    GLsync fences[NUM_PBOS];
+    long pboFrame[NUM_PBOS];  //Frame index held by each PBO, -1 if empty
+    long nextFrame;
+
+    vector<Frame> frames;  //QUEUE_FRAMES host buffers
+    vector<Frame*> freeFrames;
+    deque<Frame*> readyFrames;
+    mutex mtx;
+    condition_variable frameFree, frameReady;
+    thread encoder;
+    bool stopping, failed, opened;
+
+    vector<unsigned char> scratch;  //Encoder-thread buffer (PNG stream or YUV planes)
+    long framesWritten;
+    double captureSeconds, stallSeconds;
+};
+
+#endif // __CAPTURE_H__
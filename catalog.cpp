@@ -0,0 +1,391 @@
+#include "catalog.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <stdint.h>
+#include <unordered_map>
+
+enum CatalogField {
+    FIELD_RADIUS, FIELD_MAJOR, FIELD_ECCENTRICITY, FIELD_PERIOD, FIELD_ROTATION,
+    FIELD_INCLINATION, FIELD_ASC_NODE, FIELD_PERI_LONG, FIELD_MEAN_LONG, FIELD_NODE_RATE, FIELD_PERI_RATE,
+    FIELD_COLOR_R, FIELD_COLOR_G, FIELD_COLOR_B, NUM_FIELDS,
+    FIELD_NAME = -2, FIELD_PARENT = -3, FIELD_UNKNOWN = -1
+};
+
+static const char* fieldNames[NUM_FIELDS] = {
+    "radius", "major", "eccentricity", "period", "rotation",
+    "inclination", "asc_node", "peri_long", "mean_long", "node_rate", "peri_rate",
+    "color_r", "color_g", "color_b"
+};
+
+static int fieldId(const string& key) {
+    if(key == "name") return FIELD_NAME;
+    if(key == "parent") return FIELD_PARENT;
+    for(int i = 0; i < NUM_FIELDS; i++) { if(key == fieldNames[i]) return i; }
+    return FIELD_UNKNOWN;
+}
+
+//Turns parsed rows into bodies; shared by the CSV and JSON loaders
+struct CatalogBuilder {
+    BodyStore& store;
+    unordered_map<string, int> index;  //Name -> body index, for resolving parents
+
+    CatalogBuilder(BodyStore& s) : store(s) {
+        for(int i = 0; i < store.size(); i++) { index[store.names[i]] = i; }
+    }
+
+    bool addRow(const string& name, const string& parentName, const double* v, int line) {
+        int parent = -1;
+        if(!parentName.empty()) {
+            unordered_map<string, int>::iterator it = index.find(parentName);
+            if(it == index.end()) {
+                cerr << "Catalog line " << line << ": parent \"" << parentName << "\" of " << name << " is not defined before it" << endl;
+                return false;
+            }
+            parent = it->second;
+        }
+
+        OrbitalElements el;
+        el.major = v[FIELD_MAJOR];  el.eccentricity = v[FIELD_ECCENTRICITY];
+        el.period = v[FIELD_PERIOD] / DAYS_PER_YEAR;  //The sheet's "Length" column is in days
+        el.inclination = v[FIELD_INCLINATION];  el.ascNode = v[FIELD_ASC_NODE];
+        el.periLong = v[FIELD_PERI_LONG];  el.meanLong = v[FIELD_MEAN_LONG];
+        el.nodeRate = v[FIELD_NODE_RATE];  el.periRate = v[FIELD_PERI_RATE];
+
+        double radius = v[FIELD_RADIUS] * AU_PER_EARTH_RADIUS;
+        color4 color(v[FIELD_COLOR_R], v[FIELD_COLOR_G], v[FIELD_COLOR_B], 1.0);
+        //renderRadius follows the Planet/Moon constructors (10x the real radius)
+        index[name] = store.addBody(name, el, radius, radius * 10, color, parent, v[FIELD_ROTATION]);
+        return true;
+    }
+
+    //The 10x exaggeration would swallow close moons, so keep each parent inside half of its nearest moon's periapsis
+    void clampRenderRadii(size_t first) {
+        for(size_t i = first; i < store.size(); i++) {
+            int p = store.parents[i];
+            if(p < 0) continue;
+            const OrbitalElements& el = store.elements[i];
+            double limit = max(store.radius[p], 0.5 * el.major * (1 - el.eccentricity));
+            if(store.renderRadius[p] > limit) store.renderRadius[p] = limit;
+        }
+    }
+};
+
+static bool readFile(const string& path, vector<char>& data) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(fp == NULL) { return false; }
+    fseek(fp, 0L, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+    data.resize(size);
+    size_t got = size > 0 ? fread(&data[0], 1, size, fp) : 0;
+    fclose(fp);
+    return got == (size_t) size;
+}
+
+bool loadCatalog(const string& path, BodyStore& store) {
+    vector<char> data;
+    if(!readFile(path, data)) {
+        cerr << "Failed to read catalog " << path << endl;
+        return false;
+    }
+    const char* ptr = data.empty() ? "" : &data[0];
+    string ext = path.substr(path.find_last_of('.') + 1);
+    if(ext == "bin") return loadCatalogBinary(ptr, data.size(), store);
+    if(ext == "json") return loadCatalogJSON(ptr, data.size(), store);
+    return loadCatalogCSV(ptr, data.size(), store);
+}
+
+//----------------------------------------------------------------------------
+//  CSV
+//
+
+struct Span { const char *begin, *end; };
+
+//Split one CSV line into trimmed field spans (no copies); double-quoted fields may contain commas
+static void splitCSV(const char* p, const char* end, vector<Span>& fields) {
+    fields.clear();
+    while(p <= end) {
+        Span f;
+        while(p < end && (*p == ' ' || *p == '\t')) p++;
+        if(p < end && *p == '"') {
+            f.begin = ++p;
+            while(p < end && *p != '"') p++;
+            f.end = p;
+            while(p < end && *p != ',') p++;
+        }
+        else {
+            f.begin = p;
+            while(p < end && *p != ',') p++;
+            f.end = p;
+            while(f.end > f.begin && (f.end[-1] == ' ' || f.end[-1] == '\t')) f.end--;
+        }
+        fields.push_back(f);
+        p++;  //Skip the comma
+    }
+}
+
+static double parseNumber(const Span& f) {
+    char buf[64];
+    size_t n = min((size_t) (f.end - f.begin), sizeof(buf) - 1);
+    memcpy(buf, f.begin, n);
+    buf[n] = '\0';
+    return atof(buf);
+}
+
+bool loadCatalogCSV(const char* data, size_t size, BodyStore& store) {
+    CatalogBuilder builder(store);
+    size_t first = store.size();
+    vector<int> columns;
+    vector<Span> fields;
+    const char* p = data;
+    const char* end = data + size;
+    int line = 0;
+
+    size_t lines = 0;
+    for(const char* q = p; (q = (const char*) memchr(q, '\n', end - q)) != NULL; q++) lines++;
+    store.reserve(store.size() + lines + 1);
+    builder.index.reserve(store.size() + lines + 1);
+
+    while(p < end) {
+        const char* eol = (const char*) memchr(p, '\n', end - p);
+        if(eol == NULL) eol = end;
+        line++;
+        const char* lineEnd = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+
+        if(lineEnd > p && *p != '#') {
+            splitCSV(p, lineEnd, fields);
+            if(columns.empty()) {  //Header row
+                for(int i = 0; i < fields.size(); i++) { columns.push_back(fieldId(string(fields[i].begin, fields[i].end))); }
+            }
+            else {
+                double v[NUM_FIELDS] = { 0 };
+                string name, parent;
+                for(int i = 0; i < fields.size() && i < columns.size(); i++) {
+                    if(columns[i] == FIELD_NAME) name.assign(fields[i].begin, fields[i].end);
+                    else if(columns[i] == FIELD_PARENT) parent.assign(fields[i].begin, fields[i].end);
+                    else if(columns[i] >= 0 && fields[i].end > fields[i].begin) v[columns[i]] = parseNumber(fields[i]);
+                }
+                if(name.empty()) {
+                    cerr << "Catalog line " << line << ": missing name" << endl;
+                    return false;
+                }
+                if(!builder.addRow(name, parent, v, line)) return false;
+            }
+        }
+        p = eol + 1;
+    }
+    builder.clampRenderRadii(first);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+//  JSON (an array of flat objects; nested values other than "color" are skipped)
+//
+
+struct JsonReader {
+    const char *p, *end;
+    int line;
+
+    JsonReader(const char* data, size_t size) : p(data), end(data + size), line(1) {}
+
+    void skipSpace() {
+        for(; p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'); p++) { if(*p == '\n') line++; }
+    }
+    bool accept(char c) {
+        skipSpace();
+        if(p < end && *p == c) { p++; return true; }
+        return false;
+    }
+    bool readString(string& s) {
+        if(!accept('"')) return false;
+        s.clear();
+        for(; p < end && *p != '"'; p++) {
+            if(*p == '\\' && p + 1 < end) p++;
+            s += *p;
+        }
+        return accept('"');
+    }
+    bool readNumber(double& v) {
+        skipSpace();
+        char buf[64];
+        int n = 0;
+        while(p < end && n < 63 && *p && strchr("+-.0123456789eE", *p)) buf[n++] = *p++;
+        buf[n] = '\0';
+        v = atof(buf);
+        return n > 0;
+    }
+    bool skipValue() {
+        skipSpace();
+        if(p >= end) return false;
+        if(*p == '"') { string s; return readString(s); }
+        if(*p == '[' || *p == '{') {
+            char close = (*p == '[') ? ']' : '}';
+            p++;
+            if(accept(close)) return true;
+            do {
+                if(close == '}') { string key; if(!readString(key) || !accept(':')) return false; }
+                if(!skipValue()) return false;
+            } while(accept(','));
+            return accept(close);
+        }
+        while(p < end && (isalnum(*p) || *p == '-' || *p == '+' || *p == '.')) p++;  //Number, true, false, null
+        return true;
+    }
+};
+
+bool loadCatalogJSON(const char* data, size_t size, BodyStore& store) {
+    CatalogBuilder builder(store);
+    size_t first = store.size();
+    JsonReader json(data, size);
+
+    if(!json.accept('[')) {
+        cerr << "Catalog JSON: expected an array of bodies" << endl;
+        return false;
+    }
+    if(json.accept(']')) return true;
+    do {
+        if(!json.accept('{')) {
+            cerr << "Catalog JSON line " << json.line << ": expected an object" << endl;
+            return false;
+        }
+        double v[NUM_FIELDS] = { 0 };
+        string name, parent, key;
+        int line = json.line;
+        if(!json.accept('}')) {
+            do {
+                if(!json.readString(key) || !json.accept(':')) {
+                    cerr << "Catalog JSON line " << json.line << ": expected \"key\":" << endl;
+                    return false;
+                }
+                int id = fieldId(key);
+                bool ok;
+                if(id == FIELD_NAME) ok = json.readString(name);
+                else if(id == FIELD_PARENT) ok = json.readString(parent) || json.skipValue();  //null parent
+                else if(key == "color") {
+                    ok = json.accept('[');
+                    for(int c = 0; ok && c < 3; c++) { ok = (c == 0 || json.accept(',')) && json.readNumber(v[FIELD_COLOR_R + c]); }
+                    ok = ok && json.accept(']');
+                }
+                else if(id >= 0) ok = json.readNumber(v[id]);
+                else ok = json.skipValue();
+                if(!ok) {
+                    cerr << "Catalog JSON line " << json.line << ": bad value for \"" << key << "\"" << endl;
+                    return false;
+                }
+            } while(json.accept(','));
+            if(!json.accept('}')) {
+                cerr << "Catalog JSON line " << json.line << ": expected '}'" << endl;
+                return false;
+            }
+        }
+        if(!builder.addRow(name, parent, v, line)) return false;
+    } while(json.accept(','));
+
+    if(!json.accept(']')) {
+        cerr << "Catalog JSON line " << json.line << ": expected ']'" << endl;
+        return false;
+    }
+    builder.clampRenderRadii(first);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+//  Binary: header, fixed-size records, then the null-terminated names back to back
+//
+
+static const char CATALOG_MAGIC[4] = { 'S', 'S', 'B', 'C' };
+static const uint32_t CATALOG_VERSION = 1;
+
+struct CatalogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t nameBytes;
+};
+
+struct CatalogRecord {  //120 bytes, naturally aligned
+    int32_t parent;
+    uint32_t nameOffset;
+    double major, eccentricity, inclination, ascNode, periLong, meanLong, period, nodeRate, periRate;
+    double radius, renderRadius, rotSpeed;  //AU, AU, relative to Earth
+    float color[4];
+};
+
+bool loadCatalogBinary(const char* data, size_t size, BodyStore& store) {
+    CatalogHeader header;
+    if(size < sizeof(header)) {
+        cerr << "Catalog binary: file too small" << endl;
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(memcmp(header.magic, CATALOG_MAGIC, 4) != 0 || header.version != CATALOG_VERSION) {
+        cerr << "Catalog binary: bad magic or unsupported version" << endl;
+        return false;
+    }
+    size_t recordBytes = (size_t) header.count * sizeof(CatalogRecord);
+    if(size < sizeof(header) + recordBytes + header.nameBytes) {
+        cerr << "Catalog binary: truncated file" << endl;
+        return false;
+    }
+    const char* records = data + sizeof(header);
+    const char* names = records + recordBytes;
+
+    int base = (int) store.size();
+    store.reserve(store.size() + header.count);
+    for(uint32_t i = 0; i < header.count; i++) {
+        CatalogRecord r;
+        memcpy(&r, records + i * sizeof(CatalogRecord), sizeof(r));
+        //The name must end with a NUL inside the name table, or reading it would run off the end of the mapping
+        const char* name = r.nameOffset < header.nameBytes ? names + r.nameOffset : NULL;
+        const char* nameEnd = name != NULL ? (const char*) memchr(name, 0, header.nameBytes - r.nameOffset) : NULL;
+        if(nameEnd == NULL || r.parent >= (int32_t) i) {
+            cerr << "Catalog binary: bad record " << i << endl;
+            return false;
+        }
+        OrbitalElements el;
+        el.major = r.major;  el.eccentricity = r.eccentricity;  el.inclination = r.inclination;
+        el.ascNode = r.ascNode;  el.periLong = r.periLong;  el.meanLong = r.meanLong;
+        el.period = r.period;  el.nodeRate = r.nodeRate;  el.periRate = r.periRate;
+        store.addBody(string(name, nameEnd - name), el, r.radius, r.renderRadius,
+                      color4(r.color[0], r.color[1], r.color[2], r.color[3]), r.parent < 0 ? -1 : base + r.parent, r.rotSpeed);
+    }
+    return true;
+}
+
+bool saveCatalogBinary(const string& path, const BodyStore& store) {
+    CatalogHeader header;
+    memcpy(header.magic, CATALOG_MAGIC, 4);
+    header.version = CATALOG_VERSION;
+    header.count = (uint32_t) store.size();
+
+    vector<CatalogRecord> records(store.size());
+    string names;
+    for(size_t i = 0; i < store.size(); i++) {
+        CatalogRecord& r = records[i];
+        const OrbitalElements& el = store.elements[i];
+        r.parent = store.parents[i];
+        r.nameOffset = (uint32_t) names.size();
+        names += store.names[i];
+        names += '\0';
+        r.major = el.major;  r.eccentricity = el.eccentricity;  r.inclination = el.inclination;
+        r.ascNode = el.ascNode;  r.periLong = el.periLong;  r.meanLong = el.meanLong;
+        r.period = el.period;  r.nodeRate = el.nodeRate;  r.periRate = el.periRate;
+        r.radius = store.radius[i];  r.renderRadius = store.renderRadius[i];  r.rotSpeed = store.rotSpeed[i];
+        for(int c = 0; c < 4; c++) r.color[c] = store.colors[i][c];
+    }
+    header.nameBytes = (uint32_t) names.size();
+
+    FILE* fp = fopen(path.c_str(), "wb");
+    if(fp == NULL) {
+        cerr << "Failed to write catalog " << path << endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if(!records.empty()) ok = ok && fwrite(&records[0], sizeof(CatalogRecord), records.size(), fp) == records.size();
+    ok = ok && fwrite(names.data(), 1, names.size(), fp) == names.size();
+    fclose(fp);
+    if(!ok) cerr << "Failed to write catalog " << path << endl;
+    return ok;
+}
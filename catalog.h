@@ -0,0 +1,26 @@
+#ifndef __CATALOG_H__
+#define __CATALOG_H__
+
+#include "bodystore.h"
+#include <string>
+
+using namespace std;
+
+/***
+ Body catalog loading (replaces the hardcoded Planet/Moon globals)
+    - CSV: an export of "Orbital Stats.xlsx"; the header row names the columns, so they can be in any order, and
+      lines starting with '#' are comments (see bodies.csv for the column list and units)
+    - JSON: an array of flat objects using the same keys as the CSV header ("color" may also be an [r, g, b] array)
+    - Binary (.bin): fixed-size records written by saveCatalogBinary(); loads with a single read
+    - Every row becomes one body in the BodyStore; a row's parent must appear before it
+    - On error the loaders print the reason to cerr and return false
+ ***/
+
+bool loadCatalog(const string& path, BodyStore& store);  //Picks the format from the file extension
+bool loadCatalogCSV(const char* data, size_t size, BodyStore& store);
+bool loadCatalogJSON(const char* data, size_t size, BodyStore& store);
+bool loadCatalogBinary(const char* data, size_t size, BodyStore& store);
+
+bool saveCatalogBinary(const string& path, const BodyStore& store);
+
+#endif // __CATALOG_H__
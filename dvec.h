@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+//  --- dvec.h ---
+//
+//   Double-precision 3D vector for world-space (AU) math.  The float vec3/vec4
+//   in vec.h are only precise to ~7 digits, which is not enough once bodies
+//   are placed at real orbital distances.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DVEC_H__
+#define __DVEC_H__
+
+#include <cmath>
+#include <iostream>
+
+namespace Angel {
+
+    struct dvec3 {
+
+        double  x;
+        double  y;
+        double  z;
+
+        dvec3( double s = 0.0 ) :
+        x(s), y(s), z(s) {}
+
+        dvec3( double x, double y, double z ) :
+        x(x), y(y), z(z) {}
+
+        double& operator [] ( int i ) { return *(&x + i); }
+        const double operator [] ( int i ) const { return *(&x + i); }
+
+        dvec3 operator - () const
+        { return dvec3( -x, -y, -z ); }
+
+        dvec3 operator + ( const dvec3& v ) const
+        { return dvec3( x + v.x, y + v.y, z + v.z ); }
+
+        dvec3 operator - ( const dvec3& v ) const
+        { return dvec3( x - v.x, y - v.y, z - v.z ); }
+
+        dvec3 operator * ( const double s ) const
+        { return dvec3( s*x, s*y, s*z ); }
+
+        friend dvec3 operator * ( const double s, const dvec3& v )
+        { return v * s; }
+
+        dvec3 operator / ( const double s ) const
+        { return *this * (1.0 / s); }
+
+        dvec3& operator += ( const dvec3& v )
+        { x += v.x;  y += v.y;  z += v.z;  return *this; }
+
+        dvec3& operator -= ( const dvec3& v )
+        { x -= v.x;  y -= v.y;  z -= v.z;  return *this; }
+
+        dvec3& operator *= ( const double s )
+        { x *= s;  y *= s;  z *= s;  return *this; }
+
+        friend std::ostream& operator << ( std::ostream& os, const dvec3& v ) {
+            return os << "( " << v.x << ", " << v.y << ", " << v.z <<  " )";
+        }
+    };
+
+    inline
+    double dot( const dvec3& u, const dvec3& v ) {
+        return u.x*v.x + u.y*v.y + u.z*v.z;
+    }
+
+    inline
+    double length( const dvec3& v ) {
+        return std::sqrt( dot(v,v) );
+    }
+
+    inline
+    dvec3 normalize( const dvec3& v ) {
+        return v / length(v);
+    }
+
+    inline
+    dvec3 cross( const dvec3& a, const dvec3& b ) {
+        return dvec3( a.y * b.z - a.z * b.y,
+                     a.z * b.x - a.x * b.z,
+                     a.x * b.y - a.y * b.x );
+    }
+
+}  // namespace Angel
+
+#endif // __DVEC_H__
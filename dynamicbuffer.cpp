@@ -0,0 +1,131 @@
+#include "dynamicbuffer.h"
+#include "glcaps.h"
+#include <cstring>
+#include <iostream>
+
+DynamicBuffer::DynamicBuffer() : buffer(0), mapped(NULL), regionBytes(0), used(0), region(0), uniformAlignment(256),
+                                 storageAlignment(256), persistentSupported(false), waits(0) {
+    for(int i = 0; i < NUM_REGIONS; i++) fences[i] = 0;
+}
+
+void DynamicBuffer::init(size_t bytes) {
+    GLint align = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    uniformAlignment = align;
+    storageAlignment = align;
+    if(hasGLVersion(4, 3)) {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+        storageAlignment = align;
+    }
+#ifdef GL_MAP_PERSISTENT_BIT
+    persistentSupported = hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage");
+#endif
+    size_t power = 1;
+    while(power < bytes) power *= 2;  //Regions start on every alignment the slices ask for
+    create(power);
+}
+
+//The buffer for NUM_REGIONS regions of bytes each; nothing in it is in use yet
+void DynamicBuffer::create(size_t bytes) {
+    regionBytes = bytes;
+    size_t total = bytes * NUM_REGIONS;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);  //A target no draw state depends on
+    mapped = NULL;
+#ifdef GL_MAP_PERSISTENT_BIT
+    if(persistentSupported) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+        mapped = (unsigned char*) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+        if(mapped == NULL) {
+            cerr << "Warning: could not map the dynamic buffer persistently; staging uploads in client memory" << endl;
+            persistentSupported = false;
+            glDeleteBuffers(1, &buffer);  //Storage made by glBufferStorage is immutable
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        }
+    }
+#endif
+    if(mapped == NULL) {
+        glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+        staging.assign(total, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+//Retires the buffer for one with regions of at least needed bytes; the current frame carries on in the new one
+void DynamicBuffer::grow(size_t needed) {
+    Retired r;
+    r.buffer = buffer;
+    r.fence = 0;
+    r.staging.swap(staging);
+    retired.push_back(r);
+    for(int i = 0; i < NUM_REGIONS; i++) {  //The retired buffer's fence covers all of its regions
+        if(fences[i] != 0) glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+    size_t bytes = regionBytes * 2;
+    while(bytes < needed) bytes *= 2;
+    create(bytes);
+    used = 0;
+}
+
+void DynamicBuffer::beginFrame() {
+    for(size_t i = 0; i < retired.size(); ) {
+        Retired& r = retired[i];
+        if(r.fence != 0 && glClientWaitSync(r.fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+            glDeleteSync(r.fence);
+            glDeleteBuffers(1, &r.buffer);  //Unmaps it too
+            retired.erase(retired.begin() + i);
+        } else {
+            i++;
+        }
+    }
+
+    region = (region + 1) % NUM_REGIONS;
+    used = 0;
+    if(fences[region] != 0) {  //Written NUM_REGIONS frames ago
+        if(glClientWaitSync(fences[region], 0, 0) == GL_TIMEOUT_EXPIRED) {
+            waits++;
+            while(glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL) == GL_TIMEOUT_EXPIRED) {}
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+}
+
+void DynamicBuffer::endFrame() {
+    if(fences[region] != 0) glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    for(size_t i = 0; i < retired.size(); i++)
+        if(retired[i].fence == 0) retired[i].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+DynamicSlice DynamicBuffer::allocate(size_t bytes, size_t alignment) {
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if(offset + bytes > regionBytes) {
+        grow(bytes);
+        offset = 0;
+    }
+    used = offset + bytes;
+    DynamicSlice slice;
+    slice.buffer = buffer;
+    slice.offset = (GLintptr) (region * regionBytes + offset);
+    slice.size = (GLsizeiptr) bytes;
+    slice.data = (mapped != NULL ? mapped : &staging[0]) + slice.offset;
+    return slice;
+}
+
+void DynamicBuffer::commit(const DynamicSlice& slice) {
+    if(mapped != NULL) return;  //Coherent: the GPU sees the writes without being told
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slice.buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, slice.offset, slice.size, slice.data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+DynamicSlice DynamicBuffer::upload(const void* data, size_t bytes, size_t alignment) {
+    DynamicSlice slice = allocate(bytes, alignment);
+    memcpy(slice.data, data, bytes);
+    commit(slice);
+    return slice;
+}
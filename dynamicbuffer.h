@@ -0,0 +1,73 @@
+#ifndef __DYNAMICBUFFER_H__
+#define __DYNAMICBUFFER_H__
+
+#include "Angel-yjc.h"
+#include <vector>
+
+using namespace std;
+
+//Part of a DynamicBuffer handed out for this frame: write the data, commit(), then bind buffer at offset
+struct DynamicSlice {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+    void* data;
+};
+
+/***
+ One buffer for everything uploaded every frame (uniform blocks, draw records, point positions, texture bands)
+    - Created with glBufferStorage and mapped once, persistent and coherent (ARB_buffer_storage), and split into
+      NUM_REGIONS regions, one per frame in flight; a frame's slices are carved off its region one after another, so
+      an upload is a memcpy into the mapping with no driver copy and nothing for the driver to synchronize
+    - endFrame() puts a fence after the frame's commands; beginFrame() moves to the next region and waits for that
+      region's fence, which has normally signaled long before (getWaits() counts the times it hadn't)
+    - A frame that outgrows its region gets a new buffer twice the size (or more) at once; the old one keeps the slices
+      already handed out and is deleted once a fence says the GPU is done with it. Slices name their buffer, so bind
+      slice.buffer every time
+    - Without ARB_buffer_storage (macOS) the regions are staged in client memory and commit() copies each slice in
+      with glBufferSubData; with it commit() does nothing
+ ***/
+class DynamicBuffer {
+public:
+    static const int NUM_REGIONS = 3;
+    static const size_t INITIAL_REGION_BYTES = 1 << 20;
+
+    DynamicBuffer();
+
+    void init(size_t regionBytes = INITIAL_REGION_BYTES);  //Call with a current context
+    void beginFrame();
+    void endFrame();
+
+    DynamicSlice allocate(size_t bytes, size_t alignment);  //alignment must be a power of two
+    void commit(const DynamicSlice& slice);
+    DynamicSlice upload(const void* data, size_t bytes, size_t alignment);  //allocate(), copy and commit()
+
+    bool isPersistent() const { return mapped != NULL; }
+    size_t getUniformAlignment() const { return uniformAlignment; }  //Offsets for glBindBufferRange
+    size_t getStorageAlignment() const { return storageAlignment; }
+    size_t getRegionBytes() const { return regionBytes; }
+    long getWaits() const { return waits; }
+
+private:
+    struct Retired {
+        GLuint buffer;
+        GLsync fence;  //0 until the end of the frame that retired it
+        vector<unsigned char> staging;
+    };
+
+    void create(size_t bytes);
+    void grow(size_t needed);
+
+    GLuint buffer;
+    unsigned char* mapped;          //NULL without ARB_buffer_storage
+    vector<unsigned char> staging;  //Client copy of the regions without it
+    size_t regionBytes, used;
+    int region;
+    GLsync fences[NUM_REGIONS];
+    vector<Retired> retired;
+    size_t uniformAlignment, storageAlignment;
+    bool persistentSupported;
+    long waits;
+};
+
+#endif // __DYNAMICBUFFER_H__
@@ -0,0 +1,38 @@
+# Writes OUTPUT, a C++ header holding every *.glsl file in SHADER_DIR as a constexpr raw string, with each
+# #include "file" replaced by that file's (expanded) text. Run by CMakeLists.txt whenever a shader changes:
+#   cmake -DSHADER_DIR=<dir> -DOUTPUT=<header> -P embed_shaders.cmake
+
+function(expand_includes name depth result)
+    if(depth GREATER 16)
+        message(FATAL_ERROR "${name}: #include nested too deeply (is there a cycle?)")
+    endif()
+    if(NOT EXISTS "${SHADER_DIR}/${name}")
+        message(FATAL_ERROR "Shader include not found: ${SHADER_DIR}/${name}")
+    endif()
+    file(READ "${SHADER_DIR}/${name}" text)
+    string(REGEX MATCHALL "#include[ \t]+\"[^\"]+\"" directives "${text}")
+    foreach(directive ${directives})
+        string(REGEX REPLACE "#include[ \t]+\"([^\"]+)\"" "\\1" included "${directive}")
+        math(EXPR next "${depth} + 1")
+        expand_includes("${included}" ${next} included_text)
+        string(REPLACE "${directive}" "${included_text}" text "${text}")
+    endforeach()
+    set(${result} "${text}" PARENT_SCOPE)
+endfunction()
+
+file(GLOB shaders RELATIVE "${SHADER_DIR}" "${SHADER_DIR}/*.glsl")
+list(SORT shaders)
+set(header "// Generated from the *.glsl files by embed_shaders.cmake; do not edit\n\n")
+set(table "")
+foreach(shader ${shaders})
+    expand_includes("${shader}" 0 source)
+    if(source MATCHES "\\)glsl\"")
+        message(FATAL_ERROR "${shader} contains the raw string delimiter )glsl\"")
+    endif()
+    string(REGEX REPLACE "[^A-Za-z0-9_]" "_" symbol "SHADER_${shader}")
+    set(header "${header}static constexpr char ${symbol}[] = R\"glsl(${source})glsl\";\n\n")
+    set(table "${table}    { \"${shader}\", ${symbol}, sizeof(${symbol}) - 1 },\n")
+endforeach()
+set(header "${header}static constexpr EmbeddedShader EMBEDDED_SHADERS[] = {\n${table}};\n")
+
+file(WRITE "${OUTPUT}" "${header}")
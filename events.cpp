@@ -0,0 +1,294 @@
+#include "events.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+
+const double SUN_RADIUS_AU = 109.0 * AU_PER_EARTH_RADIUS;  //Same ratio as the Sun class in planet.h
+const double TIME_TOLERANCE = 1e-9;  //Years (~0.03 s)
+const int SAMPLES_PER_PERIOD = 32;  //Grid density relative to the shortest orbital period involved in a search
+
+struct EventSearch::Search {
+    EventType type;
+    int observer, a, b;
+    double step;
+    function<double(double)> coarse;  //Coarse separation minus its threshold; windows are only refined where this dips below 0
+    function<double(double)> rate;  //Bound on |d coarse/dt| over [t - step, t + step]
+    function<double(double)> fine;  //Event is in progress while fine(t) < 0
+    function<string(double)> classify;  //Event kind at peak
+};
+
+EventSearch::EventSearch(unsigned numThreads) {
+    pool = new ThreadPool(numThreads);
+    names.push_back("Sun");
+    elements.push_back(OrbitalElements());
+    radii.push_back(SUN_RADIUS_AU);
+    parents.push_back(-1);
+}
+
+EventSearch::~EventSearch() { delete pool; }
+
+int EventSearch::addBody(const string& name, const OrbitalElements& el, double radius, int parent) {
+    names.push_back(name);
+    elements.push_back(el);
+    radii.push_back(radius);
+    parents.push_back(parent > 0 ? parent : 0);
+    return (int) names.size() - 1;
+}
+
+int EventSearch::addPlanet(Planet* p) {
+    return addBody(p->getName(), p->getElements(), p->getRadius() * AU_PER_EARTH_RADIUS);
+}
+
+int EventSearch::addMoon(Moon* m, int parent) {
+    return addBody(m->getName(), m->getElements(), m->getRadius() * AU_PER_EARTH_RADIUS, parent);
+}
+
+void EventSearch::addBodies(const BodyStore& store) {
+    int base = (int) names.size() - 1;  //Store index 0 (the Sun) maps to body 0
+    for(int i = 1; i < store.size(); i++) {
+        int parent = store.parents[i];
+        addBody(store.names[i], store.elements[i], store.radius[i], parent > 0 ? base + parent : -1);
+    }
+}
+
+int EventSearch::findBody(const string& name) {
+    for(int i = 0; i < names.size(); i++) { if(names[i] == name) return i; }
+    return -1;
+}
+
+dvec3 EventSearch::position(int body, double t) {
+    dvec3 pos(0.0);
+    for(int i = body; i > 0; i = parents[i]) { pos += keplerPosition(elements[i], t); }
+    return pos;
+}
+
+double EventSearch::maxSpeed(int body) {
+    double v = 0;
+    for(int i = body; i > 0; i = parents[i]) { v += keplerMaxSpeed(elements[i]); }
+    return v;
+}
+
+double EventSearch::minPeriod(int body) {
+    double p = 1e30;
+    for(int i = body; i > 0; i = parents[i]) { p = min(p, elements[i].period); }
+    return p;
+}
+
+double EventSearch::angularSeparation(int observer, int a, int b, double t) {
+    dvec3 o = position(observer, t);
+    dvec3 u = position(a, t) - o;
+    dvec3 v = position(b, t) - o;
+    return atan2(length(cross(u, v)), dot(u, v));
+}
+
+double EventSearch::angularRadius(int observer, int body, double t) {
+    double d = length(position(body, t) - position(observer, t));
+    return asin(min(1.0, radii[body] / d));
+}
+
+//Golden-section search for the minimum of f on [lo, hi]
+static double minimize(const function<double(double)>& f, double lo, double hi) {
+    const double g = 0.5 * (sqrt(5.0) - 1);
+    double x1 = hi - g*(hi - lo), x2 = lo + g*(hi - lo);
+    double f1 = f(x1), f2 = f(x2);
+    while(hi - lo > TIME_TOLERANCE) {
+        if(f1 < f2) { hi = x2;  x2 = x1;  f2 = f1;  x1 = hi - g*(hi - lo);  f1 = f(x1); }
+        else        { lo = x1;  x1 = x2;  f1 = f2;  x2 = lo + g*(hi - lo);  f2 = f(x2); }
+    }
+    return 0.5 * (lo + hi);
+}
+
+//Bisection for the sign change of f between inside (f < 0) and outside (f >= 0)
+static double findContact(const function<double(double)>& f, double inside, double outside) {
+    while(fabs(outside - inside) > TIME_TOLERANCE) {
+        double mid = 0.5 * (inside + outside);
+        if(f(mid) < 0) inside = mid;
+        else outside = mid;
+    }
+    return 0.5 * (inside + outside);
+}
+
+void EventSearch::scanChunk(const Search& s, double t0, double h, long i0, long i1, vector<Event>& out) {
+    vector<double> g(i1 - i0 + 2);  //Samples i0-1 .. i1
+    for(long i = i0 - 1; i <= i1; i++) { g[i - i0 + 1] = s.coarse(t0 + i*h); }
+
+    for(long i = i0; i < i1; i++) {
+        double prev = g[i - i0], curr = g[i - i0 + 1], next = g[i - i0 + 2];
+        if(!(prev > curr && curr <= next)) continue;  //Not a local minimum of the coarse function
+        double t = t0 + i*h;
+        if(curr - s.rate(t) * h > 0) continue;  //Lipschitz bound: can't reach the threshold anywhere in this window
+
+        double peak = minimize(s.fine, t - h, t + h);
+        if(s.fine(peak) >= 0) continue;
+
+        double start = t - h, end = t + h;
+        for(int k = 0; k < 64 && s.fine(start) < 0; k++) start -= h;
+        for(int k = 0; k < 64 && s.fine(end) < 0; k++) end += h;
+
+        Event ev;
+        ev.type = s.type;
+        ev.observer = s.observer;  ev.a = s.a;  ev.b = s.b;
+        ev.peak = peak;
+        ev.start = findContact(s.fine, peak, start);
+        ev.end = findContact(s.fine, peak, end);
+        ev.separation = angularSeparation(s.observer, s.a, s.b, peak);
+        ev.kind = s.classify(peak);
+        out.push_back(ev);
+    }
+}
+
+vector<Event> EventSearch::run(const Search& s, double t0, double t1) {
+    long n = (long) ceil((t1 - t0) / s.step);
+    vector<Event> found;
+    mutex foundMtx;
+    pool->parallelFor(n + 1, [&](size_t begin, size_t end) {
+        vector<Event> local;
+        scanChunk(s, t0, s.step, (long) begin, (long) end, local);
+        lock_guard<mutex> lock(foundMtx);
+        found.insert(found.end(), local.begin(), local.end());
+    });
+
+    vector<Event> result;
+    for(int i = 0; i < found.size(); i++) {
+        if(found[i].peak >= t0 && found[i].peak <= t1) result.push_back(found[i]);
+    }
+    sort(result.begin(), result.end(), [](const Event& x, const Event& y) { return x.peak < y.peak; });
+    return result;
+}
+
+vector<Event> EventSearch::conjunctions(int observer, int a, int b, double t0, double t1, double maxSep) {
+    Search s;
+    s.type = EVENT_CONJUNCTION;
+    s.observer = observer;  s.a = a;  s.b = b;
+    double step = min(minPeriod(observer), min(minPeriod(a), minPeriod(b))) / SAMPLES_PER_PERIOD;
+    s.step = step;
+    s.coarse = [=](double t) { return angularSeparation(observer, a, b, t) - maxSep; };
+    s.rate = [=](double t) {
+        dvec3 o = position(observer, t);
+        double r = 0;
+        int targets[2] = { a, b };
+        for(int k = 0; k < 2; k++) {
+            double v = maxSpeed(targets[k]) + maxSpeed(observer);
+            double d = length(position(targets[k], t) - o) - v*step;
+            if(d <= 0) return 1e30;
+            r += v / d;
+        }
+        return r;
+    };
+    s.fine = s.coarse;
+    s.classify = [](double) { return string("close"); };
+    return run(s, t0, t1);
+}
+
+vector<Event> EventSearch::transits(int observer, int body, double t0, double t1) {
+    Search s;
+    s.type = EVENT_TRANSIT;
+    s.observer = observer;  s.a = body;  s.b = 0;
+    double step = min(minPeriod(observer), minPeriod(body)) / SAMPLES_PER_PERIOD;
+    s.step = step;
+    function<double(double)> coarse = [=](double t) {
+        return angularSeparation(observer, body, 0, t) - angularRadius(observer, 0, t) - angularRadius(observer, body, t);
+    };
+    s.coarse = coarse;
+    s.rate = [=](double t) {
+        dvec3 o = position(observer, t);
+        double vo = maxSpeed(observer), vb = maxSpeed(body) + vo;
+        double dSun = length(o) - vo*step;
+        double dBody = length(position(body, t) - o) - vb*step;
+        if(dSun <= radii[0] || dBody <= radii[body]) return 1e30;
+        return vo/dSun + vb/dBody + radii[0]*vo/(dSun*dSun) + radii[body]*vb/(dBody*dBody);
+    };
+    s.fine = [=](double t) {
+        dvec3 o = position(observer, t);
+        if(length(position(body, t) - o) > length(o)) return M_PI;  //Behind the Sun
+        return coarse(t);
+    };
+    s.classify = [=](double t) {
+        double inner = angularRadius(observer, 0, t) - angularRadius(observer, body, t);
+        return string(angularSeparation(observer, body, 0, t) < inner ? "full" : "grazing");
+    };
+    return run(s, t0, t1);
+}
+
+vector<Event> EventSearch::solarEclipses(int observer, int moon, double t0, double t1) {
+    Search s;
+    s.type = EVENT_SOLAR_ECLIPSE;
+    s.observer = observer;  s.a = moon;  s.b = 0;
+    double step = min(minPeriod(observer), minPeriod(moon)) / SAMPLES_PER_PERIOD;
+    s.step = step;
+
+    //Coarse bracket: Sun and Moon discs (widened by the observer's parallax) overlap as seen from the observer's center
+    s.coarse = [=](double t) {
+        double d = length(position(moon, t) - position(observer, t));
+        double parallax = asin(min(1.0, radii[observer] / d));
+        return angularSeparation(observer, moon, 0, t) - angularRadius(observer, 0, t) - angularRadius(observer, moon, t) - parallax;
+    };
+    s.rate = [=](double t) {
+        dvec3 o = position(observer, t);
+        double vo = maxSpeed(observer), vm = maxSpeed(moon) + vo;
+        double dSun = length(o) - vo*step;
+        double dMoon = length(position(moon, t) - o) - vm*step;
+        if(dSun <= radii[0] || dMoon <= radii[moon] + radii[observer]) return 1e30;
+        return vo/dSun + vm/dMoon + radii[0]*vo/(dSun*dSun) + (radii[moon] + radii[observer])*vm/(dMoon*dMoon);
+    };
+
+    //Fine: distance of the observer's limb from the edge of the moon's penumbral cone
+    s.fine = [=](double t) {
+        dvec3 m = position(moon, t);
+        dvec3 rel = position(observer, t) - m;
+        double dSM = length(m);
+        dvec3 axis = m / dSM;
+        double L = dot(rel, axis);  //Distance behind the moon along the shadow axis
+        if(L <= 0) return 1.0;
+        double perp = length(rel - axis*L);
+        double penumbra = radii[moon] + L * (radii[0] + radii[moon]) / dSM;
+        return perp - penumbra - radii[observer];
+    };
+    s.classify = [=](double t) {
+        dvec3 m = position(moon, t);
+        dvec3 rel = position(observer, t) - m;
+        double dSM = length(m);
+        dvec3 axis = m / dSM;
+        double L = dot(rel, axis);
+        double perp = length(rel - axis*L);
+        double umbra = radii[moon] - L * (radii[0] - radii[moon]) / dSM;  //Negative past the umbra's apex (antumbra)
+        if(umbra >= 0 && perp < umbra + radii[observer]) return string("total");
+        if(umbra < 0 && perp < -umbra + radii[observer]) return string("annular");
+        return string("partial");
+    };
+    return run(s, t0, t1);
+}
+
+string EventSearch::eventString(const Event& ev) {
+    char buf[256];
+    const char* what = ev.type == EVENT_CONJUNCTION ? "conjunction" : ev.type == EVENT_TRANSIT ? "transit" : "solar eclipse";
+    double minutes = (ev.end - ev.start) * DAYS_PER_YEAR * 24 * 60;
+    snprintf(buf, sizeof(buf), "%s  %-8s %-14s %s/%s from %s  sep %.4f deg  duration %.0f min",
+             formatDate(ev.peak).c_str(), ev.kind.c_str(), what, names[ev.a].c_str(), names[ev.b].c_str(),
+             names[ev.observer].c_str(), ev.separation / DEG_TO_RAD, minutes);
+    return string(buf);
+}
+
+string formatDate(double t) {
+    //Julian day -> Gregorian calendar (Meeus, Astronomical Algorithms ch. 7)
+    double jd = 2451545.0 + t * DAYS_PER_YEAR + 0.5;
+    long Z = (long) floor(jd);
+    double F = jd - Z;
+    long alpha = (long) floor((Z - 1867216.25) / 36524.25);
+    long A = Z + 1 + alpha - alpha/4;
+    long B = A + 1524;
+    long C = (long) floor((B - 122.1) / 365.25);
+    long D = (long) floor(365.25 * C);
+    long E = (long) floor((B - D) / 30.6001);
+    int day = (int) (B - D - (long) floor(30.6001 * E));
+    int month = (int) (E < 14 ? E - 1 : E - 13);
+    int year = (int) (month > 2 ? C - 4716 : C - 4715);
+    int minutes = (int) floor(F * 24 * 60 + 0.5);
+    if(minutes >= 24*60) minutes = 24*60 - 1;
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d", year, month, day, minutes / 60, minutes % 60);
+    return string(buf);
+}
@@ -0,0 +1,77 @@
+#ifndef __EVENTS_H__
+#define __EVENTS_H__
+
+#include "kepler.h"
+#include "planet.h"
+#include "bodystore.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ Event search over a time range (eclipses, transits and conjunctions)
+    - Each search samples a coarse angular-separation function on a fixed grid, brackets its local minima and throws away
+      any window whose Lipschitz lower bound can't reach the event threshold
+    - Surviving windows are refined with golden-section search (closest approach) and bisection (contact times)
+    - The sample grid is split into chunks across a ThreadPool; results are merged and sorted by peak time
+    - Times are in years since J2000 (see kepler.h); body 0 is always the Sun
+ ***/
+
+enum EventType { EVENT_CONJUNCTION, EVENT_TRANSIT, EVENT_SOLAR_ECLIPSE };
+
+struct Event {
+    EventType type;
+    string kind;       //"partial", "total", "annular" for eclipses; "full" or "grazing" for transits
+    int observer, a, b;  //Body indices: a is the nearer/passing body, b the one being passed (the Sun for transits/eclipses)
+    double start, peak, end;  //Contact times (years since J2000)
+    double separation;  //Angular separation at peak (radians)
+};
+
+class ThreadPool;
+
+class EventSearch {
+public:
+    EventSearch(unsigned numThreads = 0);
+    ~EventSearch();
+
+    //Body registration; parent < 0 means the body orbits the Sun. Radius is in AU. Returns the body index
+    int addBody(const string& name, const OrbitalElements& el, double radius, int parent = -1);
+    int addPlanet(Planet* p);
+    int addMoon(Moon* m, int parent);
+    void addBodies(const BodyStore& store);  //Every body after the store's first (the Sun), keeping the store's indices
+
+    int findBody(const string& name);
+    string getName(int body) { return names[body]; }
+
+    dvec3 position(int body, double t);  //Heliocentric ecliptic position (AU)
+
+    //Closest approaches of a and b (as seen from observer) with separation below maxSep (radians)
+    vector<Event> conjunctions(int observer, int a, int b, double t0, double t1, double maxSep);
+    //Passages of body across the Sun's disc as seen from observer
+    vector<Event> transits(int observer, int body, double t0, double t1);
+    //Passages of observer through moon's penumbral shadow cone
+    vector<Event> solarEclipses(int observer, int moon, double t0, double t1);
+
+    string eventString(const Event& ev);
+
+private:
+    struct Search;  //Per-search callbacks (events.cpp)
+
+    vector<Event> run(const Search& s, double t0, double t1);
+    void scanChunk(const Search& s, double t0, double h, long i0, long i1, vector<Event>& out);
+    double angularSeparation(int observer, int a, int b, double t);
+    double angularRadius(int observer, int body, double t);
+    double maxSpeed(int body);
+    double minPeriod(int body);
+
+    vector<string> names;
+    vector<OrbitalElements> elements;
+    vector<double> radii;
+    vector<int> parents;
+    ThreadPool* pool;
+};
+
+string formatDate(double t);  //Calendar date (UT ~ TT) of a time in years since J2000, "YYYY-MM-DD hh:mm"
+
+#endif // __EVENTS_H__
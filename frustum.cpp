@@ -0,0 +1,61 @@
+#include "frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+void ViewFrustum::extract(const mat4& m) {
+    for(int i = 0; i < 4; i++) {  //Angel matrices are row-major: m[3] is the row that makes w
+        planes[0][i] = m[3][i] + m[0][i];  //Left
+        planes[1][i] = m[3][i] - m[0][i];  //Right
+        planes[2][i] = m[3][i] + m[1][i];  //Bottom
+        planes[3][i] = m[3][i] - m[1][i];  //Top
+        planes[4][i] = m[3][i] + m[2][i];  //Near
+        planes[5][i] = m[3][i] - m[2][i];  //Far
+    }
+    for(int p = 0; p < 6; p++) {
+        GLfloat len = sqrt(planes[p][0]*planes[p][0] + planes[p][1]*planes[p][1] + planes[p][2]*planes[p][2]);
+        if(len > 0) { for(int i = 0; i < 4; i++) planes[p][i] /= len; }
+    }
+}
+
+static inline bool sphereVisible(const ViewFrustum& f, GLfloat x, GLfloat y, GLfloat z, GLfloat r) {
+    for(int p = 0; p < 6; p++) {
+        const GLfloat* pl = f.planes[p];
+        if(pl[0]*x + pl[1]*y + pl[2]*z + pl[3] < -r) return false;
+    }
+    return true;
+}
+
+size_t cullSpheres(const ViewFrustum& f, const GLfloat* x, const GLfloat* y, const GLfloat* z, const GLfloat* r, const int* ids,
+                   size_t n, vector<int>& visible) {
+    size_t start = visible.size();
+    size_t i = 0;
+#ifdef FRUSTUM_SSE
+    __m128 pa[6], pb[6], pc[6], pd[6];
+    for(int p = 0; p < 6; p++) {
+        pa[p] = _mm_set1_ps(f.planes[p][0]);  pb[p] = _mm_set1_ps(f.planes[p][1]);
+        pc[p] = _mm_set1_ps(f.planes[p][2]);  pd[p] = _mm_set1_ps(f.planes[p][3]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for(; i + 4 <= n; i += 4) {
+        __m128 sx = _mm_loadu_ps(x + i), sy = _mm_loadu_ps(y + i), sz = _mm_loadu_ps(z + i);
+        __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(r + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p], sx), _mm_mul_ps(pb[p], sy)),
+                                  _mm_add_ps(_mm_mul_ps(pc[p], sz), pd[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for(int bit = 0; mask != 0; bit++, mask >>= 1) {  //Four lanes; no bit-scan builtin needed (MSVC has none)
+            if(mask & 1) visible.push_back(ids[i + bit]);
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        if(sphereVisible(f, x[i], y[i], z[i], r[i])) visible.push_back(ids[i]);
+    }
+    return visible.size() - start;
+}
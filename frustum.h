@@ -0,0 +1,27 @@
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__
+
+#include "Angel-yjc.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ View-frustum culling of bounding spheres
+    - ViewFrustum::extract() takes the six planes straight from a projection * view matrix (Gribb-Hartmann), normalized so
+      plane distances are in world units
+    - cullSpheres() tests structure-of-arrays spheres four per iteration with SSE2 (plain loop elsewhere) and appends the
+      ids of those touching the frustum to the output list
+ ***/
+
+struct ViewFrustum {
+    GLfloat planes[6][4];  //a, b, c, d with a*x + b*y + c*z + d >= 0 inside: left, right, bottom, top, near, far
+
+    void extract(const mat4& m);
+};
+
+//Returns the number of ids appended to visible
+size_t cullSpheres(const ViewFrustum& f, const GLfloat* x, const GLfloat* y, const GLfloat* z, const GLfloat* r, const int* ids,
+                   size_t n, vector<int>& visible);
+
+#endif // __FRUSTUM_H__
@@ -0,0 +1,26 @@
+/*****************************
+ * File: fshader.glsl
+ *   Adds the direct light, dimmed by the Sun's shadow map (shadow.h),
+ *   to the ambient term, times the surface map of textured bodies
+ *   (texturestream.h)
+ *****************************/
+
+#version 330
+
+in  vec4 ambientColor;
+in  vec4 directColor;
+in  vec3 lightToVertex;
+in  vec2 texCoord;
+flat in int textured;
+out vec4 fColor;
+
+#include "shadowing.glsl"
+
+uniform sampler2D SurfaceMap;  // SURFACE_TEXTURE_UNIT
+
+void main()
+{
+    vec4 surface = textured != 0 ? texture(SurfaceMap, texCoord) : vec4(1.0);  // Same for the whole draw
+    fColor = (ambientColor + shadowFactor(lightToVertex) * directColor) * surface;
+    fColor.a = 1.0;
+}
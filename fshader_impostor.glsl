@@ -0,0 +1,40 @@
+/*****************************
+ * File: fshader_impostor.glsl
+ *   Ray-casts the sphere of an impostor (impostors.h) and shades the hit
+ *   as fshader.glsl shades a mesh, writing the sphere's own depth.
+ *   The ray is worked out around the sphere's center, in its radii, so
+ *   a speck far away keeps its precision
+ *****************************/
+
+#version 330
+
+in vec2 quadCoord;
+flat in vec4 sphere;
+flat in mat3 basis;
+flat in vec4 ambientProduct, diffuseProduct, specularProduct;
+out vec4 fColor;
+
+#include "lighting.glsl"
+#include "shadowing.glsl"
+
+void main()
+{
+    // The camera is d radii behind the center along basis[2]; the ray passes through the quad point q
+    vec3 q = vec3(quadCoord, 0.0);
+    vec3 dir = normalize(vec3(quadCoord, length(sphere.xyz) / sphere.w));
+    vec3 closest = q - dot(q, dir) * dir;  // Point of the ray nearest the center
+    float miss = dot(closest, closest);
+    if (miss > 1.0) discard;
+    vec3 normal = basis * (closest - sqrt(1.0 - miss) * dir);  // Nearer hit, on the unit sphere
+    vec3 pos = sphere.xyz + normal * sphere.w;
+
+    vec4 clip = projection * vec4(pos, 1.0);
+    gl_FragDepth = (clip.z / clip.w) * 0.5 + 0.5;
+
+    vec4 ambientColor, directColor;
+    vec3 lightToVertex;
+    shade(vec4(pos, 1.0), normal, mat4(1.0), mat3(1.0), ambientProduct, diffuseProduct, specularProduct,
+          ambientColor, directColor, lightToVertex);
+    fColor = ambientColor + shadowFactor(lightToVertex) * directColor;
+    fColor.a = 1.0;
+}
@@ -0,0 +1,14 @@
+/*****************************
+ * File: fshader_overlay.glsl
+ *   Overlay quads, alpha blended
+ *****************************/
+
+#version 330
+
+in  vec4 color;
+out vec4 fColor;
+
+void main()
+{
+    fColor = color;
+}
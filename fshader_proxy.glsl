@@ -0,0 +1,10 @@
+/*****************************
+ * File: fshader_proxy.glsl
+ *   Occlusion proxies write nothing; only their samples are counted
+ *****************************/
+
+#version 330
+
+void main()
+{
+}
@@ -0,0 +1,15 @@
+/*****************************
+ * File: fshader_rings.glsl
+ *   Round ring particle sprites, alpha blended
+ *****************************/
+
+#version 330
+
+in  vec4 color;
+out vec4 fColor;
+
+void main()
+{
+    if (length(gl_PointCoord - vec2(0.5)) > 0.5) discard;  // Only matters once sprites grow past a pixel
+    fColor = color;
+}
@@ -0,0 +1,10 @@
+/*****************************
+ * File: fshader_shadow.glsl
+ *   Shadow pass: depth only
+ *****************************/
+
+#version 330
+
+void main()
+{
+}
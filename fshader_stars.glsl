@@ -0,0 +1,16 @@
+/*****************************
+ * File: fshader_stars.glsl
+ *   Round star sprites with soft edges, added to the background
+ *****************************/
+
+#version 330
+
+in  vec4 color;
+out vec4 fColor;
+
+void main()
+{
+    float r = length(gl_PointCoord - vec2(0.5));
+    if (r > 0.5) discard;  // Only matters once sprites grow past a pixel
+    fColor = vec4(color.rgb, color.a * (1.0 - smoothstep(0.25, 0.5, r)));
+}
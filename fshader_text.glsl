@@ -0,0 +1,26 @@
+/*****************************
+ * File: fshader_text.glsl
+ *   Glyph pixels from the atlas in the text color, with a dark shadow
+ *   one font pixel down and to the right; the rest of the cell is
+ *   discarded
+ *****************************/
+
+#version 330
+
+in vec2 cellCoord;
+flat in ivec2 cellOrigin;
+flat in vec4 color;
+out vec4 fColor;
+
+uniform sampler2D Atlas;
+
+void main()
+{
+    ivec2 p = clamp(ivec2(floor(cellCoord)), ivec2(0), ivec2(5, 7));
+    if(texelFetch(Atlas, cellOrigin + p, 0).r > 0.5)
+        fColor = color;
+    else if(p.x > 0 && p.y > 0 && texelFetch(Atlas, cellOrigin + p - 1, 0).r > 0.5)
+        fColor = vec4(0.0, 0.0, 0.0, color.a * 0.8);
+    else
+        discard;
+}
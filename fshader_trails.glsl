@@ -0,0 +1,14 @@
+/*****************************
+ * File: fshader_trails.glsl
+ *   Trail lines, faded by age in vshader_trails.glsl
+ *****************************/
+
+#version 330
+
+in  vec4 color;
+out vec4 fColor;
+
+void main()
+{
+    fColor = color;
+}
@@ -0,0 +1,32 @@
+/*****************************
+ * File: fshader_upscale.glsl
+ *   Scales the scene up to the window: bilinear, then sharpened with
+ *   an unsharp mask over the four neighbors one scene texel away
+ *****************************/
+
+#version 330
+
+in  vec2 texCoord;
+out vec4 fColor;
+
+uniform sampler2D Scene;
+uniform vec2 Region;     // Part of the texture drawn this frame
+uniform vec2 Texel;      // Size of a scene texel
+uniform float Sharpness; // 0: plain bilinear
+
+vec3 scene(vec2 uv)
+{
+    // Never past the drawn part's edge texels, where the texture holds stale pixels
+    return texture(Scene, clamp(uv, Texel * 0.5, Region - Texel * 0.5)).rgb;
+}
+
+void main()
+{
+    vec3 c = scene(texCoord);
+    if(Sharpness > 0.0) {
+        vec3 blur = (scene(texCoord + vec2(Texel.x, 0.0)) + scene(texCoord - vec2(Texel.x, 0.0)) +
+                     scene(texCoord + vec2(0.0, Texel.y)) + scene(texCoord - vec2(0.0, Texel.y))) * 0.25;
+        c = clamp(c + (c - blur) * Sharpness, 0.0, 1.0);
+    }
+    fColor = vec4(c, 1.0);
+}
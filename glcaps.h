@@ -0,0 +1,30 @@
+#ifndef __GLCAPS_H__
+#define __GLCAPS_H__
+
+#include "Angel-yjc.h"
+#include <cstring>
+
+/***
+ Capability queries for optional render paths
+    - Asks the current context directly (glGetIntegerv/glGetStringi) rather than relying on GLEW's flags, which macOS
+      doesn't have; call only with a current context
+ ***/
+
+inline bool hasGLVersion(int major, int minor) {
+    GLint maj = 0, min = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &maj);
+    glGetIntegerv(GL_MINOR_VERSION, &min);
+    return maj > major || (maj == major && min >= minor);
+}
+
+inline bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(GLint i = 0; i < count; i++) {
+        const char* ext = (const char*) glGetStringi(GL_EXTENSIONS, i);
+        if(ext != NULL && strcmp(ext, name) == 0) return true;
+    }
+    return false;
+}
+
+#endif // __GLCAPS_H__
@@ -0,0 +1,31 @@
+/***************************
+ * File: gshader_shadow.glsl:
+ *   Shadow pass: sends each triangle to every shadow map layer whose
+ *   face frustum its caster touches, all in one draw
+ ****************************/
+
+#version 330
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 18) out;  // Up to six faces
+
+layout(std140, row_major) uniform Shadow {  // Same block as fshader.glsl
+    mat4 FaceMatrix[6];
+    int ActiveFaces;
+};
+
+in vec3 lightToVertex[];
+flat in int faceMask[];
+
+void main()
+{
+    for (int face = 0; face < 6; face++) {
+        if ((faceMask[0] & (1 << face)) == 0) continue;
+        for (int i = 0; i < 3; i++) {
+            gl_Layer = face;
+            gl_Position = FaceMatrix[face] * vec4(lightToVertex[i], 1.0);
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
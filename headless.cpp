@@ -0,0 +1,132 @@
+#include "headless.h"
+
+#ifndef __APPLE__
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+HeadlessContext::HeadlessContext() : display(NULL), context(NULL), surface(NULL), fbo(0), colorBuf(0), depthBuf(0), width(0), height(0) {}
+
+#ifdef __APPLE__
+
+HeadlessContext::~HeadlessContext() {}
+
+bool HeadlessContext::create() {
+    std::cerr << "Headless rendering needs EGL, which is not available on macOS" << std::endl;
+    return false;
+}
+
+#else
+
+static bool hasExtension(const char* list, const char* name) {
+    if(list == NULL) return false;
+    size_t len = strlen(name);
+    for(const char* p = strstr(list, name); p != NULL; p = strstr(p + len, name)) {
+        if((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) return true;
+    }
+    return false;
+}
+
+HeadlessContext::~HeadlessContext() {
+    if(fbo != 0) {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &colorBuf);
+        glDeleteRenderbuffers(1, &depthBuf);
+    }
+    if(display != NULL) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(surface != NULL) eglDestroySurface(display, surface);
+        if(context != NULL) eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+}
+
+bool HeadlessContext::create() {
+    //Surfaceless platform first: it needs no X server, GPU or DRM device
+    const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    if(getPlatformDisplay != NULL && hasExtension(clientExts, "EGL_MESA_platform_surfaceless"))
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    EGLint major, minor;
+    if(dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if(dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+            std::cerr << "Headless: no EGL display could be initialized" << std::endl;
+            return false;
+        }
+    }
+    display = dpy;
+
+    const char* exts = eglQueryString(dpy, EGL_EXTENSIONS);
+    bool surfaceless = hasExtension(exts, "EGL_KHR_surfaceless_context");
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if(!eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        std::cerr << "Headless: no EGL config supports desktop OpenGL" << std::endl;
+        return false;
+    }
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Headless: EGL can't bind the desktop OpenGL API" << std::endl;
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {  //EGL_KHR_create_context names, same values as the EGL 1.5 ones
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    context = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+    if(context == EGL_NO_CONTEXT) {
+        context = NULL;
+        std::cerr << "Headless: could not create an OpenGL 3.2 core context" << std::endl;
+        return false;
+    }
+
+    if(!surfaceless) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+        if(surface == EGL_NO_SURFACE) {
+            surface = NULL;
+            std::cerr << "Headless: could not create a pbuffer surface" << std::endl;
+            return false;
+        }
+    }
+    EGLSurface s = surface ? (EGLSurface) surface : EGL_NO_SURFACE;
+    if(!eglMakeCurrent(dpy, s, s, context)) {
+        std::cerr << "Headless: could not make the context current" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif  // __APPLE__
+
+bool HeadlessContext::createFramebuffer(int w, int h) {
+    width = w;  height = h;
+    glGenRenderbuffers(1, &colorBuf);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuf);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+    glGenRenderbuffers(1, &depthBuf);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuf);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuf);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuf);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Headless: the " << w << "x" << h << " framebuffer is incomplete" << std::endl;
+        return false;
+    }
+    return true;
+}
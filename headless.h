@@ -0,0 +1,33 @@
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include "Angel-yjc.h"
+
+/***
+ Offscreen OpenGL context for rendering without a window or display server
+    - EGL on Mesa's surfaceless platform (llvmpipe when there is no GPU), falling back to the default EGL display
+    - Asks for a 3.2 core context, like the GLUT window, and makes it current without a surface when
+      EGL_KHR_surfaceless_context is available, otherwise on a 1x1 pbuffer
+    - Everything is drawn into a framebuffer object of any size (color + depth renderbuffers)
+    - Not available on macOS (no EGL); create() reports the failure
+ ***/
+class HeadlessContext {
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    //Creates the context and makes it current; call createFramebuffer() once GL functions are loaded (glewInit)
+    bool create();
+    bool createFramebuffer(int width, int height);  //Leaves the framebuffer bound
+
+    GLuint framebuffer() const { return fbo; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    void *display, *context, *surface;  //EGLDisplay, EGLContext, EGLSurface
+    GLuint fbo, colorBuf, depthBuf;
+    int width, height;
+};
+
+#endif // __HEADLESS_H__
@@ -0,0 +1,409 @@
+#include "image.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+//------------------------------------------------------------------------------------------------------------------------
+//  Inflate (RFC 1951): stored, fixed and dynamic Huffman blocks, decoded one bit at a time with canonical code tables
+
+struct Huffman {
+    short count[16];    //Codes of each length
+    short symbol[288];  //Symbols ordered by code
+};
+
+struct Inflater {
+    const unsigned char* in;
+    size_t inSize, inPos;
+    unsigned long bitBuf;
+    int bitCount;
+    bool bad;
+    vector<unsigned char>& out;
+
+    Inflater(const unsigned char* data, size_t size, vector<unsigned char>& o)
+        : in(data), inSize(size), inPos(0), bitBuf(0), bitCount(0), bad(false), out(o) {}
+
+    int bits(int need) {
+        unsigned long val = bitBuf;
+        while(bitCount < need) {
+            if(inPos >= inSize) { bad = true;  return 0; }
+            val |= (unsigned long) in[inPos++] << bitCount;
+            bitCount += 8;
+        }
+        bitBuf = val >> need;
+        bitCount -= need;
+        return (int) (val & ((1UL << need) - 1));
+    }
+
+    //False if the lengths over-subscribe the code (an incomplete code is allowed, as zlib does)
+    static bool build(Huffman& h, const short* lengths, int n) {
+        memset(h.count, 0, sizeof(h.count));
+        for(int i = 0; i < n; i++) h.count[lengths[i]]++;
+        if(h.count[0] == n) return true;
+        int left = 1;
+        for(int len = 1; len < 16; len++) {
+            left = left * 2 - h.count[len];
+            if(left < 0) return false;
+        }
+        short offsets[16];
+        offsets[1] = 0;
+        for(int len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + h.count[len];
+        for(int i = 0; i < n; i++) { if(lengths[i] != 0) h.symbol[offsets[lengths[i]]++] = (short) i; }
+        return true;
+    }
+
+    int decode(const Huffman& h) {
+        int code = 0, first = 0, index = 0;
+        for(int len = 1; len < 16; len++) {
+            code |= bits(1);
+            int count = h.count[len];
+            if(code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+            if(bad) return -1;
+        }
+        return -1;
+    }
+
+    bool stored() {
+        bitBuf = 0;  bitCount = 0;  //Byte aligned
+        if(inPos + 4 > inSize) return false;
+        unsigned len = in[inPos] | (in[inPos + 1] << 8);
+        unsigned nlen = in[inPos + 2] | (in[inPos + 3] << 8);
+        inPos += 4;
+        if(len != (~nlen & 0xffff) || inPos + len > inSize) return false;
+        out.insert(out.end(), in + inPos, in + inPos + len);
+        inPos += len;
+        return true;
+    }
+
+    bool codes(const Huffman& lencode, const Huffman& distcode) {
+        static const short lbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const short lext[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const short dbase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                         1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const short dext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+                                        12, 12, 13, 13 };
+        for(;;) {
+            int symbol = decode(lencode);
+            if(symbol < 0 || bad) return false;
+            if(symbol < 256) { out.push_back((unsigned char) symbol);  continue; }
+            if(symbol == 256) return true;
+            symbol -= 257;
+            if(symbol >= 29) return false;
+            size_t len = lbase[symbol] + bits(lext[symbol]);
+            symbol = decode(distcode);
+            if(symbol < 0 || symbol >= 30) return false;
+            size_t dist = dbase[symbol] + bits(dext[symbol]);
+            if(bad || dist > out.size()) return false;
+            size_t from = out.size() - dist;
+            for(size_t i = 0; i < len; i++) out.push_back(out[from + i]);  //May overlap what it writes
+        }
+    }
+
+    bool fixed() {
+        short lengths[288 + 30];
+        int i = 0;
+        for(; i < 144; i++) lengths[i] = 8;
+        for(; i < 256; i++) lengths[i] = 9;
+        for(; i < 280; i++) lengths[i] = 7;
+        for(; i < 288; i++) lengths[i] = 8;
+        for(; i < 288 + 30; i++) lengths[i] = 5;
+        Huffman lencode, distcode;  //Rebuilt per block: cheap, and nothing is shared between worker threads
+        build(lencode, lengths, 288);
+        build(distcode, lengths + 288, 30);
+        return codes(lencode, distcode);
+    }
+
+    bool dynamic() {
+        static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        int nlen = bits(5) + 257, ndist = bits(5) + 1, ncode = bits(4) + 4;
+        if(bad || nlen > 286 || ndist > 30) return false;
+        short lengths[320];
+        int i = 0;
+        for(; i < ncode; i++) lengths[order[i]] = (short) bits(3);
+        for(; i < 19; i++) lengths[order[i]] = 0;
+        Huffman lencode, distcode;
+        if(!build(lencode, lengths, 19)) return false;
+
+        for(i = 0; i < nlen + ndist; ) {
+            int symbol = decode(lencode);
+            if(symbol < 0 || bad) return false;
+            if(symbol < 16) { lengths[i++] = (short) symbol;  continue; }
+            short len = 0;
+            int repeat;
+            if(symbol == 16) {
+                if(i == 0) return false;
+                len = lengths[i - 1];
+                repeat = 3 + bits(2);
+            }
+            else if(symbol == 17) repeat = 3 + bits(3);
+            else repeat = 11 + bits(7);
+            if(i + repeat > nlen + ndist) return false;
+            while(repeat--) lengths[i++] = len;
+        }
+        if(lengths[256] == 0) return false;  //No end-of-block code
+        if(!build(lencode, lengths, nlen) || !build(distcode, lengths + nlen, ndist)) return false;
+        return codes(lencode, distcode);
+    }
+
+    bool run() {
+        int last;
+        do {
+            last = bits(1);
+            int type = bits(2);
+            bool ok = type == 0 ? stored() : type == 1 ? fixed() : type == 2 ? dynamic() : false;
+            if(!ok || bad) return false;
+        } while(!last);
+        return true;
+    }
+};
+
+//zlib stream (RFC 1950); neither the Adler-32 trailer nor the PNG chunk CRCs are checked: damage shows up as a
+//decoding error or short output instead
+static bool zlibInflate(const unsigned char* data, size_t size, vector<unsigned char>& out) {
+    if(size < 2 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) return false;
+    Inflater inflater(data + 2, size - 2, out);
+    return inflater.run();
+}
+
+//------------------------------------------------------------------------------------------------------------------------
+//  PNG
+
+static unsigned long readBE32(const unsigned char* p) {
+    return ((unsigned long) p[0] << 24) | ((unsigned long) p[1] << 16) | ((unsigned long) p[2] << 8) | p[3];
+}
+
+static int paeth(int a, int b, int c) {
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+static bool decodePNG(const string& path, const unsigned char* data, size_t size, Image& image) {
+    static const unsigned char SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    if(size < 8 || memcmp(data, SIGNATURE, 8) != 0) {
+        cerr << "Image " << path << ": not a PNG file" << endl;
+        return false;
+    }
+    int width = 0, height = 0, depth = 0, colorType = -1, interlace = 0;
+    vector<unsigned char> idat, palette, alpha;
+    for(size_t pos = 8; pos + 12 <= size; ) {
+        size_t length = readBE32(data + pos);
+        const unsigned char* type = data + pos + 4;
+        const unsigned char* body = data + pos + 8;
+        if(pos + 12 + length > size) break;
+        if(memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            width = (int) readBE32(body);  height = (int) readBE32(body + 4);
+            depth = body[8];  colorType = body[9];  interlace = body[12];
+        }
+        else if(memcmp(type, "PLTE", 4) == 0) palette.assign(body, body + length);
+        else if(memcmp(type, "tRNS", 4) == 0) alpha.assign(body, body + length);
+        else if(memcmp(type, "IDAT", 4) == 0) idat.insert(idat.end(), body, body + length);
+        else if(memcmp(type, "IEND", 4) == 0) break;
+        pos += 12 + length;
+    }
+
+    int channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 3 ? 1 : colorType == 4 ? 2 : colorType == 6 ? 4 : 0;
+    bool supported = channels > 0 && width > 0 && height > 0 && interlace == 0
+                     && (depth == 8 || (depth == 16 && colorType != 3));
+    if(!supported) {
+        cerr << "Image " << path << ": unsupported PNG (color type " << colorType << ", " << depth << "-bit"
+             << (interlace ? ", interlaced" : "") << ")" << endl;
+        return false;
+    }
+
+    size_t bpp = channels * depth / 8;  //Bytes per pixel
+    size_t stride = bpp * width;
+    vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    if(!zlibInflate(idat.empty() ? NULL : &idat[0], idat.size(), raw) || raw.size() < (stride + 1) * height) {
+        cerr << "Image " << path << ": corrupt PNG data" << endl;
+        return false;
+    }
+
+    //Undo the row filters in place; each row is preceded by its filter type
+    vector<unsigned char> zero(stride, 0);
+    for(int y = 0; y < height; y++) {
+        unsigned char* row = &raw[y * (stride + 1) + 1];
+        const unsigned char* prior = y > 0 ? row - (stride + 1) : &zero[0];
+        switch(row[-1]) {
+            case 0: break;
+            case 1: for(size_t i = bpp; i < stride; i++) row[i] += row[i - bpp];  break;
+            case 2: for(size_t i = 0; i < stride; i++) row[i] += prior[i];  break;
+            case 3:
+                for(size_t i = 0; i < stride; i++) row[i] += ((i >= bpp ? row[i - bpp] : 0) + prior[i]) / 2;
+                break;
+            case 4:
+                for(size_t i = 0; i < stride; i++)
+                    row[i] += paeth(i >= bpp ? row[i - bpp] : 0, prior[i], i >= bpp ? prior[i - bpp] : 0);
+                break;
+            default:
+                cerr << "Image " << path << ": bad PNG filter type " << (int) row[-1] << endl;
+                return false;
+        }
+    }
+
+    image.width = width;  image.height = height;
+    image.pixels.resize((size_t) width * height * 4);
+    size_t step = depth / 8;  //16-bit samples keep their high (first) byte
+    for(int y = 0; y < height; y++) {
+        const unsigned char* src = &raw[y * (stride + 1) + 1];
+        unsigned char* dst = &image.pixels[(size_t) y * width * 4];
+        for(int x = 0; x < width; x++, src += bpp, dst += 4) {
+            switch(colorType) {
+                case 0: dst[0] = dst[1] = dst[2] = src[0];  dst[3] = 255;  break;
+                case 2: dst[0] = src[0];  dst[1] = src[step];  dst[2] = src[2 * step];  dst[3] = 255;  break;
+                case 3: {
+                    size_t i = src[0];
+                    bool inPalette = i * 3 + 2 < palette.size();
+                    dst[0] = inPalette ? palette[i * 3] : 0;
+                    dst[1] = inPalette ? palette[i * 3 + 1] : 0;
+                    dst[2] = inPalette ? palette[i * 3 + 2] : 0;
+                    dst[3] = i < alpha.size() ? alpha[i] : 255;
+                    break;
+                }
+                case 4: dst[0] = dst[1] = dst[2] = src[0];  dst[3] = src[step];  break;
+                case 6: dst[0] = src[0];  dst[1] = src[step];  dst[2] = src[2 * step];  dst[3] = src[3 * step];  break;
+            }
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------
+//  PPM (binary P6)
+
+static bool decodePPM(const string& path, const unsigned char* data, size_t size, Image& image) {
+    size_t pos = 2;
+    long values[3];
+    for(int k = 0; k < 3; k++) {
+        for(;;) {  //Whitespace and comments
+            while(pos < size && isspace(data[pos])) pos++;
+            if(pos < size && data[pos] == '#') { while(pos < size && data[pos] != '\n') pos++; }
+            else break;
+        }
+        values[k] = 0;
+        size_t start = pos;
+        while(pos < size && isdigit(data[pos]) && pos - start < 9) values[k] = values[k] * 10 + (data[pos++] - '0');
+        if(pos == start) values[k] = 0;
+    }
+    pos++;  //A single whitespace byte ends the header
+    long width = values[0], height = values[1], maxval = values[2];
+    size_t sampleBytes = maxval > 255 ? 2 : 1;
+    if(width <= 0 || height <= 0 || maxval <= 0 || maxval > 65535 || pos + (size_t) width * height * 3 * sampleBytes > size) {
+        cerr << "Image " << path << ": bad PPM header or truncated data" << endl;
+        return false;
+    }
+    image.width = (int) width;  image.height = (int) height;
+    image.pixels.resize((size_t) width * height * 4);
+    const unsigned char* src = data + pos;
+    for(size_t i = 0; i < (size_t) width * height; i++) {
+        for(int c = 0; c < 3; c++, src += sampleBytes) {
+            long v = sampleBytes == 2 ? (src[0] << 8) | src[1] : src[0];
+            image.pixels[i * 4 + c] = (unsigned char) (v * 255 / maxval);
+        }
+        image.pixels[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+bool loadImage(const string& path, Image& image) {
+    MappedFile file;
+    if(!file.open(path)) {
+        cerr << "Failed to map image " << path << endl;
+        return false;
+    }
+    const unsigned char* data = (const unsigned char*) file.data;
+    if(file.size >= 2 && data[0] == 'P' && data[1] == '6') return decodePPM(path, data, file.size, image);
+    return decodePNG(path, data, file.size, image);
+}
+
+//------------------------------------------------------------------------------------------------------------------------
+//  Mip levels and BC1
+
+void halveImage(const Image& src, Image& dst) {
+    dst.width = max(src.width / 2, 1);
+    dst.height = max(src.height / 2, 1);
+    dst.pixels.resize((size_t) dst.width * dst.height * 4);
+    for(int y = 0; y < dst.height; y++) {
+        const unsigned char* row0 = &src.pixels[(size_t) min(2 * y, src.height - 1) * src.width * 4];
+        const unsigned char* row1 = &src.pixels[(size_t) min(2 * y + 1, src.height - 1) * src.width * 4];
+        unsigned char* out = &dst.pixels[(size_t) y * dst.width * 4];
+        for(int x = 0; x < dst.width; x++) {
+            size_t x0 = (size_t) min(2 * x, src.width - 1) * 4, x1 = (size_t) min(2 * x + 1, src.width - 1) * 4;
+            for(int c = 0; c < 4; c++)
+                out[x * 4 + c] = (unsigned char) ((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+    }
+}
+
+static unsigned pack565(const int* c) {
+    return ((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255);
+}
+
+static void unpack565(unsigned v, int* c) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);  c[1] = (g << 2) | (g >> 4);  c[2] = (b << 3) | (b >> 2);
+}
+
+void compressBC1(const Image& src, vector<unsigned char>& blocks) {
+    int bw = (src.width + 3) / 4, bh = (src.height + 3) / 4;
+    blocks.resize((size_t) bw * bh * 8);
+    unsigned char* out = &blocks[0];
+    for(int by = 0; by < bh; by++) {
+        for(int bx = 0; bx < bw; bx++, out += 8) {
+            int px[16][3];
+            int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+            for(int k = 0; k < 16; k++) {  //Edge blocks repeat the last row/column
+                int x = min(bx * 4 + (k & 3), src.width - 1), y = min(by * 4 + (k >> 2), src.height - 1);
+                const unsigned char* p = &src.pixels[((size_t) y * src.width + x) * 4];
+                for(int c = 0; c < 3; c++) {
+                    px[k][c] = p[c];
+                    lo[c] = min(lo[c], (int) p[c]);  hi[c] = max(hi[c], (int) p[c]);
+                    mean[c] += p[c];
+                }
+            }
+            //Pick the box diagonal the colors run along: flip green/blue when they fall while red rises
+            int covG = 0, covB = 0;
+            for(int k = 0; k < 16; k++) {
+                int dr = px[k][0] * 16 - mean[0];
+                covG += dr * (px[k][1] * 16 - mean[1]) / 256;
+                covB += dr * (px[k][2] * 16 - mean[2]) / 256;
+            }
+            if(covG < 0) swap(lo[1], hi[1]);
+            if(covB < 0) swap(lo[2], hi[2]);
+            for(int c = 0; c < 3; c++) {  //Inset the endpoints by 1/16 of the range, like the usual real-time encoders
+                int inset = (hi[c] - lo[c]) / 16;
+                hi[c] -= inset;  lo[c] += inset;
+            }
+
+            unsigned c0 = pack565(hi), c1 = pack565(lo);
+            if(c0 < c1) swap(c0, c1);  //c0 > c1 selects the four-color mode
+            unsigned indices = 0;
+            if(c0 != c1) {
+                int palette[4][3];
+                unpack565(c0, palette[0]);
+                unpack565(c1, palette[1]);
+                for(int c = 0; c < 3; c++) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                for(int k = 0; k < 16; k++) {
+                    int best = 0, bestDist = 1 << 30;
+                    for(int i = 0; i < 4; i++) {
+                        int dr = px[k][0] - palette[i][0], dg = px[k][1] - palette[i][1], db = px[k][2] - palette[i][2];
+                        int dist = dr * dr + dg * dg + db * db;
+                        if(dist < bestDist) { bestDist = dist;  best = i; }
+                    }
+                    indices |= (unsigned) best << (2 * k);
+                }
+            }
+            out[0] = c0 & 0xff;  out[1] = c0 >> 8;  out[2] = c1 & 0xff;  out[3] = c1 >> 8;
+            for(int i = 0; i < 4; i++) out[4 + i] = (indices >> (8 * i)) & 0xff;
+        }
+    }
+}
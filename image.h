@@ -0,0 +1,29 @@
+#ifndef __IMAGE_H__
+#define __IMAGE_H__
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ CPU side of texture loading, safe to run on worker threads (no GL calls)
+    - loadImage() decodes 8- or 16-bit non-interlaced PNG (its own inflate, so there is no zlib dependency) and binary
+      PPM (P6) into RGBA8, top row first; other formats fail with a message on cerr
+    - halveImage() makes the next mip level with a 2x2 box filter (odd sizes clamp at the last row/column)
+    - compressBC1() encodes RGBA8 as BC1/DXT1 4x4 blocks (GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8 bytes per block,
+      alpha dropped): each block's endpoints are the corners of its color bounding box along the dominant diagonal
+ ***/
+
+struct Image {
+    int width, height;
+    vector<unsigned char> pixels;  //RGBA8, top row first
+    Image() : width(0), height(0) {}
+};
+
+bool loadImage(const string& path, Image& image);
+void halveImage(const Image& src, Image& dst);
+void compressBC1(const Image& src, vector<unsigned char>& blocks);
+inline size_t bc1Size(int width, int height) { return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * 8; }
+
+#endif // __IMAGE_H__
@@ -0,0 +1,55 @@
+#include "impostors.h"
+
+void ImpostorBatch::init(ProgramCache& programs) {
+    glGenVertexArrays(1, &vao);  //Attributes pointed at the frame's instances by draw()
+    glBindVertexArray(vao);
+    for(GLuint a = 0; a < 4; a++) {
+        glEnableVertexAttribArray(a);
+        glVertexAttribDivisor(a, 1);
+    }
+    glBindVertexArray(0);
+    build = programs.request("vshader_impostor.glsl", "fshader_impostor.glsl");
+}
+
+bool ImpostorBatch::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    UniformCache uniforms;
+    uniforms.reflect(program);
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    uniforms.bindBlock("Shadow", SHADOW_BINDING);
+    glUseProgram(program);
+    glUniform1i(uniforms.location("ShadowMap"), SHADOW_TEXTURE_UNIT);
+    return true;
+}
+
+void ImpostorBatch::add(const vec3& center, GLfloat radius, const vec4& ambient, const vec4& diffuse,
+                        const vec4& specular) {
+    Instance inst;
+    inst.sphere = vec4(center, radius);
+    inst.ambient = ambient;
+    inst.diffuse = diffuse;
+    inst.specular = specular;
+    instances.push_back(inst);
+}
+
+void ImpostorBatch::draw(DynamicBuffer& stream) {
+    if(instances.empty()) return;
+    DynamicSlice slice = stream.upload(&instances[0], sizeof(Instance) * instances.size(), 16);
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slice.buffer);
+    for(GLuint a = 0; a < 4; a++)
+        glVertexAttribPointer(a, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), BUFFER_OFFSET(slice.offset + a * sizeof(vec4)));
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) instances.size());
+    glBindVertexArray(0);
+
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
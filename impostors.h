@@ -0,0 +1,52 @@
+#ifndef __IMPOSTORS_H__
+#define __IMPOSTORS_H__
+
+#include "dynamicbuffer.h"
+#include "programcache.h"
+#include "uniforms.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ Sphere impostors: bodies only a few pixels across drawn as camera-facing quads instead of the sphere mesh
+    - At a few pixels the mesh's 561 vertices shade a handful of fragments; a quad is four vertices. The fragment
+      shader (fshader_impostor.glsl) ray-casts the sphere inside it, shades the hit with the mesh's lighting and shadow
+      map, and writes its depth, so impostors hide and are hidden by everything else as the mesh would be
+    - A body is worth an impostor below MAX_PIXELS in radius on screen; up to there the per-fragment shading can't be
+      told from the mesh's per-vertex shading, so bodies don't pop as they cross it
+    - add() appends one instance (eye-space center and radius, material products); draw() copies them into a slice of
+      the dynamic buffer (dynamicbuffer.h) and draws every quad with one glDrawArraysInstanced
+    - Quads are drawn filled in wireframe mode too, where a mesh that small is a solid blob of lines anyway; the caller
+      grows the radius by half the line width there
+    - Textured bodies keep the mesh, since each needs its own texture bound
+    - The program builds in the background (programcache.h); until ready() says otherwise draw the meshes
+ ***/
+class ImpostorBatch {
+public:
+    static const int MAX_PIXELS = 4;  //Radius on screen
+
+    ImpostorBatch() : build(-1), program(0), vao(0) {}
+
+    void init(ProgramCache& programs);  //Call with a current context; starts the program build
+    bool ready(ProgramCache& programs);  //False while the program is building, or if it failed to build
+
+    void clear() { instances.clear(); }
+    void add(const vec3& center, GLfloat radius, const vec4& ambient, const vec4& diffuse, const vec4& specular);
+    void draw(DynamicBuffer& stream);
+
+    size_t size() const { return instances.size(); }
+
+private:
+    struct Instance {  //Per-instance attributes of vshader_impostor.glsl
+        vec4 sphere;  //Eye-space center, radius
+        vec4 ambient, diffuse, specular;
+    };
+
+    int build;  //ProgramCache handle
+    GLuint program;
+    GLuint vao;
+    vector<Instance> instances;
+};
+
+#endif // __IMPOSTORS_H__
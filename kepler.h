@@ -0,0 +1,87 @@
+#ifndef __KEPLER_H__
+#define __KEPLER_H__
+
+#include "dvec.h"
+#include <cmath>
+
+using namespace Angel;
+
+/***
+ Two-body (Keplerian) orbit propagation in double precision.
+    - Positions are ecliptic J2000 coordinates (X toward the vernal equinox, Z toward the ecliptic north pole), in AU
+    - Time is in years since J2000 (2000-01-01 12:00 TT)
+    - Positions are relative to the body being orbited (the Sun for planets, the host planet for moons)
+ ***/
+
+const double AU_PER_EARTH_RADIUS = 6378.137 / 149597870.7;  //Radii in planet.h are given relative to Earth
+const double DAYS_PER_YEAR = 365.25;  //Julian year
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+const double OBLIQUITY_J2000 = 23.4392911 * DEG_TO_RAD;  //Tilt of the Earth's equator to the ecliptic
+
+struct OrbitalElements {
+    double major;         //Semi-major axis (AU)
+    double eccentricity;
+    double inclination;   //Inclination to the ecliptic (deg)
+    double ascNode;       //Longitude of the ascending node (deg)
+    double periLong;      //Longitude of perihelion (deg)
+    double meanLong;      //Mean longitude at epoch (deg)
+    double period;        //Sidereal period (years)
+    double nodeRate;      //Regression of the node (deg/year); only significant for moons
+    double periRate;      //Precession of perihelion (deg/year); only significant for moons
+
+    OrbitalElements() : major(0), eccentricity(0), inclination(0), ascNode(0), periLong(0), meanLong(0), period(0), nodeRate(0), periRate(0) {}
+};
+
+//Solve Kepler's equation M = E - e*sin(E) for the eccentric anomaly E (radians)
+inline double solveKepler(double M, double e) {
+    M = std::fmod(M, 2*M_PI);
+    double E = (e < 0.8) ? M : M_PI;
+    for(int i = 0; i < 16; i++) {
+        double dE = (E - e*std::sin(E) - M) / (1 - e*std::cos(E));
+        E -= dE;
+        if(std::fabs(dE) < 1e-14) break;
+    }
+    return E;
+}
+
+//Position of the body at time t relative to what it orbits
+inline dvec3 keplerPosition(const OrbitalElements& el, double t) {
+    if(el.period <= 0) return dvec3(0.0);
+
+    double node = (el.ascNode + el.nodeRate*t) * DEG_TO_RAD;
+    double peri = (el.periLong + el.periRate*t) * DEG_TO_RAD;
+    double incl = el.inclination * DEG_TO_RAD;
+    double M = (el.meanLong + 360.0*t/el.period) * DEG_TO_RAD - peri;
+    double w = peri - node;  //Argument of perihelion
+
+    double e = el.eccentricity;
+    double E = solveKepler(M, e);
+    double xp = el.major * (std::cos(E) - e);  //Position in the orbital plane
+    double yp = el.major * std::sqrt(1 - e*e) * std::sin(E);
+
+    double cw = std::cos(w), sw = std::sin(w);
+    double cn = std::cos(node), sn = std::sin(node);
+    double ci = std::cos(incl), si = std::sin(incl);
+    return dvec3((cw*cn - sw*sn*ci)*xp + (-sw*cn - cw*sn*ci)*yp,
+                 (cw*sn + sw*cn*ci)*xp + (-sw*sn + cw*cn*ci)*yp,
+                 (sw*si)*xp + (cw*si)*yp);
+}
+
+//Unit vector toward equatorial J2000 (ra, dec) in degrees, in the scene's axes (x = ecliptic X, y = ecliptic north,
+//z = -ecliptic Y)
+inline dvec3 sceneDirection(double ra, double dec) {
+    ra *= DEG_TO_RAD;  dec *= DEG_TO_RAD;
+    double x = std::cos(dec) * std::cos(ra), y = std::cos(dec) * std::sin(ra), z = std::sin(dec);
+    double ey = y * std::cos(OBLIQUITY_J2000) + z * std::sin(OBLIQUITY_J2000);
+    double ez = -y * std::sin(OBLIQUITY_J2000) + z * std::cos(OBLIQUITY_J2000);
+    return dvec3(x, ez, -ey);
+}
+
+//Upper bound on orbital speed (AU/year), reached at perihelion
+inline double keplerMaxSpeed(const OrbitalElements& el) {
+    if(el.period <= 0) return 0.0;
+    double e = el.eccentricity;
+    return 2*M_PI * el.major / el.period * std::sqrt((1 + e) / (1 - e));
+}
+
+#endif // __KEPLER_H__
@@ -0,0 +1,94 @@
+#include "labels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static const vec4 LABEL_COLOR(0.9, 0.9, 0.9, 1.0);
+static const vec4 PANEL_COLOR(1.0, 0.9, 0.5, 1.0);
+
+//Three significant digits of d, with its decade: equal keys print the same with "%.3g"
+static long distanceKey(double d) {
+    if(!(d > 0)) return 0;
+    int decade = (int) floor(log10(d));
+    long digits = lround(d / pow(10.0, decade - 2));
+    if(digits >= 1000) { decade++;  digits = lround(digits / 10.0); }
+    return decade * 1000L + digits;
+}
+
+void BodyLabels::buildPanel(const BodyStore& bodies) {
+    panelBody = selected;
+    panel.clear();
+    if(selected < 0 || selected >= (int) bodies.size()) return;
+    const OrbitalElements& el = bodies.elements[selected];
+    bool point = (bodies.flags[selected] & BODY_POINT) != 0;
+    char line[128];
+    panel = bodies.names[selected];
+    if(!point) {
+        snprintf(line, sizeof(line), "\nRadius: %.3g x Earth", bodies.radius[selected] / AU_PER_EARTH_RADIUS);
+        panel += line;
+    }
+    if(bodies.parents[selected] >= 0) panel += "\nOrbits: " + bodies.names[bodies.parents[selected]];
+    if(el.period > 0) {
+        snprintf(line, sizeof(line), "\nSemi-major axis: %.4g AU\nEccentricity: %.4f\nPeriod: %.4g years",
+                 el.major, el.eccentricity, el.period);
+        panel += line;
+    }
+    if(bodies.rotSpeed[selected] != 0) {
+        snprintf(line, sizeof(line), "\nRotation: %.3g x Earth", bodies.rotSpeed[selected]);
+        panel += line;
+    }
+    if(!point) {
+        int moons = 0;
+        for(size_t i = selected + 1; i < bodies.size(); i++) { if(bodies.parents[i] == selected) moons++; }
+        if(moons > 0) {
+            snprintf(line, sizeof(line), "\nMoons: %d", moons);
+            panel += line;
+        }
+    }
+}
+
+void BodyLabels::layout(TextRenderer& text, const BodyStore& bodies, const vector<int>& visible,
+                        const mat4& projectionView, GLfloat pixelsPerRadian, bool showLabels) {
+    formatted = 0;
+    if(selected != panelBody) buildPanel(bodies);
+    if(!panel.empty()) {
+        GLfloat w, h;
+        text.measure(panel, w, h);
+        text.add(MARGIN, text.getHeight() - MARGIN - h, panel, PANEL_COLOR, false);
+    }
+    if(!showLabels) return;
+
+    if(cache.size() != bodies.size()) cache.assign(bodies.size(), Label());
+    placements.clear();
+    GLfloat halfWidth = text.getWidth() * 0.5f, halfHeight = text.getHeight() * 0.5f;
+    for(size_t k = 0; k < visible.size(); k++) {
+        int i = visible[k];
+        vec4 clip = projectionView * vec4(bodies.relPos[i], 1.0);
+        if(clip.w <= 0) continue;
+        Placement p;
+        p.x = (clip.x / clip.w + 1) * halfWidth;
+        p.y = (1 - clip.y / clip.w) * halfHeight;
+        p.radius = bodies.renderRadius[i] * pixelsPerRadian / clip.w;  //w is the distance along the view axis
+        p.body = i;
+        placements.push_back(p);
+    }
+    sort(placements.begin(), placements.end(), [](const Placement& a, const Placement& b) {
+        return a.radius != b.radius ? a.radius > b.radius : a.body < b.body;
+    });
+
+    for(size_t k = 0; k < placements.size(); k++) {
+        const Placement& p = placements[k];
+        Label& label = cache[p.body];
+        double distance = length(bodies.relPos[p.body]);
+        long key = distanceKey(distance);
+        if(key != label.shown) {
+            char value[32];
+            snprintf(value, sizeof(value), "\n%.3g AU", distance);
+            label.text = bodies.names[p.body] + value;
+            label.shown = key;
+            formatted++;
+        }
+        //Right of the body, the two lines centered on it
+        text.add(p.x + p.radius + 3, p.y - TextRenderer::CELL_HEIGHT * text.getScale(), label.text, LABEL_COLOR);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __LABELS_H__
+#define __LABELS_H__
+
+#include "bodystore.h"
+#include "text.h"
+#include <climits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ On-screen labels for the bodies, and an info panel for the selected one
+    - Every visible sphere body gets its name and its distance from the camera beside it. Labels are laid out biggest
+      body on screen first, so where two would overlap the bigger body keeps its label (text.h drops the other)
+    - Each body's label string is cached with the three significant digits of distance it shows, and formatted again
+      only when those change; most frames format none
+    - The selected body (picked with the mouse) gets a panel in the bottom left corner with what Planet::getInfo()
+      prints: size, parent, orbit, rotation and moons. It is built when the selection changes and placed first, so
+      labels keep off it
+    - Minor planets are too many to label, but the panel shows them when picked
+ ***/
+class BodyLabels {
+public:
+    static const int MARGIN = 8;  //Pixels between the panel and the window's edges
+
+    BodyLabels() : selected(-1), panelBody(-1), formatted(0) {}
+
+    void select(int body) { selected = body; }  //-1 for none
+    int getSelected() const { return selected; }
+
+    //Adds this frame's panel and, with showLabels, the labels of the visible bodies to text (after text.begin())
+    void layout(TextRenderer& text, const BodyStore& bodies, const vector<int>& visible, const mat4& projectionView,
+                GLfloat pixelsPerRadian, bool showLabels);
+    long getFormatted() const { return formatted; }  //Label strings formatted last frame
+
+private:
+    struct Label {
+        string text;
+        long shown;  //Distance key the text was formatted for
+        Label() : shown(LONG_MIN) {}
+    };
+    struct Placement {
+        GLfloat x, y, radius;  //On screen, pixels from the top left
+        int body;
+    };
+
+    void buildPanel(const BodyStore& bodies);
+
+    vector<Label> cache;  //Per body
+    vector<Placement> placements;
+    int selected, panelBody;
+    string panel;
+    long formatted;
+};
+
+#endif // __LABELS_H__
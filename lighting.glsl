@@ -0,0 +1,57 @@
+/***************************
+ * File: lighting.glsl:
+ *   Shared by the vertex shaders through #include (expanded when the
+ *   shaders are embedded, see shadersource.h): the per-frame blocks and
+ *   per-vertex point-light shading (the Sun is the light source). The
+ *   direct light is kept apart from the ambient term so fshader.glsl can
+ *   apply the shadow map to it per fragment
+ ****************************/
+
+// std140 blocks; layouts mirror the structs in uniforms.h
+layout(std140, row_major) uniform Camera {  // Once per frame
+    mat4 projection;
+    mat4 view;
+};
+
+layout(std140, row_major) uniform Light {  // Once per frame
+    vec4 LightPosition;   // Must be in Eye Frame
+    float Shininess;
+    float ConstAtt;  // Constant Attenuation
+    float LinearAtt; // Linear Attenuation
+    float QuadAtt;   // Quadratic Attenuation
+};
+
+// lightToVertex: from the light to the vertex along the world axes, where the shadow map is looked up
+void shade(vec4 vPosition, vec3 vNormal, mat4 model_view, mat3 normal_matrix,
+           vec4 AmbientProduct, vec4 DiffuseProduct, vec4 SpecularProduct,
+           out vec4 ambient, out vec4 direct, out vec3 lightToVertex)
+{
+    // Transform vertex position into eye coordinates
+    vec3 pos = (model_view * vPosition).xyz;
+
+    vec3 L = normalize( LightPosition.xyz - pos );
+    vec3 E = normalize( -pos );
+    vec3 H = normalize( L + E );
+
+    // Transform vertex normal into eye coordinates
+    vec3 N = normalize( normal_matrix * vNormal );
+
+    float dist = length( LightPosition.xyz - pos );
+    float attenuation = 1.0 / (ConstAtt + LinearAtt * dist + QuadAtt * dist * dist);
+
+    ambient = AmbientProduct;
+
+    float d = max( dot(L, N), 0.0 );
+    vec4 diffuse = d * DiffuseProduct;
+
+    float s = pow( max(dot(N, H), 0.0), Shininess );
+    vec4 specular = s * SpecularProduct;
+    if ( dot(L, N) < 0.0 ) {
+        specular = vec4(0.0, 0.0, 0.0, 1.0);
+    }
+
+    direct = attenuation * (diffuse + specular);
+
+    // view only rotates (the camera sits at the origin), so its transpose takes eye directions back to world axes
+    lightToVertex = transpose(mat3(view)) * (pos - LightPosition.xyz);
+}
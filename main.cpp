@@ -12,11 +12,11 @@
  [X] Add light point source at position of the sun
  [X] Calculate inherent colors and lighting param's of each Planet to be passed to shaders
  [X] init()
- [X] drawObj()
- [ ] display()
- [ ] Render planets with proper movements and inherent colors
- [ ] Add shadows appropriately
- [ ] Map planet textures onto appropriate planets
+ [X] drawObj() (now drawMesh() with a VAO per mesh)
+ [X] display()
+ [X] Render planets with proper movements and inherent colors
+ [X] Add shadows appropriately (shadow.cpp)
+ [X] Map planet textures onto appropriate planets (texturestream.cpp)
  [ ] Add menu and keboard functionality for interactiveness
  [ ] Add movement to moons (elliptical orbit around planet and rotation on axis)
  [ ] Add axial tilt to planets and moons
@@ -24,6 +24,37 @@
 
 #include <iostream>
 #include "planet.h"
+#include "events.h"
+#include "bodystore.h"
+#include "catalog.h"
+#include "mpcorb.h"
+#include "threadpool.h"
+#include "headless.h"
+#include "capture.h"
+#include "uniforms.h"
+#include "mesh.h"
+#include "dynamicbuffer.h"
+#include "multidraw.h"
+#include "frustum.h"
+#include "shadow.h"
+#include "texturestream.h"
+#include "rings.h"
+#include "trails.h"
+#include "occlusion.h"
+#include "impostors.h"
+#include "starfield.h"
+#include "picking.h"
+#include "text.h"
+#include "labels.h"
+#include "resolution.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "shadersource.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -31,46 +62,85 @@
 
 int wireFlag = 0;  //0: Wire-frame rendering;  1: Filled rendering
 
-GLuint program, model_view, projection;
+GLuint program;
+ProgramCache programs;  //Linked program binaries kept on disk between runs (--shader-cache, --no-shader-cache)
+UniformCache uniforms;  //Reflected once in init()
+DynamicBuffer streamBuffer;  //Every per-frame upload: the std140 blocks (see uniforms.h), points, batches, texture bands
+GLintptr objectStride;  //Distance between ObjectUniforms records, rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+vector<unsigned char> objectData;  //This frame's ObjectUniforms records, uploaded in one call
+MultiDrawBatch sphereBatch;  //All sphere bodies in one glMultiDrawElementsIndirect, when the GL supports it
+bool useMultiDraw = false;  //Decided in init(); --no-multidraw forces one draw call per body
+bool allowMultiDraw = true;
+ShadowMap shadows;  //Shadows cast in the Sun's light (one extra pass over the bodies)
+int shadowSize = 1024;  //Resolution of each shadow map layer; --shadows 0 turns them off
+bool shadowsOn = true;  //'s' toggles
+TextureStreamer textures;  //Surface maps decoded in the background and streamed by size on screen
+string textureDir = "textures";  //<dir>/<body name>.png; set with --textures <dir>
+bool compressTextures = false;  //--compress-textures: BC1 on the GPU
+RingSystems rings;  //Particle rings of Saturn and Uranus, moved entirely on the GPU
+int ringParticles = 1000000;  //Saturn's; --rings <n>, 0 for none
+bool ringsOn = true;  //'r' toggles
+OrbitTrails trails;  //Fading line behind each orbiting body, from a ring buffer on the GPU
+int trailLength = OrbitTrails::DEFAULT_LENGTH;  //Samples (frames) per trail; --trails <n>, 0 for none
+bool trailsOn = true;  //'t' toggles
+OcclusionCuller occlusion;  //Skips bodies hidden behind others, from last frame's queries; 'o' toggles
+bool occlusionOn = true;  //--no-occlusion turns it off from the start
+ImpostorBatch impostors;  //Bodies a few pixels across as ray-cast quads, in one instanced draw
+bool impostorsOn = true;  //'i' toggles; --no-impostors turns them off from the start
+StarField stars;  //Background stars; the plain clear color without a catalog
+string starPath = "stars.bin";  //Made with "stars <in.csv> <out.bin>"; set with --stars <file>
+BodyPicker picker;  //Left click prints the body under the mouse
+mat4 lastProjectionView;  //Of the last frame drawn, which the picked positions (bodies.relPos) belong to
+int pickX = -1, pickY = -1;  //--pick <x>,<y>: picks there after a headless run
+TextRenderer text;  //Every string on screen, in one draw
+BodyLabels labels;  //Names and distances beside the bodies, and the picked body's info panel
+bool labelsOn = true;  //'l' toggles; --no-labels turns them off from the start
+DynamicResolution resolution;  //Scene drawn at fewer pixels to hold a GPU frame time; 'd' toggles
+double resolutionBudget = 0;   //--dynamic-resolution <ms> turns it on with that budget
+GLfloat upscaleSharpness = 0;  //--sharpen <amount>, 0 for a plain bilinear blit
+FrameProfiler profiler;  //On with --profile (summary logged every few seconds) or 'p' (overlay)
+bool profileLog = false, profileOverlay = false;
+enum FramePhase { PHASE_SIMULATION, PHASE_CULLING, PHASE_TEXTURES, PHASE_SHADOWS, PHASE_UNIFORMS, PHASE_DRAW,
+                  PHASE_OCCLUSION, PHASE_TRAILS, PHASE_RINGS, PHASE_UPSCALE, PHASE_LABELS, PHASE_SWAP, NUM_PHASES };
+const char* const PHASE_NAMES[NUM_PHASES] = { "simulation", "culling", "textures", "shadows", "uniforms", "draw",
+                                              "occlusion", "trails", "rings", "upscale", "labels", "swap" };
+vector<int> visibleBodies;  //Sphere bodies that survived frustum and occlusion culling this frame
+vector<int> hiddenBodies;   //In the frustum, but hidden behind others last frame
+vector<int> meshBodies;     //Visible bodies drawn with the sphere mesh rather than as impostors
+long bodiesDrawn = 0, bodiesCulled = 0, bodiesOccluded = 0, bodiesImpostors = 0;  //Last frame's culling counters
+//Running totals (reported after headless runs)
+long long totalDrawn = 0, totalCulled = 0, totalOccluded = 0, totalConditional = 0, totalImpostors = 0,
+          totalCasterDraws = 0, totalRingParticles = 0, totalStars = 0;
+double totalScale = 0, minScale = 1;
+double totalPickRefit = 0;  //Seconds spent refitting the picking tree
 GLfloat fovy = 45.0;
 GLfloat aspect = 1.0;
-GLfloat near = 0.1;     GLfloat far = 1000.0;
+int winWidth = 512, winHeight = 512;  //Size of the window, or of the offscreen framebuffer when rendering headless
+GLuint frameTarget = 0;  //Framebuffer drawn into: 0 for the window, the offscreen FBO when headless
+GLfloat near = 0.1;     GLfloat far = 1000.0;  //Recomputed every frame from the distance to the nearest/farthest body
 GLfloat angle = 0.0;
-vec4 eye = vec4(-10.0, 3.0, -10.0, 1.0);  //Initial view position
+int focusBody = 0;  //Body the camera looks at (index into 'bodies')
+dvec3 eyeOffset(-10.0, 3.0, -10.0);  //View position relative to focusBody (AU)
+dvec3 eye;  //World-space view position (AU), kept in double precision
+double simTime = 0.0;  //Simulation time (years since J2000)
+double timeScale = 0.1;  //Simulated years per second of real time
+int lastTick = 0;  //glutGet(GLUT_ELAPSED_TIME) at the previous idle() call
 
 vector<Planet*> planets; //Global list of all planets in the scene
 vector<Moon*> moons;  //Global list of all moons in the scene
+BodyStore bodies;  //Double-precision world state of the Sun, planets and moons, loaded from the catalog
+string catalogPath = "bodies.csv";  //Body catalog (CSV, JSON or .bin); override with --catalog <file>
+string smallBodyPath;  //Optional MPCORB-format minor planet file, set with --smallbodies <file>
+string capturePath;  //Headless frame output (PNG pattern, .y4m, or a video file for ffmpeg), set with --capture <target>
+int captureFps = 30;  //Frame rate written into captured video, set with --fps <n>
+ThreadPool* workers = NULL;  //Shared by the loaders and the per-frame position update
 const double PI = 3.14159265358979;
 
-//Global planet object declaractions:
-Planet Mercury("Mercury", 0.382, 0.3871, 0.205630, 0.241, 0.0171, false);
-Planet Venus("Venus", 0.949, 0.7232, 0.007, 0.616, 0.0086, false);
-Planet Earth("Earth", 1.0, 1, 0.0167, 1, 1, true);
-Planet Mars("Mars", 0.533, 1.5235, 0.0935, 1.882, 0.9747, true);
-Planet Jupiter("Jupiter", 11.2, 5.2043, 0.0489, 11.870, 2.416, true);
-Planet Saturn("Saturn", 9.5, 9.617, 0.0565, 29.477, 2.2432, true);
-Planet Uranus("Uranus", 4.0, 19.288, 0.0464, 84.078, 1.3926, true);
-Planet Neptune("Neptune", 3.9, 30.2, 0.0095, 164.882, 1.4908, true);
-
-Moon TheMoon("Moon", 0.27, &Earth);
-Moon Phobos("Phobos", 0.27, &Mars);
-Moon Deimos("Deimos", 0.27, &Mars);
-Moon jMoon("Jupiter's Moon", 0.27, &Jupiter);
-Moon sMoon("Saturn's Moon", 0.27, &Saturn);
-Moon uMoon("Uranus's Moon", 0.27, &Uranus);
-Moon nMoon("Neptune's Moon", 0.27, &Neptune);
-
-point4 *sunPoints, *mercPoints, *venPoints, *earthPoints, *marsPoints, *jupPoints, *satPoints, *urPoints, *nepPoints;  //Points for each vertex in each Planet/Sun
-point4 *mercPath, *venPath, *earthPath, *marsPath, *jupPath, *satPath, *urPath, *nepPath;  //Coordinates of elliptical path of each Planet object
-vec3 *sunNorms, *mercNorms, *venNorms, *earthNorms, *marsNorms, *jupNorms, *satNorms, *urNorms, *nepNorms;  //Normals for each Planet/Sun
-
 Sun theSun;
 
-GLuint mercBuf = Mercury.getBuf();      GLuint venBuf = Venus.getBuf();
-GLuint earthBuf = Earth.getBuf();       GLuint marsBuf = Mars.getBuf();
-GLuint jupBuf = Jupiter.getBuf();       GLuint satBuf = Saturn.getBuf();
-GLuint urBuf = Uranus.getBuf();         GLuint nepBuf = Neptune.getBuf();
-GLuint sunBuf = theSun.getBuf();
+MeshPool meshPool;  //Every static mesh, in one vertex/index buffer pair
+Mesh sphereMesh;  //Unit sphere shared by every body; each body scales it with its model matrix
+Mesh pointMesh;  //Camera-relative positions of the point bodies, refilled every frame
 
 float const_att = 2.0;  //Constant attenuation
 float linear_att = 0.01;  //Linear attenuation
@@ -92,96 +162,105 @@ color4 black_ambient_product = black_ambient * /* lightPos * */ material_ambient
 color4 black_diffuse_product = black_diffuse * /* lightPos * */ material_diffuse;
 color4 black_specular_product = black_specular * /* lightPos * */ material_specular;
 
-//vector<Moon*> jMoonList, sMoonList, uMoonList, nMoonList; //Temporarily hold Moon objects for Planets with many moons – to be copied into class object data structure
-
-void pairMoonPlanet() {  //Pair moons with their respective planets; also creates planet and moon lists
-    ////This function seems to be causing a segmentation fault, most likely due to the large array sizes being generated in the lines below
-    ////Most likely solution: Allocate new lists on heap (instead of stack) by using new()
-    Earth.addMoon(&TheMoon);
-    Mars.addMoon(&Phobos);  Mars.addMoon(&Deimos);
-
-    for(int i = 0; i < 79; i++) { Jupiter.addMoon(&jMoon); }
-    
-    for(int i = 0; i < 62; i++) { Saturn.addMoon(&sMoon); }
-    
-    for(int i = 0; i < 27; i++) { Uranus.addMoon(&uMoon); }
-    
-    for(int i = 0; i < 14; i++) { Neptune.addMoon(&nMoon); }
-    
-    //Add planets to global vector 'planets':
-    planets.push_back(&Mercury);    planets.push_back(&Venus);
-    planets.push_back(&Earth);      planets.push_back(&Mars);
-    planets.push_back(&Jupiter);    planets.push_back(&Saturn);
-    planets.push_back(&Uranus);     planets.push_back(&Neptune);
+//Search for eclipses, transits and the Great Conjunctions between two years and print them
+void findEvents(double startYear, double endYear) {
+    EventSearch search;
+    search.addBodies(bodies);
+    int earth = search.findBody("Earth");
+    int moon = search.findBody("Moon");
+    if(earth < 0 || moon < 0) {
+        cerr << "Error: the catalog needs an Earth and a Moon to search for events\n";
+        exit(-1);
+    }
     
-    //Add moons to global vector 'moons':
-    for(int i = 0; i < planets.size(); i++) {
-        if(planets[i]->hasMoons()) {
-            vector<Moon*> moonList = planets[i]->getMoons();
-            for(int j = 0; j < moonList.size(); j++) { moons.push_back(moonList[j]); }
+    double t0 = startYear - 2000.0, t1 = endYear - 2000.0;
+    vector<Event> events = search.solarEclipses(earth, moon, t0, t1);
+    vector<Event> more;
+    //The rest are skipped when the catalog leaves their bodies out
+    const char* inferior[] = { "Mercury", "Venus" };
+    for(int k = 0; k < 2; k++) {
+        int planet = search.findBody(inferior[k]);
+        if(planet < 0) {
+            cerr << "No " << inferior[k] << " in the catalog; skipping its transits\n";
+            continue;
         }
+        more = search.transits(earth, planet, t0, t1);
+        events.insert(events.end(), more.begin(), more.end());
+    }
+    int jupiter = search.findBody("Jupiter"), saturn = search.findBody("Saturn");
+    if(jupiter < 0 || saturn < 0) cerr << "No Jupiter and Saturn in the catalog; skipping the Great Conjunctions\n";
+    else {
+        more = search.conjunctions(earth, jupiter, saturn, t0, t1, 1.0 * DEG_TO_RAD);
+        events.insert(events.end(), more.begin(), more.end());
     }
+    //Each search comes back sorted; print them all in date order
+    stable_sort(events.begin(), events.end(), [](const Event& x, const Event& y) { return x.peak < y.peak; });
+    
+    for(int i = 0; i < events.size(); i++) { cout << search.eventString(events[i]) << endl; }
 }
 
-void createSphereObj(const vector<Planet*> planetList) {
-    for(int i = 0; i < planetList.size(); i++) {
-        vector<point4> temp;  //Temp vector to hold vertices during sphere object generation
-        float r = planetList[i]->getRenderRadius();
-        for(float phi = 0; phi < 2*PI; phi += PI/10) {
-            for(float theta = 0; theta < PI; theta += PI/10) {
-                point4 point;
-                point4 center = {0.0, 0.0, 0.0, 1.0};  //All sphere objs generated w/ center at origin
-                point.x = r * cos(phi) * sin(theta) + center.x;
-                point.y = r * sin(phi) * sin(theta) + center.y;
-                point.z = r            * cos(theta) + center.z;
-                point.w = 1.0;
-                temp.push_back(point);
-            }
+//Create a Planet for every catalog body orbiting the Sun and a Moon for every body orbiting a planet; also creates planet and moon lists
+void createBodies() {
+    vector<Planet*> byIndex(bodies.size(), (Planet*) NULL);
+    for(int i = 1; i < bodies.size(); i++) {
+        if(bodies.flags[i] & BODY_POINT) continue;
+        int parent = bodies.parents[i];
+        const OrbitalElements& el = bodies.elements[i];
+        float r = bodies.radius[i] / AU_PER_EARTH_RADIUS;
+        if(parent == 0) {
+            bool hasMoons = false;
+            for(int j = i+1; j < bodies.size() && !hasMoons; j++) { hasMoons = (bodies.parents[j] == i); }
+            Planet* p = new Planet(bodies.names[i], r, el.major, el.eccentricity, el.period, bodies.rotSpeed[i], hasMoons);
+            p->setInclination(el.inclination);  p->setAscNode(el.ascNode);
+            p->setPeriLong(el.periLong);  p->setMeanLong(el.meanLong);
+            p->setRenderRadius(bodies.renderRadius[i] / AU_PER_EARTH_RADIUS);
+            p->setColor(bodies.colors[i]);
+            planets.push_back(p);
+            byIndex[i] = p;
+        }
+        else if(parent > 0 && byIndex[parent] != NULL) {
+            Moon* m = new Moon(bodies.names[i], r, byIndex[parent]);
+            m->setMajorAxis(el.major);  m->setEccentricity(el.eccentricity);  m->setOrbPeriod(el.period);
+            m->setInclination(el.inclination);  m->setAscNode(el.ascNode);
+            m->setPeriLong(el.periLong);  m->setMeanLong(el.meanLong);
+            m->setNodeRate(el.nodeRate);  m->setPeriRate(el.periRate);
+            m->setRenderRadius(bodies.renderRadius[i] / AU_PER_EARTH_RADIUS);
+            byIndex[parent]->addMoon(m);
+            moons.push_back(m);
         }
-        planetList[i]->setVertices(temp);  //Store sphere obj vertices in respective Planet class
-        temp.clear();
     }
+    theSun.setColor(bodies.colors[0]);
 }
 
-void createSphereObj(const vector<Moon*> moonList) {
-    for(int i = 0; i < moonList.size(); i++) {
-        vector<point4> temp;  //Temp vector to hold vertices during sphere object generation
-        float r = moonList[i]->getRenderRadius();
-        for(float phi = 0; phi < 2*PI; phi += PI/10) {
-            for(float theta = 0; theta < PI; theta += PI/10) {
-                point4 point;
-                point4 center = moonList[i]->getOrbPlanet()->getCenter();  //All sphere objs generated w/ center at center of orbPlanet
-                point.x = r * cos(phi) * sin(theta) + center.x;
-                point.y = r * sin(phi) * sin(theta) + center.y;
-                point.z = r            * cos(theta) + center.z;
-                point.w = 1.0;
-                temp.push_back(point);
-            }
+//Generate an indexed unit sphere as GL_TRIANGLES; on a unit sphere the normal at each vertex is its position.
+//Texture coordinates map an equirectangular image: u is longitude (east counterclockwise seen from the north), v runs
+//from the north pole (0) to the south pole (1)
+void createUnitSphere(vector<point4>& points, vector<vec3>& norms, vector<vec2>& texCoords, vector<GLuint>& indices) {
+    const int slices = 32, stacks = 16;
+    for(int i = 0; i <= stacks; i++) {  //(stacks+1) x (slices+1) grid; the seam column is duplicated
+        float t = PI * i / stacks;
+        for(int j = 0; j <= slices; j++) {
+            float p = 2*PI * j / slices;
+            vec3 v(cos(p)*sin(t), cos(t), sin(p)*sin(t));
+            points.push_back(point4(v, 1.0));
+            norms.push_back(v);
+            texCoords.push_back(vec2(1.0 - (float) j / slices, (float) i / stacks));
         }
-        moonList[i]->setVertices(temp);  //Store sphere obj vertices in respective Planet class
-        temp.clear();
     }
-}
-
-void createSunObj() {
-    vector<point4> temp;  //Temp vector to gold vertices during Sun creation
-    float r = theSun.getRenderRadius();
-    for(double phi = 0; phi < 2*PI; phi += PI/10) {
-        for(double theta = 0; theta < PI; theta += PI/10) {
-            point4 point;
-            point4 center = {0.0, 0.0, 0.0, 1.0};  //Sun will always be centered at origin
-            point.x = r * cos(phi) * sin(theta) + center.x;
-            point.y = r * sin(phi) * sin(theta) + center.y;
-            point.z = r            * cos(theta) + center.z;
-            point.w = 1.0;
-            temp.push_back(point);
+    for(int i = 0; i < stacks; i++) {
+        for(int j = 0; j < slices; j++) {
+            GLuint quad[4] = {  //Corners (i,j), (i+1,j), (i+1,j+1), (i,j+1)
+                (GLuint) (i*(slices+1) + j), (GLuint) ((i+1)*(slices+1) + j),
+                (GLuint) ((i+1)*(slices+1) + j+1), (GLuint) (i*(slices+1) + j+1)
+            };
+            int order[6] = { 0, 1, 2, 0, 2, 3 };
+            for(int k = 0; k < 6; k++) indices.push_back(quad[order[k]]);
         }
     }
-    theSun.setVertices(temp);
 }
 
 ////Orbit data has NOT been calculated for moons
-//Calculate semi-minor axis, orbit speed, and generate map of orbit points for each Planet:
+//Calculate semi-minor axis and orbit speed for each Planet (their paths are drawn by the trails, trails.h):
 void calcOrbit(const vector<Planet*> planetList) {
     for(int i = 0; i < planetList.size(); i++) {
         //Calc and set semi-minor axis of Planet's orbit
@@ -197,101 +276,6 @@ void calcOrbit(const vector<Planet*> planetList) {
         float L = planetList[i]->getOrbPeriod();
         double s = p/L;
         planetList[i]->setOrbSpeed(s);
-        
-        vector<point4> orbMap;
-        point4 point;
-        //Calc and set coordinates of orbit for Planet
-        for(int j = 0; j < 360; j++) {
-            point.x += a * cos(j);
-            point.z += b * sin(j);
-            point.y = 0;    point.w = 1;
-            orbMap.push_back(point);
-        }
-        planetList[i]->setOrbitMap(orbMap);
-        orbMap.clear();
-    }
-    
-    //Copy path coordinates to global array:
-    mercPath = (point4 *) malloc(Mercury.getOrbitMap().size() * sizeof(point4));
-    vector<point4> mercPathTemp = Mercury.getOrbitMap();
-    for(int i = 0; i < mercPathTemp.size(); i++) { mercPath[i] = mercPathTemp[i]; }
-    mercPathTemp.clear();
-    
-    venPath = (point4 *) malloc(Venus.getOrbitMap().size() * sizeof(point4));
-    vector<point4> venPathTemp = Venus.getOrbitMap();
-    for(int i = 0; i < venPathTemp.size(); i++) { venPath[i] = venPathTemp[i]; }
-    venPathTemp.clear();
-    
-    earthPath = (point4 *) malloc(Earth.getOrbitMap().size() * sizeof(point4));
-    vector<point4> earthPathTemp = Earth.getOrbitMap();
-    for(int i = 0; i < earthPathTemp.size(); i++) { earthPath[i] = earthPathTemp[i]; }
-    earthPathTemp.clear();
-    
-    marsPath = (point4 *) malloc(Mars.getOrbitMap().size() * sizeof(point4));
-    vector<point4> marsPathTemp = Mars.getOrbitMap();
-    for(int i = 0; i < marsPathTemp.size(); i++) { marsPath[i] = marsPathTemp[i]; }
-    marsPathTemp.clear();
-    
-    jupPath = (point4 *) malloc(Jupiter.getOrbitMap().size() * sizeof(point4));
-    vector<point4> jupPathTemp = Jupiter.getOrbitMap();
-    for(int i = 0; i < jupPathTemp.size(); i++) { jupPath[i] = jupPathTemp[i]; }
-    jupPathTemp.clear();
-    
-    satPath = (point4 *) malloc(Saturn.getOrbitMap().size() * sizeof(point4));
-    vector<point4> satPathTemp = Saturn.getOrbitMap();
-    for(int i = 0; i < satPathTemp.size(); i++) { satPath[i] = satPathTemp[i]; }
-    satPathTemp.clear();
-    
-    urPath = (point4 *) malloc(Uranus.getOrbitMap().size() * sizeof(point4));
-    vector<point4> urPathTemp = Uranus.getOrbitMap();
-    for(int i = 0; i < urPathTemp.size(); i++) { satPath[i] = satPathTemp[i]; }
-    urPathTemp.clear();
-    
-    nepPath = (point4 *) malloc(Neptune.getOrbitMap().size() * sizeof(point4));
-    vector<point4> nepPathTemp = Neptune.getOrbitMap();
-    for(int i = 0; i < nepPathTemp.size(); i++) { nepPath[i] = nepPathTemp[i]; }
-    nepPathTemp.clear();
-}
-
-void calcNormals(const vector<Moon*> moon, int a, int b, int c) {  //Calculate normals for each vertex in Moon object
-    //int Index = 0;
-    vector<point3> normals; // = moon[0]->getNormals();
-    vector<point4> vertices = moon[0]->getVertices();
-    
-    for(int i = 0; c <= vertices.size(); i++) {
-        vec4 u = vertices[b] - vertices[a];
-        vec4 v = vertices[c] - vertices[b];
-        
-        vec3 normal = normalize(cross(u,v));
-        
-        normals.push_back(normal);   //Index++;
-        normals.push_back(normal);   //Index++;
-        normals.push_back(normal);   //Index++;
-        a += 3; b += 3; c += 3;
-    }
-    for(int i = 0; i < moon.size(); i++) { moon[i]->setNormals(normals); }  //Copy normals to Moon->normals
-}
-
-void calcNormals(Planet* planet, int a, int b, int c) { //Calculate normals for each vertex in Planet object
-    //int Index = 0;
-    vector<point3> normals; // = planet->getNormals();
-    vector<point4> vertices = planet->getVertices();
-    
-    for(int i = 0; c <= vertices.size(); i++) {
-        vec4 u = vertices[b] - vertices[a];
-        vec4 v = vertices[c] - vertices[b];
-        
-        vec3 normal = normalize(cross(u,v));
-        
-        normals.push_back(normal);    //Index++;
-        normals.push_back(normal);    //Index++;
-        normals.push_back(normal);    //Index++;
-        a += 3; b += 3; c +=3;
-    }
-    planet->setNormals(normals); //Copy normals to Planet->normals
-    if(planet->hasMoons()) {
-        vector<Moon*> tempMoons = planet->getMoons();
-        calcNormals(tempMoons, 0, 1, 2);
     }
 }
 
@@ -323,18 +307,6 @@ color3 vertex_colors3[10] = {
     color3(0.529, 0.807, 0.92)  // light blue
 };
 
-void setColors() {  //Set the inherent color of each Planet before calculating color param's
-    theSun.setColor(vertex_colors4[8]);  //Golden Yellow
-    Mercury.setColor(vertex_colors4[3]);  //Green
-    Venus.setColor(vertex_colors4[1]);  //Red
-    Earth.setColor(vertex_colors4[4]);  //Blue
-    Mars.setColor(vertex_colors4[1]);  //Red
-    Jupiter.setColor(vertex_colors4[5]);  //Magenta
-    Saturn.setColor(vertex_colors4[2]);  //Yellow
-    Uranus.setColor(vertex_colors4[9]);  //Light Blue
-    Neptune.setColor(vertex_colors4[4]);  //Blue
-}
-
 void calcColors(vector<Planet*> planetList) {  //Calculate colors w/ lighting for each planet
     for(int i = 0; i < planetList.size(); i++) {  //Set Planet colors
         color4 planetColor = planetList[i]->getColor();
@@ -356,270 +328,565 @@ void calcColors(vector<Planet*> planetList) {  //Calculate colors w/ lighting fo
     theSun.setAmbProd(ambProd);  theSun.setDiffProd(diffProd);  theSun.setSpecProd(specProd);
 }
 
-void genBufferData() {
-    mercPoints = (point4 *) malloc(Mercury.getVertices().size() * sizeof(point4));
-    vector<point4> mercTemp = Mercury.getVertices();
-    for(int i = 0; i < mercTemp.size(); i++) { mercPoints[i] = mercTemp[i]; }
-    mercTemp.clear();
-    
-    mercNorms = (vec3 *) malloc(Mercury.getNormals().size() * sizeof(vec3));
-    vector<vec3> mTemp = Mercury.getNormals();
-    for(int i = 0; i < mTemp.size(); i++) { mercNorms[i] = mTemp[i]; }
-    mTemp.clear();
-    
-    venPoints = (point4 *) malloc(Venus.getVertices().size() * sizeof(point4));
-    vector<point4> venTemp = Venus.getVertices();
-    for(int i = 0; i < venTemp.size(); i++) { venPoints[i] = venTemp[i]; }
-    venTemp.clear();
-    
-    venNorms = (vec3 *) malloc(Venus.getNormals().size() * sizeof(vec3));
-    vector<vec3> vTemp = Venus.getNormals();
-    for(int i = 0; i < vTemp.size(); i++) { venNorms[i] = vTemp[i]; }
-    vTemp.clear();
-    
-    earthPoints = (point4 *) malloc(Earth.getVertices().size() * sizeof(point4));
-    vector<point4> earthTemp = Earth.getVertices();
-    for(int i = 0; i < earthTemp.size(); i++) { earthPoints[i] = earthTemp[i]; }
-    earthTemp.clear();
-    
-    earthNorms = (vec3 *) malloc(Earth.getNormals().size() * sizeof(vec3));
-    vector<vec3> eTemp = Earth.getNormals();
-    for(int i = 0; i < eTemp.size(); i++) { earthNorms[i] = eTemp[i]; }
-    eTemp.clear();
-    
-    marsPoints = (point4 *) malloc(Mars.getVertices().size() * sizeof(point4));
-    vector<point4> marsTemp = Mars.getVertices();
-    for(int i = 0; i < marsTemp.size(); i++) { marsPoints[i] = marsTemp[i]; }
-    marsTemp.clear();
-    
-    marsNorms = (vec3 *) malloc(Mars.getNormals().size() * sizeof(vec3));
-    vector<vec3> mTemp2 = Mars.getNormals();
-    for(int i = 0; i < mTemp2.size(); i++) { marsNorms[i] = mTemp2[i]; }
-    mTemp2.clear();
-    
-    jupPoints = (point4 *) malloc(Jupiter.getVertices().size() * sizeof(point4));
-    vector<point4> jupTemp = Jupiter.getVertices();
-    for(int i = 0; i < jupTemp.size(); i++) { jupPoints[i] = jupTemp[i]; }
-    jupTemp.clear();
-    
-    jupNorms = (vec3 *) malloc(Jupiter.getNormals().size() * sizeof(vec3));
-    vector<vec3> jTemp = Jupiter.getNormals();
-    for(int i = 0; i < jTemp.size(); i++) { jupNorms[i] = jTemp[i]; }
-    jTemp.clear();
-    
-    satPoints = (point4 *) malloc(Saturn.getVertices().size() * sizeof(point4));
-    vector<point4> satTemp = Saturn.getVertices();
-    for(int i = 0; i < satTemp.size(); i++) { satPoints[i] = satTemp[i]; }
-    satTemp.clear();
-    
-    satNorms = (vec3 *) malloc(Saturn.getNormals().size() * sizeof(vec3));
-    vector<vec3> sTemp = Saturn.getNormals();
-    for(int i = 0; i < sTemp.size(); i++) { satNorms[i] = sTemp[i]; }
-    sTemp.clear();
-    
-    urPoints = (point4 *) malloc(Uranus.getVertices().size() * sizeof(point4));
-    vector<point4> urTemp = Uranus.getVertices();
-    for(int i = 0; i < urTemp.size(); i++) { urPoints[i] = urTemp[i]; }
-    urTemp.clear();
-    
-    urNorms = (vec3 *) malloc(Uranus.getNormals().size() * sizeof(vec3));
-    vector<vec3> uTemp = Uranus.getNormals();
-    for(int i = 0; i < uTemp.size(); i++) { urNorms[i] = uTemp[i]; }
-    uTemp.clear();
-    
-    nepPoints = (point4 *) malloc(Neptune.getVertices().size() * sizeof(point4));
-    vector<point4> nepTemp = Neptune.getVertices();
-    for(int i = 0; i < nepTemp.size(); i++) { nepPoints[i] = nepTemp[i]; }
-    nepTemp.clear();
-    
-    nepNorms = (vec3 *) malloc(Neptune.getNormals().size() * sizeof(vec3));
-    vector<vec3> nTemp = Neptune.getNormals();
-    for(int i = 0; i < nTemp.size(); i++) { nepNorms[i] = nTemp[i]; }
-    nTemp.clear();
-    
-    sunPoints = (point4 *) malloc(theSun.getVertices().size() * sizeof(point4));
-    vector<point4> sunTemp = theSun.getVertices();
-    for(int i = 0; i < sunTemp.size(); i++) { sunPoints[i] = sunTemp[i]; }
-    sunTemp.clear();
-    
-    sunNorms = (vec3 *) malloc(theSun.getNormals().size() * sizeof(vec3));
-    vector<vec3> sunTemp2 = theSun.getNormals();
-    for(int i = 0; i < sunTemp2.size(); i++) { sunNorms[i] = sunTemp2[i]; }
-    sunTemp2.clear();
-}
-
 void init() {
-    genBufferData();
-    
-    glGenBuffers(1, &mercBuf);  //Mercury VBO
-    glBindBuffer(GL_ARRAY_BUFFER, mercBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(mercPoints) + sizeof(mercNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(mercPoints), mercPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(mercPoints), sizeof(mercNorms), mercNorms);
-    
-    glGenBuffers(1, &venBuf);  //Venus VBO
-    glBindBuffer(GL_ARRAY_BUFFER, venBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(venPoints) + sizeof(venNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(venPoints), venPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(venPoints), sizeof(venNorms), venNorms);
-    
-    glGenBuffers(1, &earthBuf);  //Earth VBO
-    glBindBuffer(GL_ARRAY_BUFFER, earthBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(earthPoints) + sizeof(earthNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(earthPoints), earthPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(earthPoints), sizeof(earthNorms), earthNorms);
-    
-    glGenBuffers(1, &marsBuf);  //Mars VBO
-    glBindBuffer(GL_ARRAY_BUFFER, marsBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(marsPoints) + sizeof(marsNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(marsPoints), marsPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(marsPoints), sizeof(marsNorms), marsNorms);
-    
-    glGenBuffers(1, &jupBuf);  //Jupiter VBO
-    glBindBuffer(GL_ARRAY_BUFFER, jupBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(jupPoints) + sizeof(jupNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(jupPoints), jupPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(jupPoints), sizeof(jupNorms), jupNorms);
-    
-    glGenBuffers(1, &satBuf);  //Saturn VBO
-    glBindBuffer(GL_ARRAY_BUFFER, satBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(satPoints) + sizeof(satNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(satPoints), satPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(satPoints), sizeof(satNorms), satNorms);
-    
-    glGenBuffers(1, &urBuf);  //Uranus VBO
-    glBindBuffer(GL_ARRAY_BUFFER, urBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(urPoints) + sizeof(urNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(urPoints), urPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(urPoints), sizeof(urNorms), urNorms);
-    
-    glGenBuffers(1, &nepBuf);  //Neptune VBO
-    glBindBuffer(GL_ARRAY_BUFFER, nepBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(nepPoints) + sizeof(nepNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(nepPoints), nepPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(nepPoints), sizeof(nepNorms), nepNorms);
-    
-    glGenBuffers(1, &sunBuf);  //Sun VBO
-    glBindBuffer(GL_ARRAY_BUFFER, sunBuf);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(sunPoints) + sizeof(sunNorms), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(sunPoints), sunPoints);
-    glBufferSubData(GL_ARRAY_BUFFER, sizeof(sunPoints), sizeof(sunNorms), sunNorms);
-    
-    program = InitShader("vshader.glsl", "fshader.glsl");
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, 512, 512);
+    vector<point4> points;
+    vector<vec3> norms;
+    vector<vec2> texCoords;
+    vector<GLuint> indices;
+    createUnitSphere(points, norms, texCoords, indices);
+    int sphereId = meshPool.add(points, norms, texCoords, indices);
+    meshPool.upload();
+    sphereMesh = meshPool.mesh(sphereId);
+    pointMesh = createPointMesh();
+    setDefaultAttributes();
+    
+    //Every program is requested up front so the driver can compile them together; only the main one is waited for
+    useMultiDraw = allowMultiDraw && MultiDrawBatch::supported();
+    if(useMultiDraw) sphereBatch.init(programs);
+    shadows.init(programs, shadowSize);
+    rings.init(programs, bodies, ringParticles);
+    trails.init(programs, bodies, trailLength);
+    occlusion.init(programs, bodies);
+    occlusion.setEnabled(occlusionOn);
+    impostors.init(programs);
+    text.init(programs);
+    resolution.init(programs, resolutionBudget > 0 ? resolutionBudget : 1000.0 / 60, upscaleSharpness);
+    resolution.setEnabled(resolutionBudget > 0);
+    profiler.init(programs, PHASE_NAMES, NUM_PHASES);
+    profiler.setEnabled(profileLog || profileOverlay);
+    chrono::steady_clock::time_point starStart = chrono::steady_clock::now();
+    if(stars.load(programs, starPath))
+        cout << "Mapped " << stars.size() << " stars from " << starPath << " in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - starStart).count() << " ms" << endl;
+    program = programs.wait(programs.request("vshader.glsl", "fshader.glsl"));
+    if(program == 0) exit(EXIT_FAILURE);
+    uniforms.reflect(program);
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    uniforms.bindBlock("Object", OBJECT_BINDING);
+    uniforms.bindBlock("Shadow", SHADOW_BINDING);
+    glUseProgram(program);
+    glUniform1i(uniforms.location("ShadowMap"), SHADOW_TEXTURE_UNIT);
+    glUniform1i(uniforms.location("SurfaceMap"), SURFACE_TEXTURE_UNIT);
+    if(textures.init(textureDir, bodies, compressTextures) > 0)  //Decoded in the background; bodies start untextured
+        cout << "Streaming " << textures.getTextureCount() << " textures from " << textureDir << endl;
+    
+    streamBuffer.init();
+    size_t align = streamBuffer.getUniformAlignment();
+    objectStride = (sizeof(ObjectUniforms) + align - 1) / align * align;
+    
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, frameTarget);
+    glViewport(0, 0, winWidth, winHeight);
+    aspect = (GLfloat) winWidth / winHeight;
     glEnable( GL_DEPTH_TEST );  //Enable z-buffer testing
     glDepthFunc(GL_LESS);
-    glClearColor(0.132, 0.171, 1.0, 1.0);  //ClearColor is a dark blue
+    if(stars.size() > 0) glClearColor(0.0, 0.0, 0.0, 1.0);  //Black behind the stars
+    else glClearColor(0.132, 0.171, 1.0, 1.0);  //ClearColor is a dark blue
     glLineWidth(2.0);
 }
 
-void setUpLightingParams(mat4 mv, Planet* p) {
-    
-    color4 ambProd = p->getAmbProd();
-    color4 diffProd = p->getDiffProd();
-    color4 specProd = p->getSpecProd();
-    
-    glUniform4fv( glGetUniformLocation(program, "AmbientProduct"),
-                 1, ambProd);
-    glUniform4fv( glGetUniformLocation(program, "DiffuseProduct"),
-                 1, diffProd);
-    glUniform4fv( glGetUniformLocation(program, "SpecularProduct"),
-                 1, specProd);
-    
-    // The Light Position in Eye Frame
-    vec4 light_position_eyeFrame = mv * lightPos;
-    glUniform4fv( glGetUniformLocation(program, "LightPosition"),
-                 1, light_position_eyeFrame);
-    
-    glUniform1f(glGetUniformLocation(program, "ConstAtt"),
-                const_att);
-    glUniform1f(glGetUniformLocation(program, "LinearAtt"),
-                linear_att);
-    glUniform1f(glGetUniformLocation(program, "QuadAtt"),
-                quad_att);
-    glUniform1f(glGetUniformLocation(program, "Shininess"),
-                material_shininess );
+//Per-frame light block
+void setUpLight(mat4 view) {
+    LightUniforms light;
+    // The Light Position in Eye Frame (the Sun is body 0, already relative to the camera)
+    light.position = view * vec4(bodies.relPos[0], 1.0);
+    light.shininess = material_shininess;
+    light.constAtt = const_att;  light.linearAtt = linear_att;  light.quadAtt = quad_att;
+    DynamicSlice slice = streamBuffer.upload(&light, sizeof(light), streamBuffer.getUniformAlignment());
+    glBindBufferRange(GL_UNIFORM_BUFFER, LIGHT_BINDING, slice.buffer, slice.offset, slice.size);
 }
 
-void drawObj(GLuint buffer, long numVertices) {
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    
-    //----- Set up vertex attribute arrays for each vertex attribute -----/
-    GLuint vPosition = glGetAttribLocation(program, "vPosition");
-    glEnableVertexAttribArray(vPosition);
-    glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0) );
-    
-    GLuint vNormal = glGetAttribLocation( program, "vNormal" );
-    glEnableVertexAttribArray( vNormal );
-    glVertexAttribPointer( vNormal, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(sizeof(point4) * numVertices) );
-    
-    glDrawArrays(GL_TRIANGLES, 0, numVertices);
-    
-    //--- Disable each vertex attribute array being enabled ---/
-    glDisableVertexAttribArray(vPosition);
-    glDisableVertexAttribArray(vNormal);
+void setUpLightingParams(ObjectUniforms& obj, int body, bool textured) {
+    color4 color = textured ? white_ambient : bodies.colors[body];  //A surface map supplies its own colors
+    obj.ambient = color * material_ambient;
+    obj.diffuse = color * material_diffuse;
+    obj.specular = color * material_specular;
 }
 
-void display( void ) {
-    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-    
-    glUseProgram(program); // Use the shader program
-    
-    model_view = glGetUniformLocation(program, "model_view" );
-    projection = glGetUniformLocation(program, "projection" );
+//Record k of this frame's object data, growing the staging buffer as needed
+ObjectUniforms& objectRecord(size_t k) {
+    if((k + 1) * objectStride > objectData.size()) objectData.resize((k + 1) * objectStride * 2);
+    return *(ObjectUniforms*) &objectData[k * objectStride];
+}
+
+//Draw one frame of the scene at simTime into frameTarget
+void renderFrame() {
+    //Phases run back to back, each ended where the next begins (profiler.h)
+    profiler.beginFrame();
+    streamBuffer.beginFrame();  //Waits, if at all, for the GPU to finish with the frame NUM_REGIONS back
+    //The scene is drawn at renderWidth x renderHeight into sceneTarget, and scaled up to frameTarget before the text
+    GLuint sceneTarget = resolution.begin(frameTarget, winWidth, winHeight);
+    int renderWidth = resolution.getWidth(), renderHeight = resolution.getHeight();
+    totalScale += resolution.getScale();  minScale = min(minScale, (double) resolution.getScale());
+    profiler.begin(PHASE_SIMULATION);
+    
+    //Floating origin: everything is made relative to the camera in double precision before it becomes float
+    bodies.updatePositions(simTime, workers);
+    dvec3 focus = bodies.position(focusBody);
+    eye = focus + eyeOffset;
+    bodies.cameraRelative(eye);
+    chrono::steady_clock::time_point refitStart = chrono::steady_clock::now();
+    picker.refit(bodies, winHeight / (2 * tan(fovy * DegreesToRadians / 2)), workers);  //Picks are in window pixels
+    totalPickRefit += chrono::duration<double>(chrono::steady_clock::now() - refitStart).count();
+    profiler.end(PHASE_SIMULATION);
     
     /*---  Set up and pass on Projection matrix to the shader ---*/
-    mat4  p = Perspective(fovy, aspect, near, far); //use this to make a perspective projection, call from init()
-    
-    glUniformMatrix4fv(projection, 1, GL_TRUE, p); // GL_TRUE: matrix is row-major
-    
-    // Generate the model-view matrix
-    vec4 at(0.0, 0.0, 0.0, 1.0);
+    far = (GLfloat) bodies.farthestPoint;
+    near = (GLfloat) max(bodies.nearestSurface * 0.5, bodies.farthestPoint * 1e-7);  //Keep far/near within what the depth buffer can resolve
+    profiler.begin(PHASE_CULLING);
+    CameraUniforms camera;
+    camera.projection = Perspective(fovy, aspect, near, far);
+    
+    // Generate the view matrix with the camera at the origin
+    dvec3 toFocus = focus - eye;
+    vec4 at((GLfloat) toFocus.x, (GLfloat) toFocus.y, (GLfloat) toFocus.z, 1.0);
     vec4 up(0.0, 1.0, 0.0, 0.0); //VUP
-    mat4 mv = LookAt(eye, at, up); // model-view matrix using Correct LookAt() model-view matrix for the light position.
-    
-    setUpLightingParams(mv, &Mercury);
-    glUniformMatrix4fv(model_view, 1, GL_TRUE, mv); // GL_TRUE: matrix is row-major
-    mat3 normal_matrix = NormalMatrix(mv, 1);
-    glUniformMatrix3fv(glGetUniformLocation(program, "normal_matrix"), 1, GL_TRUE, normal_matrix);
+    mat4 view = LookAt(vec4(0.0, 0.0, 0.0, 1.0), at, up);
+    camera.view = view;
+    //Row-major, like the blocks' layout
+    DynamicSlice cameraSlice = streamBuffer.upload(&camera, sizeof(camera), streamBuffer.getUniformAlignment());
+    glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, cameraSlice.buffer, cameraSlice.offset, cameraSlice.size);
+    setUpLight(view);
+    
+    //Only the sphere bodies whose bounding spheres touch the view frustum, and weren't hidden last frame, are drawn
+    lastProjectionView = camera.projection * view;
+    ViewFrustum frustum;
+    frustum.extract(lastProjectionView);
+    visibleBodies.clear();
+    size_t inFrustum = cullSpheres(frustum, bodies.sphereX.data(), bodies.sphereY.data(), bodies.sphereZ.data(),
+                                   bodies.sphereR.data(), bodies.sphereIds.data(), bodies.sphereIds.size(), visibleBodies);
+    occlusion.classify(visibleBodies, hiddenBodies);
+    bodiesCulled = bodies.sphereIds.size() - inFrustum;
+    bodiesOccluded = hiddenBodies.size();
+    bodiesDrawn = visibleBodies.size();
+    totalDrawn += bodiesDrawn;  totalCulled += bodiesCulled;  totalOccluded += bodiesOccluded;
+    profiler.end(PHASE_CULLING);
+    
+    //Surface maps at the detail each body needs on screen
+    profiler.begin(PHASE_TEXTURES);
+    GLfloat pixelsPerRadian = renderHeight / (2 * tan(fovy * DegreesToRadians / 2));
+    textures.update(streamBuffer, bodies, visibleBodies, pixelsPerRadian);
+    profiler.end(PHASE_TEXTURES);
+    
+    //Shadow maps for what is on screen, then back to the frame
+    profiler.begin(PHASE_SHADOWS);
+    shadows.render(programs, streamBuffer, bodies, visibleBodies, sphereMesh, pixelsPerRadian, shadowsOn);
+    totalCasterDraws += shadows.getCasterDraws();
+    shadows.bindTexture();
+    profiler.end(PHASE_SHADOWS);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget);
+    glViewport(0, 0, renderWidth, renderHeight);
+    glUseProgram(program); // Use the shader program
     
     if (wireFlag == 1) // Filled floor
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     else              // Wireframe floor
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    
+    //Until their programs have built, the multi-draw batch falls back to one draw per body with the main program, and
+    //impostor bodies are drawn as meshes
+    bool multiDraw = useMultiDraw && sphereBatch.ready(programs);
+    bool useImpostors = impostorsOn && impostors.ready(programs);
+    
+    //Untextured bodies under ImpostorBatch::MAX_PIXELS on screen become impostors. One ObjectUniforms record per
+    //remaining sphere body, then one for the point bodies; uploaded together.
+    //Textured bodies need a texture bind each, so they are drawn one at a time even when the rest are batched
+    profiler.begin(PHASE_UNIFORMS);
+    long firstPoint = bodies.pointEnd > bodies.pointBegin ? (long) bodies.pointBegin : -1;
+    GLfloat halfLine = wireFlag == 0 ? 1.0 : 0.0;  //Pixels the 2 px wide lines of a wireframe mesh reach past it
+    meshBodies.clear();
+    sphereBatch.clear();
+    impostors.clear();
+    for(size_t k = 0; k < visibleBodies.size(); k++) {
+        int i = visibleBodies[k];
+        bool textured = textures.texture(i) != 0;
+        GLfloat dist = length(bodies.relPos[i]);
+        if(useImpostors && !textured && bodies.renderRadius[i] * pixelsPerRadian < ImpostorBatch::MAX_PIXELS * dist) {
+            ObjectUniforms obj;
+            setUpLightingParams(obj, i, false);
+            vec4 center = view * vec4(bodies.relPos[i], 1.0);
+            impostors.add(vec3(center.x, center.y, center.z), bodies.renderRadius[i] + halfLine * dist / pixelsPerRadian,
+                          obj.ambient, obj.diffuse, obj.specular);
+            continue;
+        }
+        ObjectUniforms& obj = objectRecord(meshBodies.size());
+        meshBodies.push_back(i);
+        obj.modelView = view * bodies.models[i];
+        obj.setNormalMatrix(NormalMatrix(obj.modelView, 0));  //Uniform scale only; the shader renormalizes
+        setUpLightingParams(obj, i, textured);
+        obj.textured = textured;
+        if(multiDraw && !textured) sphereBatch.add(sphereMesh, obj);
+    }
+    size_t numSpheres = meshBodies.size();
+    bodiesImpostors = impostors.size();
+    totalImpostors += bodiesImpostors;
+    if(firstPoint >= 0) {  //Points get the ambient term only
+        ObjectUniforms& obj = objectRecord(numSpheres);
+        obj.modelView = view;
+        obj.setNormalMatrix(NormalMatrix(view, 0));
+        obj.ambient = bodies.colors[firstPoint];
+        obj.diffuse = obj.specular = color4(0.0, 0.0, 0.0, 1.0);
+        obj.textured = 0;
+    }
+    size_t numRecords = numSpheres + (firstPoint >= 0 ? 1 : 0);
+    DynamicSlice objects = streamBuffer.upload(objectData.data(), numRecords * objectStride, streamBuffer.getUniformAlignment());
+    profiler.end(PHASE_UNIFORMS);
+    
+    profiler.begin(PHASE_DRAW);
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );  //Cleared here, after the shadow pass, so it counts as drawing
+    if(multiDraw) {  //One submission for every untextured sphere
+        sphereBatch.draw(streamBuffer);
+        glUseProgram(program);
+    }
+    glActiveTexture(GL_TEXTURE0 + SURFACE_TEXTURE_UNIT);
+    for(size_t k = 0; k < numSpheres; k++) {
+        GLuint texture = textures.texture(meshBodies[k]);
+        if(multiDraw && texture == 0) continue;  //Already drawn by the batch
+        if(texture != 0) glBindTexture(GL_TEXTURE_2D, texture);
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, objects.buffer, objects.offset + k * objectStride, sizeof(ObjectUniforms));
+        occlusion.beginDraw(meshBodies[k]);
+        drawMesh(sphereMesh);
+        occlusion.endDraw(meshBodies[k]);
+    }
+    if(useImpostors && impostors.size() > 0) {  //One instanced draw for every impostor
+        impostors.draw(streamBuffer);
+        glUseProgram(program);
+    }
+    
+    if(firstPoint >= 0) {  //Minor planets: one draw over the contiguous run of point bodies
+        updatePoints(pointMesh, streamBuffer, &bodies.relPos[firstPoint], bodies.pointEnd - bodies.pointBegin);
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, objects.buffer, objects.offset + numSpheres * objectStride,
+                          sizeof(ObjectUniforms));
+        drawMesh(pointMesh);
+    }
+    stars.draw(programs, pixelsPerRadian);  //Last, so only the background is shaded
+    totalStars += stars.getStarsDrawn();
+    profiler.end(PHASE_DRAW);
+    
+    //Against the depth of everything opaque: next frame's occlusion results
+    profiler.begin(PHASE_OCCLUSION);
+    occlusion.testProxies(programs, bodies, visibleBodies, hiddenBodies, near, pixelsPerRadian);
+    totalConditional += occlusion.getConditional();
+    profiler.end(PHASE_OCCLUSION);
+    
+    if(trailsOn) {  //Blended, so after everything opaque
+        ProfileScope scope(profiler, PHASE_TRAILS);
+        trails.append(streamBuffer, bodies, eye, simTime);
+        trails.draw(programs, streamBuffer, eye);
+    }
+    if(ringsOn) {
+        ProfileScope scope(profiler, PHASE_RINGS);
+        rings.draw(programs, bodies, view, frustum, pixelsPerRadian, simTime);
+        totalRingParticles += rings.getParticlesDrawn();
+    }
+    {
+        ProfileScope scope(profiler, PHASE_UPSCALE);
+        resolution.finish(programs, frameTarget, winWidth, winHeight);
+    }
+    {  //On top of the scene, at the window's resolution
+        ProfileScope scope(profiler, PHASE_LABELS);
+        text.begin(winWidth, winHeight, max(winHeight / 480, 1));
+        labels.layout(text, bodies, visibleBodies, lastProjectionView, pixelsPerRadian * winHeight / renderHeight,
+                      labelsOn);
+        text.draw(programs, streamBuffer);
+    }
+    if(profileOverlay) profiler.drawOverlay(programs, streamBuffer, winWidth, winHeight);
+    streamBuffer.endFrame();
+}
+
+//Print what is known about body i: a planet's own report, or its catalog entry
+void printBodyInfo(int i) {
+    for(size_t p = 0; p < planets.size(); p++) {
+        if(planets[p]->getName() == bodies.names[i]) { planets[p]->getInfo();  return; }
+    }
+    const OrbitalElements& el = bodies.elements[i];
+    cout << (bodies.flags[i] & BODY_POINT ? "Minor planet: " : "Body: ") << bodies.names[i] << endl;
+    if(!(bodies.flags[i] & BODY_POINT)) cout << "\tRadius Compared to Earth: " << bodies.radius[i] / AU_PER_EARTH_RADIUS << endl;
+    if(bodies.parents[i] >= 0) cout << "\tOrbits: " << bodies.names[bodies.parents[i]] << endl;
+    if(el.period > 0) {
+        cout << "\tSemi-Major Axis of Orbit (AU): " << el.major << endl;
+        cout << "\tEccentricity: " << el.eccentricity << endl;
+        cout << "\tPeriod of Orbit Compared to Earth: " << el.period << endl;
+    }
+}
+
+//Pick the body under window pixel (x, y) of the last frame, print it and how long it took
+void pickBody(int x, int y) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double distance = 0;
+    int hit = picker.pick(lastProjectionView, x, y, winWidth, winHeight, &distance);
+    chrono::steady_clock::time_point picked = chrono::steady_clock::now();
+    labels.select(hit);
+    if(hit >= 0) printBodyInfo(hit);
+    else cout << "No body at " << x << "," << y << endl;
+    cout << "Pick: " << chrono::duration<double>(picked - start).count() * 1e6 << " us over " << picker.size()
+         << " bodies" << (hit >= 0 ? ", hit at " : "");
+    if(hit >= 0) cout << distance << " AU";
+    cout << endl;
+}
 
-    int m = 0;
-    while(m+1 <= sizeof(mercPath)) {
-        point4 mercCurr = mercPath[m];
-        point4 mercNext = mercPath[m+1];  //Since loop only runs while mercNext isn't NULL, no need for a check to make sure within bounds
-        vec4 mercTVec;  //Translation vector for Mercury
-        vec4 mercRotVec;  //Rotation vector for Mercury
-        double mercP = Mercury.getPerim();  //Length of Mercury's orbit
+//Ends the profiled frame; every few seconds logs the breakdown (--profile) and shows it in the window title (overlay)
+void reportFrame(bool windowTitle) {
+    if(!profiler.endFrame()) return;
+    string summary = profiler.summary();
+    if(profileLog) cout << summary << endl;
+    if(windowTitle && profileOverlay) glutSetWindowTitle(summary.c_str());
+}
+
+void display( void ) {
+    renderFrame();
+    {
+        ProfileScope scope(profiler, PHASE_SWAP);
+        glutSwapBuffers();
     }
-    drawObj(mercBuf, Mercury.getNumVertices());
+    reportFrame(true);
+}
+
+void reshape(int width, int height) {
+    winWidth = width;  winHeight = max(height, 1);
+    glViewport(0, 0, winWidth, winHeight);
+    aspect = (GLfloat) winWidth / winHeight;
+}
+
+//Render frames evenly spaced from startYear to endYear offscreen, as fast as possible, and report the frame rate;
+//with --capture, every frame is also read back and written out
+int renderHeadless(int frames, int width, int height, double startYear, double endYear) {
+    HeadlessContext ctx;
+    if(!ctx.create()) return EXIT_FAILURE;
+#ifndef __APPLE__
+    glewExperimental = GL_TRUE;
+    glewInit();  //Reports a missing GLX display on headless machines, but the GL entry points are loaded by then
+#endif
+    if(!ctx.createFramebuffer(width, height)) return EXIT_FAILURE;
+    cout << "Headless: " << glGetString(GL_RENDERER) << ", " << width << "x" << height << endl;
+    
+    winWidth = width;  winHeight = height;
+    frameTarget = ctx.framebuffer();
+    init();
+    
+    FrameCapture capture;
+    if(!capturePath.empty() && !capture.open(capturePath, width, height, captureFps)) return EXIT_FAILURE;
+    
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < frames; i++) {
+        simTime = startYear - 2000.0 + (endYear - startYear) * (frames > 1 ? (double) i / (frames - 1) : 0.0);
+        renderFrame();
+        if(!capturePath.empty()) {
+            ProfileScope scope(profiler, PHASE_SWAP);  //Capture stands in for the swap
+            capture.capture();
+        }
+        reportFrame(false);
+    }
+    capture.finish();
+    glFinish();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if(pickX >= 0) {
+        pickBody(pickX, pickY);
+        cout << "Picking tree: refit every frame in " << totalPickRefit / frames * 1000 << " ms on average, "
+             << picker.getRebuilds() << " builds" << endl;
+    }
+    cout << "Rendered " << frames << " frames in " << seconds << " s (" << frames / seconds << " frames/s)" << endl;
+    cout << "Bodies per frame: " << (double) totalDrawn / frames << " drawn (" << (double) totalImpostors / frames
+         << " as impostors, " << (double) totalConditional / frames << " conditionally), " << (double) totalCulled / frames << " culled, " << (double) totalOccluded / frames
+         << " occluded, " << (double) totalCasterDraws / frames << " shadow caster draws, " << (double) totalRingParticles / frames
+         << " ring particles, " << (double) totalStars / frames << " stars" << endl;
+    if(resolution.isEnabled())
+        cout << "Dynamic resolution: scale " << totalScale / frames << " on average, " << minScale << " at least, "
+             << resolution.getScale() << " at the end; GPU frame " << resolution.getFrameMs() << " ms against "
+             << resolutionBudget << " ms" << endl;
+    cout << "Dynamic buffer: " << DynamicBuffer::NUM_REGIONS << " x " << streamBuffer.getRegionBytes() / 1e6 << " MB"
+         << (streamBuffer.isPersistent() ? " persistently mapped, " : " staged, ") << streamBuffer.getWaits()
+         << " waits on the GPU" << endl;
+    if(profileLog) cout << profiler.summary() << endl;
+    if(textures.getTextureCount() > 0)
+        cout << "Textures: " << textures.getResidentBytes() / 1e6 << " MB resident and "
+             << textures.getDecodedBytes() / 1e6 << " MB decoded in memory at the end, "
+             << textures.getStreamedBytes() / 1e6 << " MB streamed, " << textures.getDecodes() << " decodes" << endl;
+    if(!capturePath.empty()) {
+        cout << "Captured " << capture.getFrames() << " frames to " << capturePath << "; capture took "
+             << capture.getCaptureSeconds() * 1000 / frames << " ms/frame on the render thread ("
+             << capture.getStallSeconds() * 1000 / frames << " ms waiting for the encoder)" << endl;
+        if(capture.getFrames() != frames) return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+void idle( void ) {
+    int now = glutGet(GLUT_ELAPSED_TIME);
+    simTime += (now - lastTick) / 1000.0 * timeScale;
+    lastTick = now;
+    glutPostRedisplay();
+}
+
+void mouse(int button, int state, int x, int y) {
+    if(button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) pickBody(x, y);
+}
+
+void keyboard(unsigned char key, int x, int y) {
+    switch(key) {
+        case 'q': case 'Q': case 033: exit(EXIT_SUCCESS);
+        case 'w': case 'W': wireFlag = 1 - wireFlag; break;
+        case '+': case '=': eyeOffset *= 0.8; break;  //Zoom toward the focused body
+        case '-': case '_': eyeOffset *= 1.25; break;
+        case 'c': case 'C':
+            cout << "Bodies drawn: " << bodiesDrawn << " (" << bodiesImpostors << " as impostors, "
+                 << occlusion.getConditional() << " conditionally), culled: "
+                 << bodiesCulled << ", occluded: " << bodiesOccluded << "; shadow layers: "
+                 << shadows.getFacesRendered() << ", caster draws: " << shadows.getCasterDraws() << "; textures: "
+                 << textures.getResidentBytes() / 1e6 << " MB resident; ring particles: " << rings.getParticlesDrawn()
+                 << "; stars: " << stars.getStarsDrawn() << endl;
+            break;
+        case 's': case 'S':
+            shadowsOn = !shadowsOn;
+            cout << "Shadows " << (shadowsOn ? "on" : "off") << endl;
+            break;
+        case 'r': case 'R':
+            ringsOn = !ringsOn;
+            cout << "Rings " << (ringsOn ? "on" : "off") << endl;
+            break;
+        case 't': case 'T':
+            trailsOn = !trailsOn;
+            trails.clear();  //Nothing was appended while they were off
+            cout << "Trails " << (trailsOn ? "on" : "off") << endl;
+            break;
+        case 'o': case 'O':
+            occlusionOn = !occlusionOn;
+            occlusion.setEnabled(occlusionOn);
+            cout << "Occlusion culling " << (occlusionOn ? "on" : "off") << endl;
+            break;
+        case 'i': case 'I':
+            impostorsOn = !impostorsOn;
+            cout << "Impostors " << (impostorsOn ? "on" : "off") << endl;
+            break;
+        case 'l': case 'L':
+            labelsOn = !labelsOn;
+            cout << "Labels " << (labelsOn ? "on" : "off") << endl;
+            break;
+        case 'd': case 'D':
+            resolution.setEnabled(!resolution.isEnabled());
+            cout << "Dynamic resolution " << (resolution.isEnabled() ? "on" : "off") << endl;
+            break;
+        case 'p': case 'P':  //Bars per phase: CPU above GPU, solid to p50, faded to p99; 16.7 ms marked
+            profileOverlay = !profileOverlay;
+            profiler.setEnabled(profileLog || profileOverlay);
+            if(!profileOverlay) glutSetWindowTitle("Solar System");
+            cout << "Profiler overlay " << (profileOverlay ? "on" : "off") << endl;
+            break;
+        case 'f': case 'F':  //Focus the next body, framed at a few times its displayed size
+            do { focusBody = (focusBody + 1) % bodies.size(); } while(bodies.flags[focusBody] & BODY_POINT);
+            eyeOffset = normalize(eyeOffset) * (bodies.renderRadius[focusBody] * 8);
+            cout << "Focus: " << bodies.names[focusBody] << endl;
+            break;
+    }
+    glutPostRedisplay();
 }
 
 int main(int argc, const char * argv[]) {
-    pairMoonPlanet();
+    vector<const char*> args;  //Command line without the options handled here
+    for(int i = 0; i < argc; i++) {
+        if(strcmp(argv[i], "--catalog") == 0 && i+1 < argc) catalogPath = argv[++i];
+        else if(strcmp(argv[i], "--smallbodies") == 0 && i+1 < argc) smallBodyPath = argv[++i];
+        else if(strcmp(argv[i], "--capture") == 0 && i+1 < argc) capturePath = argv[++i];
+        else if(strcmp(argv[i], "--fps") == 0 && i+1 < argc) captureFps = max(atoi(argv[++i]), 1);
+        else if(strcmp(argv[i], "--no-multidraw") == 0) allowMultiDraw = false;
+        else if(strcmp(argv[i], "--shadows") == 0 && i+1 < argc) shadowSize = max(atoi(argv[++i]), 0);
+        else if(strcmp(argv[i], "--rings") == 0 && i+1 < argc) ringParticles = max(atoi(argv[++i]), 0);
+        else if(strcmp(argv[i], "--trails") == 0 && i+1 < argc) trailLength = max(atoi(argv[++i]), 0);
+        else if(strcmp(argv[i], "--textures") == 0 && i+1 < argc) textureDir = argv[++i];
+        else if(strcmp(argv[i], "--compress-textures") == 0) compressTextures = true;
+        else if(strcmp(argv[i], "--profile") == 0) profileLog = true;
+        else if(strcmp(argv[i], "--no-occlusion") == 0) occlusionOn = false;
+        else if(strcmp(argv[i], "--no-impostors") == 0) impostorsOn = false;
+        else if(strcmp(argv[i], "--no-labels") == 0) labelsOn = false;
+        else if(strcmp(argv[i], "--dynamic-resolution") == 0 && i+1 < argc) resolutionBudget = max(atof(argv[++i]), 0.0);
+        else if(strcmp(argv[i], "--sharpen") == 0 && i+1 < argc) upscaleSharpness = (GLfloat) max(atof(argv[++i]), 0.0);
+        else if(strcmp(argv[i], "--stars") == 0 && i+1 < argc) starPath = argv[++i];
+        else if(strcmp(argv[i], "--pick") == 0 && i+1 < argc) {
+            if(sscanf(argv[++i], "%d,%d", &pickX, &pickY) != 2 || pickX < 0 || pickY < 0) {
+                cerr << "Error: expected the pick position as <x>,<y>, got " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[i], "--shader-cache") == 0 && i+1 < argc) programs.setDirectory(argv[++i]);
+        else if(strcmp(argv[i], "--no-shader-cache") == 0) programs.disable();
+        else if(strcmp(argv[i], "--shader-dir") == 0 && i+1 < argc) setShaderDirectory(argv[++i]);
+        else args.push_back(argv[i]);
+    }
+    
+    if(!loadCatalog(catalogPath, bodies) || bodies.size() == 0) {
+        cerr << "Error: could not load the body catalog from " << catalogPath << endl;
+        exit(EXIT_FAILURE);
+    }
+    createBodies();
+    
+    if(args.size() > 1 && strcmp(args[1], "events") == 0) {  //Usage: events [startYear] [endYear]
+        double startYear = args.size() > 2 ? atof(args[2]) : 2000.0;
+        double endYear = args.size() > 3 ? atof(args[3]) : startYear + 100.0;
+        findEvents(startYear, endYear);
+        return 0;
+    }
+    if(args.size() > 2 && strcmp(args[1], "catalog") == 0) {  //Usage: catalog <out.bin>; converts the loaded catalog to binary
+        return saveCatalogBinary(args[2], bodies) ? 0 : 1;
+    }
+    if(args.size() > 3 && strcmp(args[1], "stars") == 0) {  //Usage: stars <in.csv> <out.bin>; see starfield.h
+        return convertStarCatalog(args[2], args[3]) ? 0 : 1;
+    }
+    
+    workers = new ThreadPool();
+    if(!smallBodyPath.empty()) {  //Usage: --smallbodies MPCORB.DAT; appended after the catalog bodies
+        MpcLoadStats stats;
+        if(!loadMpcOrbits(smallBodyPath, bodies, *workers, &stats)) exit(EXIT_FAILURE);
+        cout << "Loaded " << stats.rows << " minor planets (" << stats.skipped << " bad rows) from " << smallBodyPath << " in "
+             << stats.seconds << " s, " << (long) stats.rowsPerSecond() << " rows/s, "
+             << stats.bytes / stats.seconds / 1e6 << " MB/s" << endl;
+        if(args.size() > 1 && strcmp(args[1], "smallbodies") == 0) return 0;  //Load and report only
+    }
+    
     theSun.addPlanets(planets);
-    createSunObj();
-    createSphereObj(planets);
-    createSphereObj(moons);
     
     calcOrbit(planets);
-    for(int i = 0; i < planets.size(); i++) { calcNormals(planets[i], 0, 1, 2); }
     
-    setColors();
     calcColors(planets);
     
-    Mercury.getInfo();
-    Venus.getInfo();
-    Earth.getInfo();
-    Mars.getInfo();
-    Jupiter.getInfo();
-    Saturn.getInfo();
-    Uranus.getInfo();
-    Neptune.getInfo();
+    if(args.size() > 1 && strcmp(args[1], "render") == 0) {  //Usage: render [frames] [width]x[height] [startYear] [endYear]
+        int frames = args.size() > 2 ? atoi(args[2]) : 100;
+        int width = 512, height = 512;
+        if(args.size() > 3 && sscanf(args[3], "%dx%d", &width, &height) != 2) {
+            cerr << "Error: expected the resolution as <width>x<height>, got " << args[3] << endl;
+            return EXIT_FAILURE;
+        }
+        double startYear = args.size() > 4 ? atof(args[4]) : 2000.0;
+        double endYear = args.size() > 5 ? atof(args[5]) : startYear + 1.0;
+        if(frames < 1 || width < 1 || height < 1) {
+            cerr << "Error: frames and resolution must be positive" << endl;
+            return EXIT_FAILURE;
+        }
+        return renderHeadless(frames, width, height, startYear, endYear);
+    }
+    
+    for(int i = 0; i < planets.size(); i++) { planets[i]->getInfo(); }
+    
+    glutInit(&argc, (char**) argv);
+#ifdef __APPLE__
+    glutInitDisplayMode(GLUT_3_2_CORE_PROFILE | GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+#else
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+#endif
+    glutInitWindowSize(winWidth, winHeight);
+    glutCreateWindow("Solar System");
+#ifndef __APPLE__
+    glewExperimental = GL_TRUE;
+    glewInit();
+#endif
+    
+    init();
+    glutDisplayFunc(display);
+    glutReshapeFunc(reshape);
+    glutIdleFunc(idle);
+    glutKeyboardFunc(keyboard);
+    glutMouseFunc(mouse);
+    lastTick = glutGet(GLUT_ELAPSED_TIME);
+    glutMainLoop();
+    return 0;
 }
@@ -0,0 +1,42 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//Read-only memory-mapped file, read front to back; unmapped when it goes out of scope
+struct MappedFile {
+    const char* data;
+    size_t size;
+    MappedFile() : data(NULL), size(0) {}
+    ~MappedFile() { if(data != NULL && size > 0) munmap((void*) data, size); }
+
+    bool open(const string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        size = ok ? (size_t) st.st_size : 0;
+        if(ok && size > 0) {
+            void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = (p != MAP_FAILED);
+            if(ok) {
+                data = (const char*) p;
+                madvise(p, size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        return ok;
+    }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif // __MAPPEDFILE_H__
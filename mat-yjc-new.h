@@ -894,6 +894,7 @@ namespace Angel {
         c[2][2] = -(zFar + zNear)/(zFar - zNear);
         c[2][3] = -2.0*zFar*zNear/(zFar - zNear);
         c[3][2] = -1.0;
+        c[3][3] = 0.0;  // mat4() starts as the identity; w must be -z_eye alone
         return c;
     }
     
@@ -910,6 +911,7 @@ namespace Angel {
         c[2][2] = -(zFar + zNear)/(zFar - zNear);
         c[2][3] = -2.0*zFar*zNear/(zFar - zNear);
         c[3][2] = -1.0;
+        c[3][3] = 0.0;  // mat4() starts as the identity; w must be -z_eye alone
         return c;
     }
     
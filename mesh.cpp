@@ -0,0 +1,75 @@
+#include "mesh.h"
+
+int MeshPool::add(const vector<point4>& p, const vector<vec3>& n, const vector<vec2>& uv, const vector<GLuint>& idx) {
+    Mesh mesh;
+    mesh.count = (GLsizei) idx.size();
+    mesh.firstIndex = (GLuint) indices.size();
+    mesh.baseVertex = (GLint) points.size();
+    points.insert(points.end(), p.begin(), p.end());
+    norms.insert(norms.end(), n.begin(), n.end());
+    texCoords.insert(texCoords.end(), uv.begin(), uv.end());
+    indices.insert(indices.end(), idx.begin(), idx.end());
+    meshes.push_back(mesh);
+    return (int) meshes.size() - 1;
+}
+
+void MeshPool::upload() {
+    GLuint vao, vbo, ibo;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vbo);  //All positions, followed by all normals and all texture coordinates
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    size_t normalOffset = sizeof(point4) * points.size();
+    size_t texCoordOffset = normalOffset + sizeof(vec3)*norms.size();
+    glBufferData(GL_ARRAY_BUFFER, texCoordOffset + sizeof(vec2)*texCoords.size(), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, normalOffset, &points[0]);
+    glBufferSubData(GL_ARRAY_BUFFER, normalOffset, sizeof(vec3)*norms.size(), &norms[0]);
+    glBufferSubData(GL_ARRAY_BUFFER, texCoordOffset, sizeof(vec2)*texCoords.size(), &texCoords[0]);
+
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+    glVertexAttribPointer(ATTRIB_POSITION, 4, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+    glEnableVertexAttribArray(ATTRIB_NORMAL);
+    glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(normalOffset));
+    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+    glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(texCoordOffset));
+
+    glGenBuffers(1, &ibo);  //Recorded in the VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    for(size_t i = 0; i < meshes.size(); i++) { meshes[i].vao = vao;  meshes[i].vbo = vbo;  meshes[i].ibo = ibo; }
+    points.clear();  norms.clear();  texCoords.clear();  indices.clear();
+}
+
+Mesh createPointMesh() {
+    Mesh mesh;
+    mesh.mode = GL_POINTS;
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+    glEnableVertexAttribArray(ATTRIB_POSITION);  //The buffer is attached by updatePoints()
+    glBindVertexArray(0);
+    return mesh;
+}
+
+void updatePoints(Mesh& mesh, DynamicBuffer& stream, const vec3* positions, GLsizei count) {
+    DynamicSlice slice = stream.upload(positions, sizeof(vec3) * count, 16);
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slice.buffer);
+    glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(slice.offset));  //w defaults to 1
+    mesh.vbo = slice.buffer;
+    mesh.count = count;
+}
+
+void setDefaultAttributes() {
+    glVertexAttrib3f(ATTRIB_NORMAL, 0.0, 1.0, 0.0);  //Meshes without normals only get the ambient term
+}
+
+void drawMesh(const Mesh& mesh) {
+    glBindVertexArray(mesh.vao);
+    if(mesh.ibo != 0)
+        glDrawElementsBaseVertex(mesh.mode, mesh.count, GL_UNSIGNED_INT, BUFFER_OFFSET(sizeof(GLuint) * mesh.firstIndex), mesh.baseVertex);
+    else
+        glDrawArrays(mesh.mode, 0, mesh.count);
+}
@@ -0,0 +1,57 @@
+#ifndef __MESH_H__
+#define __MESH_H__
+
+#include "Angel-yjc.h"
+#include "dynamicbuffer.h"
+#include <vector>
+
+typedef Angel::vec4     point4;
+
+using namespace std;
+
+/***
+ GPU meshes with their vertex layout recorded once in a vertex array object
+    - Attribute locations are fixed in the shaders (layout(location = ...)), so nothing is looked up at draw time
+    - Drawing a mesh is glBindVertexArray plus one draw call
+    - Attributes a mesh doesn't have (the normal of a point cloud) read the constant set by setDefaultAttributes()
+    - Static meshes share one vertex/index buffer pair (MeshPool), so any mix of them can go out in one multi-draw
+ ***/
+
+enum VertexAttrib { ATTRIB_POSITION = 0, ATTRIB_NORMAL = 1, ATTRIB_TEXCOORD = 2 };
+
+struct Mesh {
+    GLuint vao, vbo, ibo;  //ibo is 0 for non-indexed meshes
+    GLenum mode;
+    GLsizei count;  //Indices (or vertices) to draw
+    GLuint firstIndex;  //Offset into the index buffer, in indices
+    GLint baseVertex;   //Added to every index
+    Mesh() : vao(0), vbo(0), ibo(0), mode(GL_TRIANGLES), count(0), firstIndex(0), baseVertex(0) {}
+};
+
+//Indexed triangle meshes packed into one buffer: all vec4 positions, then all vec3 normals, then all vec2 texture
+//coordinates, plus one index buffer
+class MeshPool {
+public:
+    //Returns the mesh id
+    int add(const vector<point4>& points, const vector<vec3>& norms, const vector<vec2>& texCoords, const vector<GLuint>& indices);
+    void upload();  //Creates the shared VAO and buffers; call once, after every add()
+    const Mesh& mesh(int id) const { return meshes[id]; }
+    GLuint vao() const { return meshes.empty() ? 0 : meshes[0].vao; }
+
+private:
+    vector<point4> points;
+    vector<vec3> norms;
+    vector<vec2> texCoords;
+    vector<GLuint> indices;
+    vector<Mesh> meshes;
+};
+
+//Streamed point cloud of vec3 positions; updatePoints() copies them into this frame's slice of stream and points the
+//VAO at it
+Mesh createPointMesh();
+void updatePoints(Mesh& mesh, DynamicBuffer& stream, const vec3* positions, GLsizei count);
+
+void setDefaultAttributes();  //Call once after the context is created
+void drawMesh(const Mesh& mesh);
+
+#endif // __MESH_H__
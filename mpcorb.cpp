@@ -0,0 +1,217 @@
+#include "mpcorb.h"
+#include "threadpool.h"
+#include "mappedfile.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+//Column ranges (0-based, end exclusive) of the MPCORB.DAT record format
+enum {
+    COL_DESIG = 0,    COL_DESIG_END = 7,
+    COL_H = 8,        COL_H_END = 13,
+    COL_EPOCH = 20,   COL_EPOCH_END = 25,
+    COL_M = 26,       COL_M_END = 35,
+    COL_PERI = 37,    COL_PERI_END = 46,
+    COL_NODE = 48,    COL_NODE_END = 57,
+    COL_INCL = 59,    COL_INCL_END = 68,
+    COL_E = 70,       COL_E_END = 79,
+    COL_N = 80,       COL_N_END = 91,
+    COL_A = 92,       COL_A_END = 103,
+    COL_NAME = 166,   COL_NAME_END = 194,
+    MIN_RECORD = COL_A_END  //Shorter lines (blank separators, header text) are not records
+};
+
+static const double JD_J2000 = 2451545.0;
+static const double KM_PER_AU = 149597870.7;
+static const double ASSUMED_ALBEDO = 0.14;
+
+//Length of the line starting at p, without the newline or a trailing '\r'
+static inline size_t lineLength(const char* p, const char* end, const char** next) {
+    const char* nl = (const char*) memchr(p, '\n', end - p);
+    if(nl == NULL) nl = end;
+    *next = (nl < end) ? nl + 1 : end;
+    if(nl > p && nl[-1] == '\r') nl--;
+    return nl - p;
+}
+
+//Fixed-width decimal field ("  -12.3456"); no exponents in MPC records. Returns false on an empty or malformed field
+static inline bool fixedNumber(const char* p, const char* end, double& out) {
+    while(p < end && *p == ' ') p++;
+    bool neg = false;
+    if(p < end && (*p == '-' || *p == '+')) { neg = (*p == '-');  p++; }
+    double v = 0.0;
+    int digits = 0;
+    while(p < end && *p >= '0' && *p <= '9') { v = v*10 + (*p++ - '0');  digits++; }
+    if(p < end && *p == '.') {
+        p++;
+        double scale = 0.1;
+        while(p < end && *p >= '0' && *p <= '9') { v += (*p++ - '0') * scale;  scale *= 0.1;  digits++; }
+    }
+    while(p < end && *p == ' ') p++;
+    if(digits == 0 || p != end) return false;
+    out = neg ? -v : v;
+    return true;
+}
+
+//Packed digit used in MPC dates: 1-9 then A-V for 10-31
+static inline int packedDigit(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'A' && c <= 'V') return c - 'A' + 10;
+    return -1;
+}
+
+//Packed epoch ("K24AH" = 2024-10-17, 0h TT) to a Julian date
+static inline bool packedEpoch(const char* p, double& jd) {
+    int century = packedDigit(p[0]);
+    if(century < 10 || p[1] < '0' || p[1] > '9' || p[2] < '0' || p[2] > '9') return false;
+    int year = century * 100 + (p[1] - '0') * 10 + (p[2] - '0');
+    int month = packedDigit(p[3]), day = packedDigit(p[4]);
+    if(month < 1 || month > 12 || day < 1 || day > 31) return false;
+    if(month <= 2) { year--;  month += 12; }
+    int a = year / 100, b = 2 - a + a / 4;  //Gregorian calendar (Meeus, ch. 7)
+    jd = floor(365.25 * (year + 4716)) + floor(30.6001 * (month + 1)) + day + b - 1524.5;
+    return true;
+}
+
+static inline const char* trimmed(const char* p, const char* end, size_t& len) {
+    while(p < end && *p == ' ') p++;
+    while(end > p && end[-1] == ' ') end--;
+    len = end - p;
+    return p;
+}
+
+//Parse one record into body i of the store
+static bool parseRecord(const char* line, size_t len, BodyStore& store, size_t i) {
+    double h, M, peri, node, incl, e, n, a, epoch;
+    if(!fixedNumber(line + COL_M, line + COL_M_END, M) || !fixedNumber(line + COL_PERI, line + COL_PERI_END, peri) ||
+       !fixedNumber(line + COL_NODE, line + COL_NODE_END, node) || !fixedNumber(line + COL_INCL, line + COL_INCL_END, incl) ||
+       !fixedNumber(line + COL_E, line + COL_E_END, e) || !fixedNumber(line + COL_N, line + COL_N_END, n) ||
+       !fixedNumber(line + COL_A, line + COL_A_END, a) || !packedEpoch(line + COL_EPOCH, epoch) || n <= 0.0)
+        return false;
+    if(!fixedNumber(line + COL_H, line + COL_H_END, h)) h = 18.0;  //H is blank for some poorly observed objects
+
+    OrbitalElements& el = store.elements[i];
+    el.major = a;  el.eccentricity = e;  el.inclination = incl;
+    el.ascNode = node;  el.periLong = node + peri;
+    el.period = 360.0 / n / DAYS_PER_YEAR;
+    el.meanLong = fmod(node + peri + M - n * (epoch - JD_J2000), 360.0);  //Mean longitude wound back to J2000
+
+    double diameter = 1329.0 / sqrt(ASSUMED_ALBEDO) * pow(10.0, -0.2 * h);  //km
+    store.radius[i] = 0.5 * diameter / KM_PER_AU;
+    store.renderRadius[i] = store.radius[i];
+    store.parents[i] = 0;
+    store.colors[i] = color4(0.6, 0.6, 0.6, 1.0);
+
+    size_t nameLen;
+    const char* name = (len > COL_NAME) ? trimmed(line + COL_NAME, line + min(len, (size_t) COL_NAME_END), nameLen) : line;
+    if(len <= COL_NAME || nameLen == 0) name = trimmed(line + COL_DESIG, line + COL_DESIG_END, nameLen);
+    store.names[i].assign(name, nameLen);
+    return true;
+}
+
+struct MpcChunk {
+    const char *begin, *end;
+    size_t first, count;  //Slice of the store this chunk writes
+    size_t bad;
+};
+
+bool loadMpcOrbits(const string& path, BodyStore& store, ThreadPool& pool, MpcLoadStats* stats) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    MappedFile file;
+    if(!file.open(path)) {
+        cerr << "Failed to map orbit file " << path << endl;
+        return false;
+    }
+    if(store.size() == 0) {
+        cerr << "Orbit file " << path << ": the store needs the Sun before minor planets can be added" << endl;
+        return false;
+    }
+    const char* data = file.data ? file.data : "";
+    const char* end = data + file.size;
+
+    //MPCORB.DAT starts with a text header closed by a row of dashes; the extracts have no header
+    const char* body = data;
+    const char* dashes = NULL;
+    size_t headerScan = min(file.size, (size_t) 65536);
+    for(const char* p = data; p + 5 <= data + headerScan; ) {
+        if(memcmp(p, "-----", 5) == 0) { dashes = p;  break; }
+        const char* nl = (const char*) memchr(p, '\n', data + headerScan - p);
+        if(nl == NULL) break;
+        p = nl + 1;
+    }
+    if(dashes != NULL) lineLength(dashes, end, &body);
+
+    //Chunks start and end on line boundaries
+    size_t numChunks = pool.size() * 4;
+    size_t bodySize = end - body;
+    if(numChunks > bodySize / 4096 + 1) numChunks = bodySize / 4096 + 1;
+    vector<MpcChunk> chunks(numChunks);
+    const char* prev = body;
+    for(size_t c = 0; c < numChunks; c++) {
+        const char* e = (c + 1 == numChunks) ? end : body + bodySize * (c + 1) / numChunks;
+        if(e < prev) e = prev;
+        if(e < end) {
+            const char* nl = (const char*) memchr(e, '\n', end - e);
+            e = nl ? nl + 1 : end;
+        }
+        chunks[c].begin = prev;  chunks[c].end = e;
+        chunks[c].count = 0;  chunks[c].bad = 0;
+        prev = e;
+    }
+
+    //Pass 1: count records per chunk
+    pool.parallelFor(numChunks, [&chunks](size_t c0, size_t c1) {
+        for(size_t c = c0; c < c1; c++) {
+            size_t count = 0;
+            for(const char* p = chunks[c].begin; p < chunks[c].end; ) {
+                if(lineLength(p, chunks[c].end, &p) >= MIN_RECORD) count++;
+            }
+            chunks[c].count = count;
+        }
+    }, numChunks);
+
+    size_t total = 0;
+    for(size_t c = 0; c < numChunks; c++) { chunks[c].first = total;  total += chunks[c].count; }
+    size_t first = store.grow(total, BODY_POINT);
+
+    //Pass 2: parse every chunk straight into its slice of the store
+    vector<unsigned char> ok(total, 1);
+    pool.parallelFor(numChunks, [&chunks, &store, &ok, first](size_t c0, size_t c1) {
+        for(size_t c = c0; c < c1; c++) {
+            size_t row = chunks[c].first;
+            for(const char* p = chunks[c].begin; p < chunks[c].end; ) {
+                const char* line = p;
+                size_t len = lineLength(p, chunks[c].end, &p);
+                if(len < MIN_RECORD) continue;
+                if(!parseRecord(line, len, store, first + row)) { ok[row] = 0;  chunks[c].bad++; }
+                row++;
+            }
+        }
+    }, numChunks);
+
+    size_t bad = 0;
+    for(size_t c = 0; c < numChunks; c++) bad += chunks[c].bad;
+    if(bad > 0) {  //Rare: compact the failed rows out of the new slice
+        size_t out = first;
+        for(size_t r = 0; r < total; r++) {
+            if(!ok[r]) continue;
+            size_t in = first + r;
+            if(out != in) {
+                store.names[out].swap(store.names[in]);
+                store.elements[out] = store.elements[in];
+                store.radius[out] = store.radius[in];  store.renderRadius[out] = store.renderRadius[in];
+                store.parents[out] = store.parents[in];  store.colors[out] = store.colors[in];
+            }
+            out++;
+        }
+        store.truncate(out);
+    }
+
+    if(stats != NULL) {
+        stats->rows = total - bad;
+        stats->skipped = bad;
+        stats->bytes = file.size;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
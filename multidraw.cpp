@@ -0,0 +1,50 @@
+#include "multidraw.h"
+#include "glcaps.h"
+
+bool MultiDrawBatch::supported() {
+    return hasGLVersion(4, 3) && hasGLExtension("GL_ARB_shader_draw_parameters");
+}
+
+void MultiDrawBatch::init(ProgramCache& programs) {
+    build = programs.request("vshader_mdi.glsl", "fshader.glsl");
+}
+
+bool MultiDrawBatch::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    uniforms.reflect(program);  //First use: the shared blocks use the shared bindings
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    uniforms.bindBlock("Shadow", SHADOW_BINDING);
+    glUseProgram(program);
+    glUniform1i(uniforms.location("ShadowMap"), SHADOW_TEXTURE_UNIT);
+    glUniform1i(uniforms.location("SurfaceMap"), SURFACE_TEXTURE_UNIT);
+    return true;
+}
+
+void MultiDrawBatch::add(const Mesh& mesh, const ObjectUniforms& obj) {
+    DrawElementsIndirectCommand cmd;
+    cmd.count = mesh.count;
+    cmd.instanceCount = 1;
+    cmd.firstIndex = mesh.firstIndex;
+    cmd.baseVertex = mesh.baseVertex;
+    cmd.baseInstance = 0;
+    commands.push_back(cmd);
+    objects.push_back(obj);
+    vao = mesh.vao;
+}
+
+void MultiDrawBatch::draw(DynamicBuffer& stream) {
+    if(commands.empty()) return;
+    DynamicSlice records = stream.upload(&objects[0], sizeof(ObjectUniforms) * objects.size(), stream.getStorageAlignment());
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, OBJECT_STORAGE_BINDING, records.buffer, records.offset, records.size);
+    DynamicSlice indirect = stream.upload(&commands[0], sizeof(DrawElementsIndirectCommand) * commands.size(), 4);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.buffer);
+
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, BUFFER_OFFSET(indirect.offset), (GLsizei) commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,51 @@
+#ifndef __MULTIDRAW_H__
+#define __MULTIDRAW_H__
+
+#include "dynamicbuffer.h"
+#include "mesh.h"
+#include "programcache.h"
+#include "uniforms.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ Multi-draw-indirect batch: every body drawn with one API call
+    - Each add() appends a DrawElementsIndirectCommand for a MeshPool mesh and its ObjectUniforms record
+    - draw() copies the commands and records into this frame's slices of the dynamic buffer (dynamicbuffer.h), then
+      issues a single glMultiDrawElementsIndirect; the vertex shader
+      (vshader_mdi.glsl) fetches its record from a shader storage buffer with gl_DrawIDARB
+    - Needs OpenGL 4.3 and ARB_shader_draw_parameters (not on macOS); check supported() and keep the per-draw path otherwise
+    - The program builds in the background (programcache.h); keep using the per-draw path until ready() says otherwise
+ ***/
+
+struct DrawElementsIndirectCommand {
+    GLuint count, instanceCount, firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class MultiDrawBatch {
+public:
+    MultiDrawBatch() : program(0), build(-1), vao(0) {}
+
+    static bool supported();
+    void init(ProgramCache& programs);  //Starts the program build
+    bool ready(ProgramCache& programs);  //False while the program is building, or if it failed to build
+
+    void clear() { commands.clear();  objects.clear(); }
+    void add(const Mesh& mesh, const ObjectUniforms& obj);
+    void draw(DynamicBuffer& stream);  //All meshes must come from the same MeshPool
+
+    size_t size() const { return commands.size(); }
+
+private:
+    GLuint program;
+    int build;  //ProgramCache handle
+    UniformCache uniforms;
+    GLuint vao;
+    vector<DrawElementsIndirectCommand> commands;
+    vector<ObjectUniforms> objects;  //std430 array stride equals sizeof(ObjectUniforms)
+};
+
+#endif // __MULTIDRAW_H__
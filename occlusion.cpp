@@ -0,0 +1,124 @@
+#include "occlusion.h"
+#include "glcaps.h"
+#include "uniforms.h"
+#include <cmath>
+
+void OcclusionCuller::init(ProgramCache& programs, const BodyStore& bodies) {
+    //Conservative queries may count a sample that wouldn't quite pass, but never miss one, and cost the GPU less
+    target = hasGLVersion(4, 3) || hasGLExtension("GL_ARB_ES3_compatibility") ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+                                                                             : GL_ANY_SAMPLES_PASSED;
+    slotOfBody.assign(bodies.size(), -1);
+    for(size_t i = 0; i < bodies.size(); i++) {
+        if(bodies.flags[i] & BODY_POINT) continue;
+        Slot s;
+        glGenQueries(2, s.query);
+        s.issued[0] = s.issued[1] = -1;
+        s.pending = false;
+        slotOfBody[i] = (int) slots.size();
+        slots.push_back(s);
+    }
+    glGenVertexArrays(1, &vao);  //No attributes: the box comes from gl_VertexID
+    build = programs.request("vshader_proxy.glsl", "fshader_proxy.glsl");
+}
+
+bool OcclusionCuller::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    UniformCache uniforms;
+    uniforms.reflect(program);
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    sphereLoc = uniforms.location("Sphere");
+    return true;
+}
+
+void OcclusionCuller::setEnabled(bool on) {
+    enabled = on;
+    for(size_t k = 0; k < slots.size(); k++) slots[k].pending = false;
+}
+
+void OcclusionCuller::classify(vector<int>& visible, vector<int>& hidden) {
+    frame++;
+    occluded = conditional = 0;
+    hidden.clear();
+    if(!enabled || target == 0) return;
+    int last = (frame - 1) & 1;
+    size_t kept = 0;
+    for(size_t k = 0; k < visible.size(); k++) {
+        int body = visible[k];
+        int slot = body < (int) slotOfBody.size() ? slotOfBody[body] : -1;
+        bool isHidden = false;
+        if(slot >= 0) {
+            Slot& s = slots[slot];
+            s.pending = false;
+            if(s.issued[last] == frame - 1) {
+                GLuint available = 0;
+                glGetQueryObjectuiv(s.query[last], GL_QUERY_RESULT_AVAILABLE, &available);
+                if(available) {
+                    GLuint passed = 0;
+                    glGetQueryObjectuiv(s.query[last], GL_QUERY_RESULT, &passed);
+                    isHidden = passed == 0;
+                } else {
+                    s.pending = true;
+                }
+            }
+        }
+        if(isHidden) hidden.push_back(body);
+        else visible[kept++] = body;
+    }
+    visible.resize(kept);
+    occluded = (long) hidden.size();
+}
+
+void OcclusionCuller::beginDraw(int body) {
+    int slot = body < (int) slotOfBody.size() ? slotOfBody[body] : -1;
+    if(slot < 0 || !slots[slot].pending) return;
+    glBeginConditionalRender(slots[slot].query[(frame - 1) & 1], GL_QUERY_NO_WAIT);
+    conditional++;
+}
+
+void OcclusionCuller::endDraw(int body) {
+    int slot = body < (int) slotOfBody.size() ? slotOfBody[body] : -1;
+    if(slot >= 0 && slots[slot].pending) glEndConditionalRender();
+}
+
+void OcclusionCuller::test(int body, const vec3& center, GLfloat radius, GLfloat near, GLfloat pixelsPerRadian, bool lines) {
+    int slot = body < (int) slotOfBody.size() ? slotOfBody[body] : -1;
+    GLfloat dist = length(center);
+    if(slot < 0 || dist - radius * (GLfloat) sqrt(3.0) <= near) return;  //The box may reach the near plane
+    if(radius * pixelsPerRadian < MIN_TEST_PIXELS * dist) return;  //Too small to test reliably, and cheap anyway
+    Slot& s = slots[slot];
+    int current = frame & 1;
+    glUniform4f(sphereLoc, center.x, center.y, center.z, radius);
+    glBeginQuery(target, s.query[current]);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+    if(lines) {  //Wide lines reach past the filled box, as they do past the filled sphere
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+    glEndQuery(target);
+    s.issued[current] = frame;
+}
+
+void OcclusionCuller::testProxies(ProgramCache& programs, const BodyStore& bodies, const vector<int>& visible,
+                                  const vector<int>& hidden, GLfloat near, GLfloat pixelsPerRadian) {
+    if(!enabled || target == 0 || !ready(programs)) return;
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);  //A wireframe box alone would miss most of its samples
+    bool lines = polygonMode[0] == GL_LINE;
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    for(size_t k = 0; k < visible.size(); k++)
+        test(visible[k], bodies.relPos[visible[k]], (GLfloat) bodies.renderRadius[visible[k]], near, pixelsPerRadian, lines);
+    for(size_t k = 0; k < hidden.size(); k++)
+        test(hidden[k], bodies.relPos[hidden[k]], (GLfloat) bodies.renderRadius[hidden[k]], near, pixelsPerRadian, lines);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
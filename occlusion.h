@@ -0,0 +1,71 @@
+#ifndef __OCCLUSION_H__
+#define __OCCLUSION_H__
+
+#include "bodystore.h"
+#include "programcache.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ Hardware occlusion culling of sphere bodies hidden behind others (moons behind their planet, planets behind the Sun)
+    - After the opaque bodies are drawn, testProxies() draws the box around every frustum-visible body's bounding sphere
+      with color and depth writes off, each inside an occlusion query (GL_ANY_SAMPLES_PASSED_CONSERVATIVE where there
+      is one, else GL_ANY_SAMPLES_PASSED)
+    - The next frame's classify() reads those results without waiting: a body whose box had no samples pass is moved out
+      of the visible list and costs nothing further, not even a vertex. Queries alternate between two sets, so a frame
+      never reads one it has just issued
+    - A body whose result hasn't arrived yet is drawn, inside beginDraw()/endDraw(), under conditional rendering
+      (GL_QUERY_NO_WAIT): the GPU drops the draw if the query has by then said hidden. Bodies in the multi-draw batch
+      can't be drawn conditionally one by one and are drawn plainly
+    - The box covers every sample the sphere can: in wireframe mode it is drawn a second time as lines, inside the
+      same query, since wide lines reach past the filled shape
+    - Results are one frame late, so a body coming out from behind another appears a frame after it would have; a body
+      whose box reaches the near plane (the camera close by) is never tested, since a clipped box could miss samples
+    - Nor is a body under MIN_TEST_PIXELS in radius on screen: whether a speck covers a sample changes from frame to
+      frame, so a late result would drop it while it shows, and it costs little to draw
+    - Hidden bodies' boxes are still tested every frame, against the depth of what was drawn, so they come back as soon
+      as they show
+ ***/
+class OcclusionCuller {
+public:
+    static const int MIN_TEST_PIXELS = 3;  //Radius on screen
+
+    OcclusionCuller() : target(0), build(-1), program(0), vao(0), sphereLoc(-1), enabled(true), frame(0), occluded(0),
+                        conditional(0) {}
+
+    void init(ProgramCache& programs, const BodyStore& bodies);  //Call with a current context
+    void setEnabled(bool on);  //Off, classify() hides nothing and nothing is tested or drawn conditionally
+    //Moves the bodies last frame's queries proved hidden from visible to hidden
+    void classify(vector<int>& visible, vector<int>& hidden);
+    void beginDraw(int body);  //Conditional rendering if the body's result was still on its way
+    void endDraw(int body);
+    //Issues this frame's queries for every frustum-visible body (drawn or hidden) against the depth buffer as it is
+    void testProxies(ProgramCache& programs, const BodyStore& bodies, const vector<int>& visible,
+                     const vector<int>& hidden, GLfloat near, GLfloat pixelsPerRadian);
+
+    long getOccluded() const { return occluded; }        //Last frame's bodies skipped as hidden
+    long getConditional() const { return conditional; }  //Last frame's bodies drawn under conditional rendering
+
+private:
+    struct Slot {
+        GLuint query[2];
+        long issued[2];  //Frame each query was last issued in, -1 for never
+        bool pending;    //Last frame's result hadn't arrived when classify() looked
+    };
+
+    bool ready(ProgramCache& programs);
+    void test(int body, const vec3& center, GLfloat radius, GLfloat near, GLfloat pixelsPerRadian, bool lines);
+
+    GLenum target;  //Query target, 0 until init()
+    int build;      //ProgramCache handle
+    GLuint program, vao;
+    GLint sphereLoc;
+    bool enabled;
+    vector<int> slotOfBody;  //-1 for point bodies
+    vector<Slot> slots;
+    long frame;
+    long occluded, conditional;
+};
+
+#endif // __OCCLUSION_H__
@@ -0,0 +1,252 @@
+#include "picking.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PICKING_SSE 1
+#endif
+
+const float REBUILD_OVERLAP = 4;  //Rebuild once the leaves overlap this many times more than right after a build
+
+//Box surface area, up to a constant factor
+static inline float boxArea(const GLfloat* lo, const GLfloat* hi) {
+    float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+void BodyPicker::refit(const BodyStore& bodies, GLfloat pixelsPerRadian, ThreadPool* pool) {
+    bool rebuild = ids.size() != bodies.size();
+    if(rebuild) {
+        ids.resize(bodies.size());
+        for(size_t i = 0; i < ids.size(); i++) ids[i] = (int) i;
+        x.resize(ids.size());  y.resize(ids.size());  z.resize(ids.size());  r.resize(ids.size());
+    }
+    if(ids.empty()) { nodes.clear();  return; }
+
+    //Spheres in leaf order, each at least PICK_PIXELS across
+    GLfloat minRadius = PICK_PIXELS * 0.5f / pixelsPerRadian;  //Per unit of distance
+    auto copySpheres = [this, &bodies, minRadius](size_t begin, size_t end) {
+        for(size_t k = begin; k < end; k++) {
+            const vec3& p = bodies.relPos[ids[k]];
+            x[k] = p.x;  y[k] = p.y;  z[k] = p.z;
+            r[k] = max((GLfloat) bodies.renderRadius[ids[k]], minRadius * length(p));
+        }
+    };
+    if(pool != NULL) pool->parallelFor(ids.size(), copySpheres);
+    else copySpheres(0, ids.size());
+    if(rebuild) build();
+    refitBoxes(pool);
+
+    if(rebuild) builtOverlap = overlap();
+    else if(overlap() > builtOverlap * REBUILD_OVERLAP) {
+        build();  //From the spheres just written, in their current order
+        refitBoxes(pool);
+        builtOverlap = overlap();
+    }
+}
+
+void BodyPicker::refitBoxes(ThreadPool* pool) {
+    //Leaves are independent of each other, so they can be split across the pool
+    auto fitLeaves = [this](size_t begin, size_t end) {
+        for(size_t n = begin; n < end; n++) {
+            Node& node = nodes[n];
+            if(node.count == 0) continue;
+            for(int a = 0; a < 3; a++) { node.lo[a] = FLT_MAX;  node.hi[a] = -FLT_MAX; }
+            for(int k = node.first; k < node.first + node.count; k++) {
+                node.lo[0] = min(node.lo[0], x[k] - r[k]);  node.hi[0] = max(node.hi[0], x[k] + r[k]);
+                node.lo[1] = min(node.lo[1], y[k] - r[k]);  node.hi[1] = max(node.hi[1], y[k] + r[k]);
+                node.lo[2] = min(node.lo[2], z[k] - r[k]);  node.hi[2] = max(node.hi[2], z[k] + r[k]);
+            }
+        }
+    };
+    if(pool != NULL) pool->parallelFor(nodes.size(), fitLeaves);
+    else fitLeaves(0, nodes.size());
+
+    //Children always come after their parent, so one backward pass over the inner nodes sees them first
+    for(size_t n = nodes.size(); n-- > 0; ) {
+        Node& node = nodes[n];
+        if(node.count > 0) continue;
+        const Node& left = nodes[n + 1];
+        const Node& right = nodes[node.first];
+        for(int a = 0; a < 3; a++) {
+            node.lo[a] = min(left.lo[a], right.lo[a]);
+            node.hi[a] = max(left.hi[a], right.hi[a]);
+        }
+    }
+}
+
+void BodyPicker::build() {
+    scratch.resize(ids.size());
+    for(size_t k = 0; k < scratch.size(); k++) scratch[k] = (int) k;
+    nodes.clear();
+    nodes.reserve(2 * (ids.size() / LEAF_SIZE + 1));
+    buildNode(0, scratch.size());
+
+    //Put the spheres in leaf order
+    vector<int> oldIds(ids);
+    vector<GLfloat> ox(x), oy(y), oz(z), orad(r);
+    for(size_t k = 0; k < scratch.size(); k++) {
+        int s = scratch[k];
+        ids[k] = oldIds[s];  x[k] = ox[s];  y[k] = oy[s];  z[k] = oz[s];  r[k] = orad[s];
+    }
+    scratch.clear();
+    rebuilds++;
+}
+
+//Splits scratch[begin, end) at the median of the centers along their widest axis; returns the node's index
+int BodyPicker::buildNode(size_t begin, size_t end) {
+    int index = (int) nodes.size();
+    nodes.push_back(Node());
+    if(end - begin <= (size_t) LEAF_SIZE) {
+        nodes[index].first = (GLint) begin;
+        nodes[index].count = (GLshort) (end - begin);
+        nodes[index].axis = 0;
+        return index;
+    }
+    const GLfloat* centers[3] = { &x[0], &y[0], &z[0] };
+    GLfloat lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for(size_t k = begin; k < end; k++) {
+        for(int a = 0; a < 3; a++) {
+            lo[a] = min(lo[a], centers[a][scratch[k]]);
+            hi[a] = max(hi[a], centers[a][scratch[k]]);
+        }
+    }
+    int axis = 0;
+    for(int a = 1; a < 3; a++) { if(hi[a] - lo[a] > hi[axis] - lo[axis]) axis = a; }
+    const GLfloat* c = centers[axis];
+    size_t mid = begin + (end - begin) / 2;
+    nth_element(scratch.begin() + begin, scratch.begin() + mid, scratch.begin() + end,
+                [c](int a, int b) { return c[a] < c[b]; });
+
+    buildNode(begin, mid);  //Lands at index + 1
+    int right = buildNode(mid, end);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    nodes[index].axis = (GLshort) axis;
+    return index;
+}
+
+//Total leaf area relative to the root's: grows as moving bodies spread the leaves' boxes across each other
+float BodyPicker::overlap() const {
+    float leaves = 0;
+    for(size_t n = 0; n < nodes.size(); n++) {
+        if(nodes[n].count > 0) leaves += boxArea(nodes[n].lo, nodes[n].hi);
+    }
+    float root = boxArea(nodes[0].lo, nodes[0].hi);
+    return root > 0 ? leaves / root : 0;
+}
+
+//Inverse of a 4x4 matrix in double precision (cofactors); false if it is singular
+static bool invert(const mat4& m, double out[4][4]) {
+    double a[16];
+    for(int i = 0; i < 4; i++) { for(int j = 0; j < 4; j++) a[i * 4 + j] = m[i][j]; }
+    double inv[16];
+    inv[0] = a[5]*a[10]*a[15] - a[5]*a[11]*a[14] - a[9]*a[6]*a[15] + a[9]*a[7]*a[14] + a[13]*a[6]*a[11] - a[13]*a[7]*a[10];
+    inv[4] = -a[4]*a[10]*a[15] + a[4]*a[11]*a[14] + a[8]*a[6]*a[15] - a[8]*a[7]*a[14] - a[12]*a[6]*a[11] + a[12]*a[7]*a[10];
+    inv[8] = a[4]*a[9]*a[15] - a[4]*a[11]*a[13] - a[8]*a[5]*a[15] + a[8]*a[7]*a[13] + a[12]*a[5]*a[11] - a[12]*a[7]*a[9];
+    inv[12] = -a[4]*a[9]*a[14] + a[4]*a[10]*a[13] + a[8]*a[5]*a[14] - a[8]*a[6]*a[13] - a[12]*a[5]*a[10] + a[12]*a[6]*a[9];
+    inv[1] = -a[1]*a[10]*a[15] + a[1]*a[11]*a[14] + a[9]*a[2]*a[15] - a[9]*a[3]*a[14] - a[13]*a[2]*a[11] + a[13]*a[3]*a[10];
+    inv[5] = a[0]*a[10]*a[15] - a[0]*a[11]*a[14] - a[8]*a[2]*a[15] + a[8]*a[3]*a[14] + a[12]*a[2]*a[11] - a[12]*a[3]*a[10];
+    inv[9] = -a[0]*a[9]*a[15] + a[0]*a[11]*a[13] + a[8]*a[1]*a[15] - a[8]*a[3]*a[13] - a[12]*a[1]*a[11] + a[12]*a[3]*a[9];
+    inv[13] = a[0]*a[9]*a[14] - a[0]*a[10]*a[13] - a[8]*a[1]*a[14] + a[8]*a[2]*a[13] + a[12]*a[1]*a[10] - a[12]*a[2]*a[9];
+    inv[2] = a[1]*a[6]*a[15] - a[1]*a[7]*a[14] - a[5]*a[2]*a[15] + a[5]*a[3]*a[14] + a[13]*a[2]*a[7] - a[13]*a[3]*a[6];
+    inv[6] = -a[0]*a[6]*a[15] + a[0]*a[7]*a[14] + a[4]*a[2]*a[15] - a[4]*a[3]*a[14] - a[12]*a[2]*a[7] + a[12]*a[3]*a[6];
+    inv[10] = a[0]*a[5]*a[15] - a[0]*a[7]*a[13] - a[4]*a[1]*a[15] + a[4]*a[3]*a[13] + a[12]*a[1]*a[7] - a[12]*a[3]*a[5];
+    inv[14] = -a[0]*a[5]*a[14] + a[0]*a[6]*a[13] + a[4]*a[1]*a[14] - a[4]*a[2]*a[13] - a[12]*a[1]*a[6] + a[12]*a[2]*a[5];
+    inv[3] = -a[1]*a[6]*a[11] + a[1]*a[7]*a[10] + a[5]*a[2]*a[11] - a[5]*a[3]*a[10] - a[9]*a[2]*a[7] + a[9]*a[3]*a[6];
+    inv[7] = a[0]*a[6]*a[11] - a[0]*a[7]*a[10] - a[4]*a[2]*a[11] + a[4]*a[3]*a[10] + a[8]*a[2]*a[7] - a[8]*a[3]*a[6];
+    inv[11] = -a[0]*a[5]*a[11] + a[0]*a[7]*a[9] + a[4]*a[1]*a[11] - a[4]*a[3]*a[9] - a[8]*a[1]*a[7] + a[8]*a[3]*a[5];
+    inv[15] = a[0]*a[5]*a[10] - a[0]*a[6]*a[9] - a[4]*a[1]*a[10] + a[4]*a[2]*a[9] + a[8]*a[1]*a[6] - a[8]*a[2]*a[5];
+    double det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+    if(det == 0) return false;
+    for(int i = 0; i < 16; i++) out[i / 4][i % 4] = inv[i] / det;
+    return true;
+}
+
+//Point at normalized device coordinates (nx, ny, nz), back through the inverse matrix
+static dvec3 unproject(const double inv[4][4], double nx, double ny, double nz) {
+    double v[4];
+    for(int i = 0; i < 4; i++) v[i] = inv[i][0] * nx + inv[i][1] * ny + inv[i][2] * nz + inv[i][3];
+    return dvec3(v[0] / v[3], v[1] / v[3], v[2] / v[3]);
+}
+
+int BodyPicker::pick(const mat4& projectionView, int px, int py, int width, int height, double* distance) const {
+    if(nodes.empty() || width <= 0 || height <= 0) return -1;
+    double inv[4][4];
+    if(!invert(projectionView, inv)) return -1;
+    double nx = 2.0 * (px + 0.5) / width - 1.0, ny = 1.0 - 2.0 * (py + 0.5) / height;  //Window rows go down
+    dvec3 ray = unproject(inv, nx, ny, 1.0) - unproject(inv, nx, ny, -1.0);  //Near to far plane
+    double len = sqrt(ray.x * ray.x + ray.y * ray.y + ray.z * ray.z);
+    if(!(len > 0)) return -1;
+    //The ray starts at the camera: the origin of the camera-relative spheres
+    GLfloat d[3] = { (GLfloat) (ray.x / len), (GLfloat) (ray.y / len), (GLfloat) (ray.z / len) };
+    GLfloat invD[3];
+    for(int a = 0; a < 3; a++) invD[a] = 1.0f / (fabs(d[a]) > 1e-30f ? d[a] : (d[a] < 0 ? -1e-30f : 1e-30f));
+
+    GLfloat best = FLT_MAX;
+    int hit = -1;
+#ifdef PICKING_SSE
+    const __m128 dx = _mm_set1_ps(d[0]), dy = _mm_set1_ps(d[1]), dz = _mm_set1_ps(d[2]);
+    const __m128 zero = _mm_setzero_ps();
+#endif
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while(top > 0) {
+        const Node& node = nodes[stack[--top]];
+        //Slab test: the ray's span inside the box, clipped to [0, best)
+        GLfloat tNear = 0, tFar = best;
+        for(int a = 0; a < 3; a++) {
+            GLfloat t0 = node.lo[a] * invD[a], t1 = node.hi[a] * invD[a];
+            if(t0 > t1) swap(t0, t1);
+            tNear = max(tNear, t0);
+            tFar = min(tFar, t1);
+        }
+        if(tNear > tFar) continue;
+
+        if(node.count == 0) {  //Nearer child popped first
+            int left = (int) (&node - &nodes[0]) + 1, right = node.first;
+            if(d[node.axis] >= 0) { stack[top++] = right;  stack[top++] = left; }
+            else { stack[top++] = left;  stack[top++] = right; }
+            continue;
+        }
+
+        //Ray against sphere: the squared distance of the center from the ray is |d x c|^2, which stays accurate for
+        //spheres small beside their distance; the entry point is at b - sqrt(r^2 - that), with b = d . c
+        int k = node.first, end = node.first + node.count;
+#ifdef PICKING_SSE
+        for(; k + 4 <= end; k += 4) {
+            __m128 cx = _mm_loadu_ps(&x[k]), cy = _mm_loadu_ps(&y[k]), cz = _mm_loadu_ps(&z[k]), cr = _mm_loadu_ps(&r[k]);
+            __m128 ex = _mm_sub_ps(_mm_mul_ps(dy, cz), _mm_mul_ps(dz, cy));
+            __m128 ey = _mm_sub_ps(_mm_mul_ps(dz, cx), _mm_mul_ps(dx, cz));
+            __m128 ez = _mm_sub_ps(_mm_mul_ps(dx, cy), _mm_mul_ps(dy, cx));
+            __m128 perp2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+            __m128 disc = _mm_sub_ps(_mm_mul_ps(cr, cr), perp2);
+            __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, cx), _mm_mul_ps(dy, cy)), _mm_mul_ps(dz, cz));
+            __m128 t = _mm_max_ps(_mm_sub_ps(b, _mm_sqrt_ps(_mm_max_ps(disc, zero))), zero);
+            __m128 hits = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(disc, zero), _mm_cmpgt_ps(_mm_add_ps(b, cr), zero)),
+                                     _mm_cmplt_ps(t, _mm_set1_ps(best)));
+            int mask = _mm_movemask_ps(hits);
+            if(mask == 0) continue;
+            GLfloat ts[4];
+            _mm_storeu_ps(ts, t);
+            for(int bit = 0; mask != 0; bit++, mask >>= 1) {
+                if((mask & 1) && ts[bit] < best) { best = ts[bit];  hit = ids[k + bit]; }
+            }
+        }
+#endif
+        for(; k < end; k++) {
+            GLfloat ex = d[1] * z[k] - d[2] * y[k], ey = d[2] * x[k] - d[0] * z[k], ez = d[0] * y[k] - d[1] * x[k];
+            GLfloat disc = r[k] * r[k] - (ex * ex + ey * ey + ez * ez);
+            GLfloat b = d[0] * x[k] + d[1] * y[k] + d[2] * z[k];
+            if(disc < 0 || b + r[k] <= 0) continue;
+            GLfloat t = max(b - sqrt(disc), 0.0f);
+            if(t < best) { best = t;  hit = ids[k]; }
+        }
+    }
+    if(hit >= 0 && distance != NULL) *distance = best;
+    return hit;
+}
@@ -0,0 +1,64 @@
+#ifndef __PICKING_H__
+#define __PICKING_H__
+
+#include "Angel-yjc.h"
+#include "bodystore.h"
+#include <vector>
+
+using namespace std;
+
+class ThreadPool;
+
+/***
+ Picking a body under the mouse on the CPU, without reading back the framebuffer
+    - The mouse position is unprojected through the inverse of the frame's Perspective() * LookAt() matrix (in double
+      precision) into a ray from the camera, which sits at the origin of the camera-relative positions
+    - A bounding-volume hierarchy holds every body's bounding sphere: a binary tree of axis-aligned boxes, split at the
+      median along the widest axis, down to leaves of at most LEAF_SIZE bodies. Nodes are stored depth first (the left
+      child follows its parent), and the leaf spheres in structure-of-arrays order, so a leaf's spheres sit next to
+      each other in memory
+    - refit() runs every frame, right after the camera-relative positions are made: it copies them into the leaves and
+      recomputes every box bottom up, without reordering anything. The copy and the leaf boxes are split across the
+      thread pool, if given; the inner nodes take one serial pass. Each sphere is at least PICK_PIXELS across on
+      screen, so points and distant bodies can be clicked. When the bodies have drifted so far apart that the boxes
+      overlap a lot more than right after the last build, or the number of bodies changed, the tree is rebuilt instead
+    - A click then only costs pick(), against the tree of the last frame drawn
+    - pick() walks the tree nearest child first, skipping boxes behind the nearest hit so far, and tests each leaf's
+      spheres four at a time with SSE2 (plain loop elsewhere), like frustum.cpp
+ ***/
+class BodyPicker {
+public:
+    static const int LEAF_SIZE = 8;
+    static const int PICK_PIXELS = 6;  //Smallest pickable diameter on screen
+
+    BodyPicker() : builtOverlap(0), rebuilds(0) {}
+
+    void refit(const BodyStore& bodies, GLfloat pixelsPerRadian, ThreadPool* pool = NULL);
+    //x, y in window pixels from the top left; returns the nearest body hit, or -1. distance: along the ray (AU)
+    int pick(const mat4& projectionView, int x, int y, int width, int height, double* distance = NULL) const;
+
+    size_t size() const { return ids.size(); }
+    long getRebuilds() const { return rebuilds; }
+
+private:
+    struct Node {  //32 bytes
+        GLfloat lo[3], hi[3];
+        GLint first;   //Leaf: first sphere; inner node: index of the right child (the left one is the next node)
+        GLshort count; //Spheres in a leaf; 0 for an inner node
+        GLshort axis;  //Split axis of an inner node
+    };
+
+    void build();  //Orders the spheres into a new tree
+    int buildNode(size_t begin, size_t end);
+    void refitBoxes(ThreadPool* pool);
+    float overlap() const;
+
+    vector<Node> nodes;
+    vector<int> ids;  //Body of each sphere, in leaf order
+    vector<GLfloat> x, y, z, r;  //Camera-relative spheres, in leaf order
+    vector<int> scratch;  //Sphere order while building
+    float builtOverlap;  //overlap() right after the last build
+    long rebuilds;
+};
+
+#endif // __PICKING_H__
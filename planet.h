@@ -1,5 +1,9 @@
+#ifndef __PLANET_H__
+#define __PLANET_H__
+
 #include "Angel-yjc.h"
 #include "vec.h"
+#include "kepler.h"
 #include <string>
 #include <iostream>
 #include <vector>
@@ -79,11 +83,10 @@ public:
     
     void setEccentricity(const float e) { eccentricity = e; }
     
-    void setOrbitMap(const vector<point4> orbMap) {
-        for(int i = 0; i < orbMap.size(); i++) {
-            orbitMap.push_back(orbMap[i]);
-        }
-    }
+    void setInclination(const double i) { inclination = i; }
+    void setAscNode(const double n) { ascNode = n; }
+    void setPeriLong(const double p) { periLong = p; }
+    void setMeanLong(const double l) { meanLong = l; }
     
     void setOrbSpeed(const double s) { orbSpeed = s; }
     
@@ -126,7 +129,17 @@ public:
     
     float getEccentricity() { return eccentricity; }
     
-    vector<point4> getOrbitMap() { return orbitMap; }
+    double getInclination() { return inclination; }
+    double getAscNode() { return ascNode; }
+    double getPeriLong() { return periLong; }
+    double getMeanLong() { return meanLong; }
+    
+    OrbitalElements getElements() {
+        OrbitalElements el;
+        el.major = major;  el.eccentricity = eccentricity;  el.period = orbPeriod;
+        el.inclination = inclination;  el.ascNode = ascNode;  el.periLong = periLong;  el.meanLong = meanLong;
+        return el;
+    }
     
     float getOrbPeriod() { return orbPeriod; }
     
@@ -147,6 +160,7 @@ private:
     float radius, renderRadius;  //radius: will contain actual radial data of Planet; renderRadius: radius of rendered Planet object relative to other rendered Planet objects
     float major, minor;  //major: semi-major axis of orbit; minor: semi-minor axis of orbit
     float eccentricity;  //eccentricity of orbit
+    double inclination = 0, ascNode = 0, periLong = 0, meanLong = 0;  //Remaining J2000 orbital elements (deg), used by kepler.h
     float orbPeriod, orbPerimeter;
     bool moons;
     int numMoons;
@@ -159,7 +173,6 @@ private:
     vector<point4> vertices;
     vector<vec3> normals;
     point4 center = {0.0, 0.0, 0.0, 0.0};
-    vector<point4> orbitMap;
     double orbSpeed;
 };
 
@@ -195,6 +208,15 @@ public:
     void setEccentricity(const float e) { eccentricity = e; }
     
     void setOrbitSpeed(const float s) { orbitSpeed = s; }
+    
+    void setOrbPeriod(const float p) { orbPeriod = p; }
+    
+    void setInclination(const double i) { inclination = i; }
+    void setAscNode(const double n) { ascNode = n; }
+    void setPeriLong(const double p) { periLong = p; }
+    void setMeanLong(const double l) { meanLong = l; }
+    void setNodeRate(const double r) { nodeRate = r; }
+    void setPeriRate(const double r) { periRate = r; }
 
     string getName() { return name; }
 
@@ -224,11 +246,24 @@ public:
     
     float getOrbSpeed() { return orbitSpeed; }
     
+    float getOrbPeriod() { return orbPeriod; }
+    
+    OrbitalElements getElements() {
+        OrbitalElements el;
+        el.major = major;  el.eccentricity = eccentricity;  el.period = orbPeriod;
+        el.inclination = inclination;  el.ascNode = ascNode;  el.periLong = periLong;  el.meanLong = meanLong;
+        el.nodeRate = nodeRate;  el.periRate = periRate;
+        return el;
+    }
+    
 private:
     string name;
     float radius, renderRadius;  //radius: will contain actual radial data of Planet; renderRadius: radius of rendered Planet object relative to other rendered Planet objects
-    float major, minor;
-    float eccentricity;
+    float major = 0, minor = 0;
+    float eccentricity = 0;
+    float orbPeriod = 0;  //Sidereal period (years); 0 means no orbit data
+    double inclination = 0, ascNode = 0, periLong = 0, meanLong = 0;  //Orbital elements relative to the ecliptic (deg)
+    double nodeRate = 0, periRate = 0;  //Nodal regression and apsidal precession (deg/year)
     long numVertices;
     Planet* orbPlanet;
     GLuint buf;
@@ -241,7 +276,7 @@ private:
 };
 
 
-void Planet::getInfo() {
+inline void Planet::getInfo() {
     cout << "Planet: " << name << endl;
     cout << "\tRadius Compared to Earth: " << radius << endl;
     cout << "\tSemi-Major Axis of Orbit Compared to Earth: " << getMajorAxis() << endl;
@@ -323,3 +358,5 @@ private:
     color4 blackSpecLight = (0.2, 0.2, 0.2, 0.1);
     float rotSpeed;
 };
+
+#endif // __PLANET_H__
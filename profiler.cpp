@@ -0,0 +1,220 @@
+#include "profiler.h"
+#include "glcaps.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+//Overlay layout, in pixels
+const GLfloat OVERLAY_MARGIN = 8, OVERLAY_BAR = 5, OVERLAY_WIDTH = 240;
+const double OVERLAY_SCALE_MS = 100.0 / 3;  //Milliseconds across OVERLAY_WIDTH
+const double FRAME_BUDGET_MS = 100.0 / 6;   //60 Hz
+
+static const vec4 PHASE_COLORS[] = {
+    vec4(0.35, 0.75, 1.00, 1.0), vec4(0.45, 0.90, 0.45, 1.0), vec4(1.00, 0.80, 0.30, 1.0),
+    vec4(0.80, 0.50, 1.00, 1.0), vec4(1.00, 0.45, 0.45, 1.0), vec4(0.30, 0.90, 0.85, 1.0),
+    vec4(1.00, 0.60, 0.85, 1.0), vec4(0.75, 0.75, 0.40, 1.0)
+};
+
+void FrameProfiler::Window::push(float v) {
+    if(samples.size() < (size_t) WINDOW) samples.push_back(v);
+    else samples[next] = v;
+    next = (next + 1) % WINDOW;
+}
+
+double FrameProfiler::Window::percentile(double p) const {
+    if(samples.empty()) return 0.0;
+    vector<float> sorted(samples);
+    size_t rank = (size_t) max(ceil(p * sorted.size()) - 1.0, 0.0);  //Nearest rank
+    rank = min(rank, sorted.size() - 1);
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+FrameProfiler::FrameProfiler() : enabled(false), inFrame(false), wasProfiled(false), timerQueries(false), late(0),
+                                 slot(0), active(-1), build(-1), program(0), vao(0), viewportLoc(-1) {
+    for(int f = 0; f < NUM_FRAMES; f++)
+        for(int p = 0; p < MAX_PHASES; p++) { queries[f][p] = 0;  issued[f][p] = false; }
+}
+
+void FrameProfiler::init(ProgramCache& programs, const char* const* phaseNames, int numPhases) {
+    numPhases = min(numPhases, (int) MAX_PHASES);
+    names.assign(phaseNames, phaseNames + numPhases);
+    cpu.assign(numPhases, Window());
+    gpu.assign(numPhases, Window());
+    cpuThisFrame.assign(numPhases, 0.0);
+    lastReport = Clock::now();
+
+    timerQueries = hasGLVersion(3, 3) || hasGLExtension("GL_ARB_timer_query");
+    if(timerQueries) {
+        for(int f = 0; f < NUM_FRAMES; f++) glGenQueries(numPhases, queries[f]);
+    } else {
+        cerr << "Warning: no timer queries (ARB_timer_query); the profiler reports CPU time only" << endl;
+    }
+
+    glGenVertexArrays(1, &vao);  //Pointed at the frame's vertices by drawOverlay()
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    build = programs.request("vshader_overlay.glsl", "fshader_overlay.glsl");
+}
+
+void FrameProfiler::beginFrame() {
+    Clock::time_point now = Clock::now();
+    if(enabled && wasProfiled) cpuFrame.push((float) chrono::duration<double, milli>(now - frameStart).count());
+    wasProfiled = inFrame = enabled;
+    frameStart = now;
+    if(!enabled) return;
+
+    //This slot was last used NUM_FRAMES frames ago; take whatever of it the GPU has finished, and never wait for the rest.
+    //A query still in flight stays issued, so its phase goes untimed on the GPU this frame and is read next time round
+    slot = (slot + 1) % NUM_FRAMES;
+    double sinceIssued = chrono::duration<double, milli>(now - slotStart[slot]).count();
+    slotStart[slot] = now;
+    double frameGpu = 0;
+    bool complete = true;
+    for(int p = 0; p < (int) names.size(); p++) {
+        if(!issued[slot][p]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][p], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) { late++;  complete = false;  continue; }
+        issued[slot][p] = false;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot][p], GL_QUERY_RESULT, &nanoseconds);
+        double ms = nanoseconds * 1e-6;
+        if(ms > sinceIssued) { complete = false;  continue; }  //Longer than it has existed: a driver glitch (seen on llvmpipe)
+        gpu[p].push((float) ms);
+        frameGpu += ms;
+    }
+    if(complete && frameGpu > 0) gpuFrame.push((float) frameGpu);
+    fill(cpuThisFrame.begin(), cpuThisFrame.end(), 0.0);
+    entered.assign(names.size(), 0);
+}
+
+bool FrameProfiler::endFrame() {
+    if(!inFrame) return false;
+    inFrame = false;
+    for(size_t p = 0; p < names.size(); p++)
+        if(entered[p]) cpu[p].push((float) cpuThisFrame[p]);
+
+    Clock::time_point now = Clock::now();
+    if(chrono::duration<double>(now - lastReport).count() < REPORT_INTERVAL) return false;
+    lastReport = now;
+    return true;
+}
+
+void FrameProfiler::begin(int phase) {
+    if(!inFrame || phase < 0 || phase >= (int) names.size()) return;
+    //Elapsed-time queries can't overlap, so a nested or repeated phase is timed on the CPU only, as is one whose query
+    //from NUM_FRAMES frames ago hasn't delivered yet
+    if(timerQueries && active < 0 && !issued[slot][phase]) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][phase]);
+        issued[slot][phase] = true;
+        active = phase;
+    }
+    entered[phase] = 1;
+    phaseStart = Clock::now();
+}
+
+void FrameProfiler::end(int phase) {
+    if(!inFrame || phase < 0 || phase >= (int) names.size()) return;
+    cpuThisFrame[phase] += chrono::duration<double, milli>(Clock::now() - phaseStart).count();
+    if(active == phase) {
+        glEndQuery(GL_TIME_ELAPSED);
+        active = -1;
+    }
+}
+
+double FrameProfiler::percentile(int phase, bool onGpu, double p) const {
+    if(phase < 0) return (onGpu ? gpuFrame : cpuFrame).percentile(p);
+    if(phase >= (int) names.size()) return 0.0;
+    return (onGpu ? gpu[phase] : cpu[phase]).percentile(p);
+}
+
+string FrameProfiler::summary() const {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Frame p50/p99 ms: cpu %.2f/%.2f, gpu %.2f/%.2f |", percentile(-1, false, 0.5),
+             percentile(-1, false, 0.99), percentile(-1, true, 0.5), percentile(-1, true, 0.99));
+    string s = buf;
+    for(int p = 0; p < (int) names.size(); p++) {
+        snprintf(buf, sizeof(buf), " %s %.2f/%.2f", names[p].c_str(), percentile(p, false, 0.5), percentile(p, false, 0.99));
+        s += buf;
+        if(timerQueries) {
+            snprintf(buf, sizeof(buf), " (gpu %.2f/%.2f)", percentile(p, true, 0.5), percentile(p, true, 0.99));
+            s += buf;
+        }
+        s += p + 1 < (int) names.size() ? "," : "";
+    }
+    if(late > 0) {
+        snprintf(buf, sizeof(buf), " | %ld GPU timings late", late);
+        s += buf;
+    }
+    return s;
+}
+
+//Appends a quad as two triangles
+static void addQuad(vector<GLfloat>& v, GLfloat x0, GLfloat y0, GLfloat x1, GLfloat y1, const vec4& c) {
+    const GLfloat corners[6][2] = { {x0, y0}, {x1, y0}, {x1, y1}, {x0, y0}, {x1, y1}, {x0, y1} };
+    for(int i = 0; i < 6; i++) {
+        v.push_back(corners[i][0]);  v.push_back(corners[i][1]);
+        v.push_back(c.x);  v.push_back(c.y);  v.push_back(c.z);  v.push_back(c.w);
+    }
+}
+
+//A bar solid to p50 and faded on to p99
+static void addBar(vector<GLfloat>& v, GLfloat x, GLfloat y, double p50, double p99, vec4 c) {
+    GLfloat a = (GLfloat) min(p50 / OVERLAY_SCALE_MS, 1.0) * OVERLAY_WIDTH;
+    GLfloat b = (GLfloat) min(p99 / OVERLAY_SCALE_MS, 1.0) * OVERLAY_WIDTH;
+    if(a > 0) addQuad(v, x, y, x + a, y + OVERLAY_BAR, c);
+    c.w = 0.35;
+    if(b > a) addQuad(v, x + a, y, x + b, y + OVERLAY_BAR, c);
+}
+
+void FrameProfiler::drawOverlay(ProgramCache& programs, DynamicBuffer& stream, int width, int height) {
+    if(!enabled || vao == 0) return;
+    if(program == 0) {
+        if(programs.failed(build)) return;
+        program = programs.poll(build);
+        if(program == 0) return;
+        viewportLoc = glGetUniformLocation(program, "ViewportSize");
+    }
+
+    //Rows: the whole frame, then each phase; CPU bar above GPU bar
+    const GLfloat rowHeight = 2 * OVERLAY_BAR + 4;
+    GLfloat x = OVERLAY_MARGIN + 4, top = OVERLAY_MARGIN + 4;
+    GLfloat bottom = top + rowHeight * (names.size() + 1);
+    vertices.clear();
+    addQuad(vertices, OVERLAY_MARGIN, OVERLAY_MARGIN, x + OVERLAY_WIDTH + 4, bottom, vec4(0.0, 0.0, 0.0, 0.6));
+    for(int row = 0; row <= (int) names.size(); row++) {
+        int phase = row - 1;
+        vec4 c = phase < 0 ? vec4(1.0, 1.0, 1.0, 0.9) : PHASE_COLORS[phase % (sizeof(PHASE_COLORS) / sizeof(PHASE_COLORS[0]))];
+        c.w = 0.9;
+        GLfloat y = top + row * rowHeight;
+        addBar(vertices, x, y, percentile(phase, false, 0.5), percentile(phase, false, 0.99), c);
+        addBar(vertices, x, y + OVERLAY_BAR + 1, percentile(phase, true, 0.5), percentile(phase, true, 0.99), c * 0.7);
+    }
+    GLfloat budget = x + (GLfloat) (FRAME_BUDGET_MS / OVERLAY_SCALE_MS) * OVERLAY_WIDTH;
+    addQuad(vertices, budget, OVERLAY_MARGIN, budget + 1, bottom, vec4(1.0, 1.0, 1.0, 0.5));
+
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(program);
+    glUniform2f(viewportLoc, (GLfloat) width, (GLfloat) height);
+    DynamicSlice slice = stream.upload(&vertices[0], sizeof(GLfloat) * vertices.size(), 16);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slice.buffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), BUFFER_OFFSET(slice.offset));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), BUFFER_OFFSET(slice.offset + 2 * sizeof(GLfloat)));
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) (vertices.size() / 6));
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    if(depthTest) glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
@@ -0,0 +1,230 @@
+#include "programcache.h"
+#include "shadersource.h"
+#include "glcaps.h"
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <vector>
+
+static const char CACHE_MAGIC[4] = { 'S', 'S', 'P', 'B' };
+static const GLuint CACHE_VERSION = 1;
+
+struct CacheHeader {
+    char magic[4];
+    GLuint version;
+    unsigned long long key;  //Repeated from the file name, to catch hash-named files from elsewhere
+    GLenum format;
+    GLuint length;
+};
+
+static void hashBytes(unsigned long long& h, const void* data, size_t n) {  //FNV-1a
+    const unsigned char* p = (const unsigned char*) data;
+    for(size_t i = 0; i < n; i++) { h ^= p[i];  h *= 1099511628211ULL; }
+}
+
+static void hashString(unsigned long long& h, const char* s) {
+    if(s == NULL) s = "";
+    hashBytes(h, s, strlen(s) + 1);  //The terminator separates consecutive strings
+}
+
+static void printShaderLog(GLuint shader, const string& filename) {
+    GLint logSize = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
+    vector<char> log(logSize + 1);
+    glGetShaderInfoLog(shader, logSize, NULL, &log[0]);
+    cerr << filename << " failed to compile:" << endl << &log[0] << endl;
+}
+
+static double millisecondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static string buildName(const string& v, const string& g, const string& f) {
+    return g.empty() ? v + " + " + f : v + " + " + g + " + " + f;
+}
+
+void ProgramCache::initialize() {
+    initialized = true;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    useCache = enabled && formats > 0;
+#ifdef GL_KHR_parallel_shader_compile
+    parallel = hasGLExtension("GL_KHR_parallel_shader_compile");
+    if(parallel) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);  //As many threads as the driver likes
+#endif
+}
+
+int ProgramCache::request(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile) {
+    if(!initialized) initialize();
+    Build b;
+    b.start = chrono::steady_clock::now();
+    b.vName = vShaderFile;  b.fName = fShaderFile;
+    if(gShaderFile != NULL) b.gName = gShaderFile;
+    if(!shaderSource(b.vName, b.vSource) || !shaderSource(b.fName, b.fSource)) return -1;
+    if(!b.gName.empty() && !shaderSource(b.gName, b.gSource)) return -1;
+    b.program = b.vShader = b.fShader = b.gShader = 0;
+    b.fromBinary = b.done = b.failed = false;
+
+    b.key = 14695981039346656037ULL;
+    hashBytes(b.key, b.vSource.data(), b.vSource.size());
+    hashString(b.key, "");
+    hashBytes(b.key, b.fSource.data(), b.fSource.size());
+    hashString(b.key, "");
+    hashBytes(b.key, b.gSource.data(), b.gSource.size());
+    hashString(b.key, (const char*) glGetString(GL_VENDOR));
+    hashString(b.key, (const char*) glGetString(GL_RENDERER));
+    hashString(b.key, (const char*) glGetString(GL_VERSION));
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", b.key);
+    b.path = directory + name;
+
+    if(useCache) b.program = loadBinary(b.path, b.key);
+    b.fromBinary = b.program != 0;
+    if(!b.fromBinary) compile(b);
+    builds.push_back(b);
+    return (int) builds.size() - 1;
+}
+
+//Queues the compiles and the link without asking for any status, which would wait for the driver
+void ProgramCache::compile(Build& b) {
+    const GLchar* text = b.vSource.c_str();
+    b.vShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(b.vShader, 1, &text, NULL);
+    glCompileShader(b.vShader);
+    text = b.fSource.c_str();
+    b.fShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(b.fShader, 1, &text, NULL);
+    glCompileShader(b.fShader);
+    b.program = glCreateProgram();
+    if(!b.gName.empty()) {
+        text = b.gSource.c_str();
+        b.gShader = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(b.gShader, 1, &text, NULL);
+        glCompileShader(b.gShader);
+        glAttachShader(b.program, b.gShader);
+    }
+    glAttachShader(b.program, b.vShader);
+    glAttachShader(b.program, b.fShader);
+    if(useCache) glProgramParameteri(b.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(b.program);
+}
+
+GLuint ProgramCache::poll(int handle) {
+    if(handle < 0) return 0;
+    Build& b = builds[handle];
+    if(!b.done) {
+#ifdef GL_KHR_parallel_shader_compile
+        if(parallel) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(b.program, GL_COMPLETION_STATUS_KHR, &complete);
+            if(!complete) return 0;
+        }
+#endif
+        finish(b);
+    }
+    return b.program;
+}
+
+GLuint ProgramCache::wait(int handle) {
+    if(handle < 0) return 0;
+    Build& b = builds[handle];
+    if(!b.done) finish(b);
+    return b.program;
+}
+
+//Checks the outcome of a build (waiting for it if needed) and stores fresh binaries in the cache
+void ProgramCache::finish(Build& b) {
+    GLint linked = 0;
+    glGetProgramiv(b.program, GL_LINK_STATUS, &linked);
+    if(!linked && b.fromBinary) {  //The driver may refuse binaries from another build of itself; recompile and overwrite
+        cerr << "Program cache: driver rejected " << b.path << ", compiling from source" << endl;
+        glDeleteProgram(b.program);
+        b.fromBinary = false;
+        compile(b);
+        glGetProgramiv(b.program, GL_LINK_STATUS, &linked);
+    }
+    b.done = true;
+
+    if(b.fromBinary) {
+        hits++;
+        printf("Loaded %s from the program cache (%.1f ms)\n", buildName(b.vName, b.gName, b.fName).c_str(), millisecondsSince(b.start));
+    }
+    else if(!linked) {
+        GLint compiled = 0;
+        glGetShaderiv(b.vShader, GL_COMPILE_STATUS, &compiled);
+        if(!compiled) printShaderLog(b.vShader, b.vName);
+        glGetShaderiv(b.fShader, GL_COMPILE_STATUS, &compiled);
+        if(!compiled) printShaderLog(b.fShader, b.fName);
+        if(b.gShader != 0) {
+            glGetShaderiv(b.gShader, GL_COMPILE_STATUS, &compiled);
+            if(!compiled) printShaderLog(b.gShader, b.gName);
+        }
+        GLint logSize = 0;
+        glGetProgramiv(b.program, GL_INFO_LOG_LENGTH, &logSize);
+        vector<char> log(logSize + 1);
+        glGetProgramInfoLog(b.program, logSize, NULL, &log[0]);
+        cerr << buildName(b.vName, b.gName, b.fName) << " failed to link:" << endl << &log[0] << endl;
+        glDeleteProgram(b.program);
+        b.program = 0;
+        b.failed = true;
+    }
+    else {
+        misses++;
+        if(useCache) storeBinary(b.path, b.key, b.program);
+        printf("Compiled and linked %s (%.1f ms)\n", buildName(b.vName, b.gName, b.fName).c_str(), millisecondsSince(b.start));
+    }
+    if(b.vShader != 0) { glDeleteShader(b.vShader);  glDeleteShader(b.fShader);  b.vShader = b.fShader = 0; }
+    if(b.gShader != 0) { glDeleteShader(b.gShader);  b.gShader = 0; }
+    string().swap(b.vSource);  string().swap(b.fSource);  string().swap(b.gSource);
+}
+
+//Reads a cache entry and hands it to the driver; whether the driver accepted it is checked in finish()
+GLuint ProgramCache::loadBinary(const string& path, unsigned long long key) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(fp == NULL) return 0;  //Not cached yet
+    CacheHeader header;
+    vector<char> binary;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, CACHE_MAGIC, 4) == 0
+              && header.version == CACHE_VERSION && header.key == key && header.length > 0;
+    if(ok) {
+        binary.resize(header.length);
+        ok = fread(&binary[0], 1, header.length, fp) == header.length;
+    }
+    fclose(fp);
+    if(!ok) {
+        cerr << "Program cache: ignoring unreadable entry " << path << endl;
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, &binary[0], (GLsizei) header.length);
+    return program;
+}
+
+void ProgramCache::storeBinary(const string& path, unsigned long long key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) return;
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.key = key;
+    vector<char> binary(length);
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &header.format, &binary[0]);
+    if(written <= 0) return;
+    header.length = (GLuint) written;
+
+    mkdir(directory.c_str(), 0755);  //Fails harmlessly if it exists
+    string temp = path + ".tmp";
+    FILE* fp = fopen(temp.c_str(), "wb");
+    if(fp == NULL) {
+        cerr << "Program cache: could not write " << temp << endl;
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(&binary[0], 1, written, fp) == (size_t) written;
+    ok = fclose(fp) == 0 && ok;
+    if(!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        cerr << "Program cache: could not write " << path << endl;
+        remove(temp.c_str());
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef __PROGRAMCACHE_H__
+#define __PROGRAMCACHE_H__
+
+#include "Angel-yjc.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ Shader programs built in the background and cached on disk with glGetProgramBinary/glProgramBinary
+    - request() starts a build and returns at once: either glProgramBinary from the cache or glCompileShader +
+      glLinkProgram, with no status query in between, so the driver can work on every requested program together
+    - With GL_KHR_parallel_shader_compile the driver compiles on its own threads, and poll() asks
+      GL_COMPLETION_STATUS_KHR, which never blocks; draw with a fallback program until poll() returns the program.
+      Without the extension the first poll() waits for the build, just as wait() does
+    - Sources come from shaderSource() (shadersource.h); the key is a 64-bit FNV-1a hash of both expanded sources and
+      the driver's vendor, renderer and version strings, so editing a shader or updating the driver misses the cache
+    - A cache hit skips compiling and linking entirely; a binary the driver rejects (or a missing or truncated file)
+      falls back to compiling from source, and the fresh binary replaces the old one
+    - Files are written to a temporary name and renamed, so a crash never leaves a half-written entry behind
+    - Drivers that offer no binary formats (GL_NUM_PROGRAM_BINARY_FORMATS == 0) always compile from source
+ ***/
+class ProgramCache {
+public:
+    ProgramCache() : directory("shadercache"), enabled(true), initialized(false), useCache(false), parallel(false),
+                     hits(0), misses(0) {}
+
+    void setDirectory(const string& dir) { directory = dir; }
+    void disable() { enabled = false; }
+
+    //Starts a build; returns its handle, -1 on failure. The geometry shader is optional
+    int request(const char* vShaderFile, const char* fShaderFile, const char* gShaderFile = NULL);
+    GLuint poll(int handle);  //The program once it's built; 0 while building, or if it failed
+    GLuint wait(int handle);  //Blocks until the program is built; 0 (after printing the compile/link log) if it failed
+    bool failed(int handle) const { return handle < 0 || builds[handle].failed; }
+
+    GLuint load(const char* vShaderFile, const char* fShaderFile) { return wait(request(vShaderFile, fShaderFile)); }
+
+    int getHits() const { return hits; }
+    int getMisses() const { return misses; }
+
+private:
+    struct Build {
+        string vName, fName, gName, vSource, fSource, gSource;  //Sources are dropped once the build is done; gName may be empty
+        string path;  //Cache entry
+        unsigned long long key;
+        GLuint program, vShader, fShader, gShader;
+        bool fromBinary, done, failed;
+        chrono::steady_clock::time_point start;
+    };
+
+    void initialize();
+    void compile(Build& b);
+    void finish(Build& b);
+    GLuint loadBinary(const string& path, unsigned long long key);
+    void storeBinary(const string& path, unsigned long long key, GLuint program);
+
+    vector<Build> builds;
+    string directory;
+    bool enabled, initialized, useCache, parallel;
+    int hits, misses;
+};
+
+#endif // __PROGRAMCACHE_H__
@@ -0,0 +1,175 @@
+#include "resolution.h"
+#include "glcaps.h"
+#include "uniforms.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+const GLfloat MIN_SCALE = 0.5;   //Of the window's width and height
+const GLfloat MAX_STEP = 0.05;   //Largest change of scale per frame
+const double DEADBAND = 0.1;     //No change while the frame time is within this fraction of the budget
+const double SMOOTHING = 0.1;    //Weight of each new measurement in the average
+const double DEFERRED = 0.1;     //A GPU span under this fraction of the CPU frame means the GPU's work happens elsewhere
+const int HOLD_FRAMES = 300;     //Measurements at full size before scaling down again, once scaling didn't pay
+const int SETTLE_FRAMES = 30;    //Measurements at full size before scaling down at all, for the average to settle
+
+DynamicResolution::DynamicResolution() : enabled(false), timerQueries(false), budget(1000.0 / 60), sharpness(0),
+                                         scale(1), smoothedMs(0), fullMs(0), hold(0), renderWidth(0), renderHeight(0), slot(0), timed(false),
+                                         fbo(0), color(0), depth(0), fboWidth(0), fboHeight(0), scaled(false), build(-1),
+                                         program(0), vao(0), regionLoc(-1), texelLoc(-1), sharpnessLoc(-1) {
+    for(int f = 0; f < NUM_FRAMES; f++) { queries[f][0] = queries[f][1] = 0;  issued[f] = false; }
+}
+
+void DynamicResolution::init(ProgramCache& programs, double budgetMs, GLfloat sharpen) {
+    budget = budgetMs;
+    sharpness = sharpen;
+    timerQueries = hasGLVersion(3, 3) || hasGLExtension("GL_ARB_timer_query");
+    if(timerQueries) {
+        for(int f = 0; f < NUM_FRAMES; f++) glGenQueries(2, queries[f]);
+    }
+    glGenVertexArrays(1, &vao);  //No attributes: the triangle comes from gl_VertexID
+    if(sharpness > 0) build = programs.request("vshader_upscale.glsl", "fshader_upscale.glsl");
+}
+
+void DynamicResolution::setEnabled(bool on) {
+    enabled = on;
+    if(!on) scale = 1;
+    smoothedMs = fullMs = 0;
+    hold = SETTLE_FRAMES;
+    timed = false;
+}
+
+//Takes the measurements that have come in, never waiting for one
+void DynamicResolution::collect() {
+    Clock::time_point now = Clock::now();
+    double cpuMs = chrono::duration<double, milli>(now - lastBegin).count();
+    bool cpuValid = timed;
+    lastBegin = now;
+    timed = enabled;
+    if(!enabled) return;
+
+    double gpuMs = -1;
+    slot = (slot + 1) % NUM_FRAMES;
+    if(timerQueries && issued[slot]) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available) {
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            if(end >= start) gpuMs = (end - start) * 1e-6;
+            issued[slot] = false;
+        }
+    }
+    if(cpuValid && (gpuMs >= 0 ? gpuMs < DEFERRED * cpuMs : !timerQueries)) adjust(cpuMs);
+    else if(gpuMs >= 0) adjust(gpuMs);
+}
+
+void DynamicResolution::adjust(double ms) {
+    smoothedMs = smoothedMs > 0 ? smoothedMs + SMOOTHING * (ms - smoothedMs) : ms;
+    if(scale >= 1) {
+        fullMs = smoothedMs;
+        if(hold > 0) { hold--;  return; }
+    }
+    else if(smoothedMs > fullMs * (1 + DEADBAND)) {
+        //Slower than at full size: the upscale costs more than the pixels save (or the frame waits on something else)
+        scale = 1;
+        smoothedMs = fullMs;
+        hold = HOLD_FRAMES;
+        return;
+    }
+    if(fabs(smoothedMs - budget) <= DEADBAND * budget) return;
+    //Time goes with pixels: the scale that would hit the budget is sqrt(budget / time) times this one
+    GLfloat wanted = scale * (GLfloat) sqrt(budget / smoothedMs);
+    scale = min(max(wanted, scale - MAX_STEP), scale + MAX_STEP);
+    scale = min(max(scale, MIN_SCALE), 1.0f);
+}
+
+bool DynamicResolution::allocate(int width, int height) {
+    if(fbo != 0 && width == fboWidth && height == fboHeight) return true;
+    if(fbo == 0) {
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &color);
+        glGenRenderbuffers(1, &depth);
+    }
+    fboWidth = width;  fboHeight = height;
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE) {
+        cerr << "Dynamic resolution: the " << width << "x" << height << " framebuffer is incomplete; drawing at full size"
+             << endl;
+        return false;
+    }
+    return true;
+}
+
+GLuint DynamicResolution::begin(GLuint target, int width, int height) {
+    collect();
+    renderWidth = width;  renderHeight = height;
+    scaled = false;
+    if(!enabled) return target;
+    if(timerQueries && !issued[slot]) glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+    if(scale >= 1 || !allocate(width, height)) return target;
+    renderWidth = max((int) floor(width * scale + 0.5f), 1);
+    renderHeight = max((int) floor(height * scale + 0.5f), 1);
+    scaled = true;
+    return fbo;
+}
+
+void DynamicResolution::finish(ProgramCache& programs, GLuint target, int width, int height) {
+    if(scaled && sharpness > 0 && program == 0 && !programs.failed(build)) {
+        program = programs.poll(build);
+        if(program != 0) {
+            UniformCache uniforms;
+            uniforms.reflect(program);
+            regionLoc = uniforms.location("Region");
+            texelLoc = uniforms.location("Texel");
+            sharpnessLoc = uniforms.location("Sharpness");
+            glUseProgram(program);
+            glUniform1i(uniforms.location("Scene"), UPSCALE_TEXTURE_UNIT);
+        }
+    }
+    if(scaled && (sharpness <= 0 || program == 0)) {  //Unsharpened, or until the program is built: a bilinear blit
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, width, height);
+    if(scaled && sharpness > 0 && program != 0) {
+        GLint polygonMode[2];
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glDisable(GL_DEPTH_TEST);
+        glUseProgram(program);
+        glUniform2f(regionLoc, (GLfloat) renderWidth / fboWidth, (GLfloat) renderHeight / fboHeight);
+        glUniform2f(texelLoc, 1.0f / fboWidth, 1.0f / fboHeight);
+        glUniform1f(sharpnessLoc, sharpness);
+        glActiveTexture(GL_TEXTURE0 + UPSCALE_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, color);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        if(depthTest) glEnable(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    }
+    if(enabled && timerQueries && !issued[slot]) {
+        glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+        issued[slot] = true;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef __RESOLUTION_H__
+#define __RESOLUTION_H__
+
+#include "Angel-yjc.h"
+#include "programcache.h"
+#include <chrono>
+
+using namespace std;
+
+/***
+ Dynamic resolution: the scene is drawn at a fraction of the window's pixels, chosen to keep the GPU's frame time on a
+ budget, and scaled up to the window
+    - begin() returns the framebuffer to draw the scene into: the window's own at full scale, otherwise an offscreen
+      one (allocated at the window's size, drawn in its lower left corner) that finish() scales up into the window:
+      a bilinear glBlitFramebuffer, or with a `sharpness` above 0 one full-screen triangle (fshader_upscale.glsl) that
+      sharpens the bilinear result with an unsharp mask. On llvmpipe the blit costs less than the five-tap shader
+    - GPU time is measured with a pair of GL_TIMESTAMP queries around each frame's scene (timestamps rather than
+      elapsed-time queries, so the profiler's phases can run inside them). Results are read NUM_FRAMES frames later
+      and only if available, so measuring never stalls
+    - When the GPU finishes its work at the flush or the swap instead of as commands arrive (llvmpipe), the span between
+      the timestamps misses most of it (under DEFERRED of the CPU's frame); the frame's time is then the CPU time from
+      one begin() to the next, which waits on that work
+    - Each measurement feeds an exponential moving average, and the scale moves toward the one that would put the
+      average on budget (frame time goes with the pixel count, the square of the scale). It doesn't move while the
+      average is within DEADBAND of the budget, moves at most MAX_STEP per frame, and stays within MIN_SCALE..1
+    - Scaled frames slower than the last full-size ones (past DEADBAND) mean the upscale costs more than the pixels
+      save, or the frame waits on something else (vsync, the CPU): the scale goes back to 1 for HOLD_FRAMES. It also
+      stays at 1 for the first SETTLE_FRAMES, so startup's long frames don't set the full-size time to beat
+    - Disabled, begin() returns the window's framebuffer at full scale and nothing is measured
+ ***/
+class DynamicResolution {
+public:
+    static const int NUM_FRAMES = 4;  //Query pairs in flight
+
+    DynamicResolution();
+
+    void init(ProgramCache& programs, double budgetMs, GLfloat sharpness);  //Call with a current context
+    void setEnabled(bool on);
+    bool isEnabled() const { return enabled; }
+
+    GLuint begin(GLuint target, int width, int height);  //Framebuffer to draw the scene into, at getWidth() x getHeight()
+    void finish(ProgramCache& programs, GLuint target, int width, int height);  //Leaves target bound, full size
+
+    int getWidth() const { return renderWidth; }
+    int getHeight() const { return renderHeight; }
+    GLfloat getScale() const { return scale; }
+    double getFrameMs() const { return smoothedMs; }  //Smoothed measurement, 0 until the first one
+
+private:
+    typedef chrono::steady_clock Clock;
+
+    void collect();
+    void adjust(double ms);
+    bool allocate(int width, int height);
+
+    bool enabled, timerQueries;
+    double budget;  //Milliseconds
+    GLfloat sharpness;
+    GLfloat scale;
+    double smoothedMs;
+    double fullMs;  //Smoothed measurement when last at full size
+    int hold;       //Measurements left before scaling down again
+    int renderWidth, renderHeight;
+
+    GLuint queries[NUM_FRAMES][2];  //Start and end timestamps
+    bool issued[NUM_FRAMES];
+    int slot;
+    Clock::time_point lastBegin;
+    bool timed;  //lastBegin belongs to a frame drawn with dynamic resolution on
+
+    GLuint fbo, color, depth;
+    int fboWidth, fboHeight;
+    bool scaled;  //This frame goes through the offscreen framebuffer
+
+    int build;  //ProgramCache handle
+    GLuint program, vao;
+    GLint regionLoc, texelLoc, sharpnessLoc;
+};
+
+#endif // __RESOLUTION_H__
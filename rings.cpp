@@ -0,0 +1,169 @@
+#include "rings.h"
+#include "mesh.h"
+#include <cmath>
+#include <random>
+
+struct RingBand {
+    double inner, outer;  //Planet radii
+    double depth;         //Relative optical depth
+};
+
+struct RingProfile {
+    const char* planet;
+    double poleRA, poleDec;  //Spin pole (right-hand rule), J2000 equatorial (degrees)
+    double massRatio;        //Sun's mass over the planet's
+    double share;            //Particles relative to the Saturn count
+    color4 color;
+    int numBands;
+    RingBand bands[10];
+};
+
+//Main ring bands; the narrow Uranian rings are widened to a few hundred km so they show at all
+static const RingProfile RING_PROFILES[] = {
+    { "Saturn", 40.589, 83.537, 3497.898, 1.0, color4(0.85, 0.78, 0.62, 1.0), 6, {
+        { 1.239, 1.527, 0.1 },    //C ring
+        { 1.527, 1.951, 2.0 },    //B ring
+        { 1.951, 2.027, 0.1 },    //Cassini Division
+        { 2.027, 2.214, 0.6 },    //A ring, inside the Encke Gap
+        { 2.219, 2.269, 0.6 },    //A ring, outside it
+        { 2.322, 2.330, 0.5 } } },  //F ring
+    //Uranus spins clockwise about its IAU north pole, so its spin pole is the opposite direction
+    { "Uranus", 77.311, 15.175, 22902.98, 0.1, color4(0.45, 0.45, 0.48, 1.0), 9, {
+        { 1.634, 1.640, 0.5 },    //6
+        { 1.649, 1.655, 0.5 },    //5
+        { 1.663, 1.669, 0.5 },    //4
+        { 1.746, 1.754, 0.6 },    //Alpha
+        { 1.782, 1.790, 0.6 },    //Beta
+        { 1.843, 1.849, 0.4 },    //Eta
+        { 1.860, 1.866, 0.8 },    //Gamma
+        { 1.886, 1.894, 0.6 },    //Delta
+        { 1.994, 2.008, 1.0 } } }   //Epsilon
+};
+
+const double GM_SUN = 4 * M_PI * M_PI;  //AU^3/yr^2
+
+int RingSystems::init(ProgramCache& programs, const BodyStore& bodies, int saturnParticles) {
+    if(saturnParticles <= 0) return 0;
+    vector<GLushort> particles;  //Radius, phase
+    mt19937 rng(20240229);  //Fixed seed: the same rings on every run
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    for(size_t p = 0; p < sizeof(RING_PROFILES) / sizeof(RING_PROFILES[0]); p++) {
+        const RingProfile& profile = RING_PROFILES[p];
+        int body = bodies.findBody(profile.planet);
+        if(body < 0) continue;
+
+        System s;
+        s.body = body;
+        s.first = (GLint) (particles.size() / 2);
+        s.count = (GLsizei) max(saturnParticles * profile.share, (double) MIN_PARTICLES);
+        s.inner = (GLfloat) profile.bands[0].inner;
+        s.outer = (GLfloat) profile.bands[profile.numBands - 1].outer;
+        double radius = bodies.radius[body];
+        s.meanMotion = (GLfloat) sqrt(GM_SUN / profile.massRatio / (radius * radius * radius));
+        dvec3 pole = sceneDirection(profile.poleRA, profile.poleDec);
+        s.pole = vec3((GLfloat) pole.x, (GLfloat) pole.y, (GLfloat) pole.z);
+        s.axisU = normalize(cross(s.pole, fabs(s.pole.x) < 0.9 ? vec3(1, 0, 0) : vec3(0, 0, 1)));
+        s.axisW = cross(s.axisU, s.pole);
+        s.color = profile.color;
+
+        vector<double> cumulative(profile.numBands);  //Depth times area, summed over the bands so far
+        double total = 0;
+        for(int b = 0; b < profile.numBands; b++) {
+            const RingBand& band = profile.bands[b];
+            total += band.depth * M_PI * (band.outer * band.outer - band.inner * band.inner);
+            cumulative[b] = total;
+        }
+        s.weightedArea = (GLfloat) total;
+
+        for(GLsizei i = 0; i < s.count; i++) {
+            double pick = uniform(rng) * total;
+            int b = 0;
+            while(b + 1 < profile.numBands && cumulative[b] < pick) b++;
+            const RingBand& band = profile.bands[b];
+            double r = sqrt(band.inner * band.inner + uniform(rng) * (band.outer * band.outer - band.inner * band.inner));
+            particles.push_back((GLushort) ((r - s.inner) / (s.outer - s.inner) * 65535.0 + 0.5));
+            particles.push_back((GLushort) (uniform(rng) * 65536.0));
+        }
+        systems.push_back(s);
+    }
+    if(systems.empty()) return 0;
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLushort) * particles.size(), &particles[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(ATTRIB_POSITION);  //The radius/phase pair takes the position slot
+    glVertexAttribPointer(ATTRIB_POSITION, 2, GL_UNSIGNED_SHORT, GL_TRUE, 0, BUFFER_OFFSET(0));
+    glBindVertexArray(0);
+
+    build = programs.request("vshader_rings.glsl", "fshader_rings.glsl");
+    return (int) systems.size();
+}
+
+bool RingSystems::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    uniforms.reflect(program);
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    return true;
+}
+
+void RingSystems::draw(ProgramCache& programs, const BodyStore& bodies, const mat4& view, const ViewFrustum& frustum,
+                       GLfloat pixelsPerRadian, double time) {
+    particlesDrawn = 0;
+    if(systems.empty() || !ready(programs)) return;
+
+    ids.clear();  cx.clear();  cy.clear();  cz.clear();  cr.clear();
+    for(size_t k = 0; k < systems.size(); k++) {
+        const vec3& c = bodies.relPos[systems[k].body];
+        ids.push_back((int) k);
+        cx.push_back(c.x);  cy.push_back(c.y);  cz.push_back(c.z);
+        cr.push_back((GLfloat) (systems[k].outer * bodies.renderRadius[systems[k].body]));
+    }
+    visible.clear();
+    if(cullSpheres(frustum, &cx[0], &cy[0], &cz[0], &cr[0], &ids[0], ids.size(), visible) == 0) return;
+
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glUniform1f(uniforms.location("Time"), (GLfloat) time);
+    for(size_t v = 0; v < visible.size(); v++) {
+        const System& s = systems[visible[v]];
+        vec3 center = bodies.relPos[s.body];
+        GLfloat scale = (GLfloat) bodies.renderRadius[s.body];
+
+        //Pixels per planet radius at the planet's distance, and how open the ring looks from here
+        GLfloat dist = max(length(center), scale);
+        GLfloat pixelsPerUnit = scale / dist * pixelsPerRadian;
+        GLfloat openness = max(fabs(dot(s.pole, center / dist)), 0.05f);
+        GLfloat ringPixels = M_PI * (s.outer * s.outer - s.inner * s.inner) * pixelsPerUnit * pixelsPerUnit * openness;
+        GLsizei count = (GLsizei) min((double) s.count, max((double) PARTICLES_PER_PIXEL * ringPixels, (double) MIN_PARTICLES));
+        //Alpha per particle that gives each band its optical depth in coverage, whatever the count
+        GLfloat coverage = s.weightedArea * pixelsPerUnit * pixelsPerUnit * openness / count;
+
+        mat4 model(s.axisU.x * scale, s.axisU.y * scale, s.axisU.z * scale, 0,
+                   s.pole.x * scale, s.pole.y * scale, s.pole.z * scale, 0,
+                   s.axisW.x * scale, s.axisW.y * scale, s.axisW.z * scale, 0,
+                   center.x, center.y, center.z, 1);  //Given in column order
+        mat4 modelView = view * model;
+        glUniformMatrix4fv(uniforms.location("ModelView"), 1, GL_TRUE, modelView);  //Angel's mat4 is row-major
+        glUniform1f(uniforms.location("InnerRadius"), s.inner);
+        glUniform1f(uniforms.location("RadiusSpan"), s.outer - s.inner);
+        glUniform1f(uniforms.location("MeanMotion"), s.meanMotion);
+        glUniform1f(uniforms.location("Coverage"), coverage);
+        glUniform4fv(uniforms.location("RingColor"), 1, s.color);
+        glDrawArrays(GL_POINTS, s.first, count);
+        particlesDrawn += count;
+    }
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
@@ -0,0 +1,67 @@
+#ifndef __RINGS_H__
+#define __RINGS_H__
+
+#include "bodystore.h"
+#include "frustum.h"
+#include "programcache.h"
+#include "uniforms.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ Planetary rings as clouds of orbiting particles (Saturn and Uranus, from a built-in table of ring bands)
+    - Each particle is a pair of normalized 16-bit values, radius across the ring system and starting phase, made once
+      in init(); the vertex shader (vshader_rings.glsl) moves it along its circular Keplerian orbit from the simulation
+      time alone, so the CPU does no per-particle work after init()
+    - Radii are drawn in proportion to each band's optical depth times its area, so the density of points follows the
+      bands, and the particles are generated in random order, so any prefix of them is an even thinning of the whole
+    - Density LOD: each ring system draws only a prefix of its particles, about PARTICLES_PER_PIXEL per pixel of ring on
+      screen (foreshortening included), and the shader gives each drawn particle proportionally more coverage (alpha,
+      then point size), so the ring keeps its brightness at any distance
+    - One GL_POINTS draw per ring system in the view frustum, alpha blended after the opaque bodies without writing depth
+    - Ring radii scale with the planet's renderRadius, so they sit where they belong around the exaggerated sphere;
+      orbital speeds use the real radii
+ ***/
+class RingSystems {
+public:
+    static const int PARTICLES_PER_PIXEL = 4;
+    static const int MIN_PARTICLES = 2000;  //Drawn however small the ring is, so it never flickers out
+
+    RingSystems() : build(-1), program(0), vao(0), vbo(0), particlesDrawn(0) {}
+
+    //Adds a ring system to every body that has one in the table: saturnParticles for Saturn, a tenth as many for the
+    //fainter Uranian rings. Returns the number of systems
+    int init(ProgramCache& programs, const BodyStore& bodies, int saturnParticles);
+    void draw(ProgramCache& programs, const BodyStore& bodies, const mat4& view, const ViewFrustum& frustum,
+              GLfloat pixelsPerRadian, double time);
+
+    long getParticlesDrawn() const { return particlesDrawn; }  //Last frame
+
+private:
+    struct System {
+        int body;
+        GLint first;
+        GLsizei count;
+        GLfloat inner, outer;  //Planet radii
+        GLfloat meanMotion;    //Radians per year of an orbit one (real) planet radius out
+        GLfloat weightedArea;  //Sum of optical depth times area over the bands, in planet radii squared
+        vec3 axisU, pole, axisW;  //Ring plane basis in scene axes
+        color4 color;
+    };
+
+    bool ready(ProgramCache& programs);
+
+    int build;  //ProgramCache handle
+    GLuint program;
+    UniformCache uniforms;
+    GLuint vao, vbo;
+    vector<System> systems;
+    long particlesDrawn;
+
+    //Bounding spheres of the ring systems, packed for cullSpheres()
+    vector<int> ids, visible;
+    vector<GLfloat> cx, cy, cz, cr;
+};
+
+#endif // __RINGS_H__
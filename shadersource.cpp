@@ -0,0 +1,78 @@
+#include "shadersource.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <iostream>
+
+#ifdef HAVE_EMBEDDED_SHADERS
+#include "embedded_shaders.h"
+static string shaderDirectory;  //Empty: use the embedded sources
+#else
+static string shaderDirectory = ".";
+#endif
+
+static const int MAX_INCLUDE_DEPTH = 16;  //Same limit as embed_shaders.cmake
+
+void setShaderDirectory(const string& dir) {
+    shaderDirectory = dir;
+}
+
+//Appends the file's text to out with each #include "name" replaced by that file, like embed_shaders.cmake
+static bool expandFile(const string& name, int depth, string& out) {
+    if(depth > MAX_INCLUDE_DEPTH) {
+        cerr << name << ": #include nested too deeply (is there a cycle?)" << endl;
+        return false;
+    }
+    MappedFile file;
+    if(!file.open(shaderDirectory + "/" + name)) {
+        cerr << "Failed to read " << shaderDirectory << "/" << name << endl;
+        return false;
+    }
+    const char* p = file.data ? file.data : "";
+    const char* end = p + file.size;
+    static const char DIRECTIVE[] = "#include";
+    const size_t directiveLen = sizeof(DIRECTIVE) - 1;
+    while(p < end) {
+        const char* hash = (const char*) memchr(p, '#', end - p);
+        if(hash == NULL) break;
+        const char* q = hash + 1;
+        bool isInclude = (size_t) (end - hash) > directiveLen && memcmp(hash, DIRECTIVE, directiveLen) == 0;
+        const char *nameBegin = NULL, *nameEnd = NULL;
+        if(isInclude) {
+            q = hash + directiveLen;
+            const char* s = q;
+            while(s < end && (*s == ' ' || *s == '\t')) s++;
+            if(s > q && s < end && *s == '"') {
+                nameBegin = s + 1;
+                nameEnd = (const char*) memchr(nameBegin, '"', end - nameBegin);
+                if(nameEnd != NULL && memchr(nameBegin, '\n', nameEnd - nameBegin) != NULL) nameEnd = NULL;
+            }
+        }
+        if(nameEnd == NULL || nameEnd == nameBegin) {  //Any other '#': copy through it
+            out.append(p, q - p);
+            p = q;
+            continue;
+        }
+        out.append(p, hash - p);
+        if(!expandFile(string(nameBegin, nameEnd), depth + 1, out)) return false;
+        p = nameEnd + 1;
+    }
+    out.append(p, end - p);
+    return true;
+}
+
+bool shaderSource(const string& name, string& text) {
+    text.clear();
+#ifdef HAVE_EMBEDDED_SHADERS
+    if(shaderDirectory.empty()) {
+        for(size_t i = 0; i < sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]); i++) {
+            if(name == EMBEDDED_SHADERS[i].name) {
+                text.assign(EMBEDDED_SHADERS[i].source, EMBEDDED_SHADERS[i].length);
+                return true;
+            }
+        }
+        cerr << "No embedded shader named " << name << endl;
+        return false;
+    }
+#endif
+    return expandFile(name, 0, text);
+}
@@ -0,0 +1,28 @@
+#ifndef __SHADERSOURCE_H__
+#define __SHADERSOURCE_H__
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/***
+ GLSL sources, looked up by file name
+    - Normally compiled into the program: CMake runs embed_shaders.cmake over the *.glsl files, expanding
+      #include "file" once at build time, so fetching a shader is a table lookup with no file I/O
+    - setShaderDirectory() (--shader-dir) loads them from a directory instead, for editing shaders without rebuilding;
+      files are mmap'd and #include is expanded the same way at load time
+    - Builds that skip the CMake step (no HAVE_EMBEDDED_SHADERS) read from the working directory, as InitShader() did
+    - Shader files must be plain ASCII
+ ***/
+
+struct EmbeddedShader {
+    const char* name;
+    const char* source;
+    size_t length;
+};
+
+void setShaderDirectory(const string& dir);
+bool shaderSource(const string& name, string& text);  //Fills text with the expanded source; false if there's no such shader
+
+#endif // __SHADERSOURCE_H__
@@ -0,0 +1,214 @@
+#include "shadow.h"
+#include <cfloat>
+#include <cmath>
+
+//Cube face orientations (the GL_TEXTURE_CUBE_MAP_POSITIVE_X... order): forward and up
+static const GLfloat FACE_AXES[6][2][3] = {
+    { {  1, 0, 0 }, { 0, -1, 0 } },
+    { { -1, 0, 0 }, { 0, -1, 0 } },
+    { { 0,  1, 0 }, { 0, 0,  1 } },
+    { { 0, -1, 0 }, { 0, 0, -1 } },
+    { { 0, 0,  1 }, { 0, -1, 0 } },
+    { { 0, 0, -1 }, { 0, -1, 0 } },
+};
+
+static const GLfloat MIN_RECEIVER_PIXELS = 2;  //Radius on screen
+
+static mat4 faceView(int face) {
+    const GLfloat* f = FACE_AXES[face][0];
+    const GLfloat* u = FACE_AXES[face][1];
+    return LookAt(vec4(0.0, 0.0, 0.0, 1.0), vec4(f[0], f[1], f[2], 1.0), vec4(u[0], u[1], u[2], 0.0));
+}
+
+void ShadowMap::init(ProgramCache& programs, int mapSize) {
+    size = mapSize;
+    if(size <= 0) return;
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if(size > maxSize) {
+        cerr << "Shadow map size " << size << " is over the GL limit; using " << maxSize << endl;
+        size = maxSize;
+    }
+    build = programs.request("vshader_shadow.glsl", "fshader_shadow.glsl", "gshader_shadow.glsl");
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, size, size, 6, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);  //Linear + compare: 2x2 PCF
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);  //Layered: gl_Layer picks the face
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE) {
+        cerr << "Shadow framebuffer is incomplete (status 0x" << hex << status << dec << "); shadows are off" << endl;
+        size = 0;
+    }
+}
+
+bool ShadowMap::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    UniformCache uniforms;
+    uniforms.reflect(program);
+    uniforms.bindBlock("Shadow", SHADOW_BINDING);
+    uniforms.bindBlock("Casters", CASTER_BINDING);
+    return true;
+}
+
+void ShadowMap::uploadShadow(DynamicBuffer& stream, const ShadowUniforms& shadow) {
+    DynamicSlice slice = stream.upload(&shadow, sizeof(shadow), stream.getUniformAlignment());
+    glBindBufferRange(GL_UNIFORM_BUFFER, SHADOW_BINDING, slice.buffer, slice.offset, slice.size);
+}
+
+void ShadowMap::bindTexture() const {
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
+
+//Crops face to the receiving bodies inside it, culls the casters against the result and marks them in masks.
+//Returns false if no receiver lies in the face
+bool ShadowMap::fitFace(int face, const BodyStore& bodies, const vec3& light, mat4& matrix) {
+    mat4 view = faceView(face);
+    const GLfloat* forward = FACE_AXES[face][0];
+    GLfloat uMin = FLT_MAX, uMax = -FLT_MAX, vMin = FLT_MAX, vMax = -FLT_MAX, far = 0;
+    for(size_t k = 0; k < receiving.size(); k++) {
+        int i = receiving[k];
+        vec4 c = view * vec4(bodies.relPos[i] - light, 1.0);
+        GLfloat r = (GLfloat) bodies.renderRadius[i];
+        //Project the corners of the sphere's view-aligned bounding box (d = distance along the face axis)
+        GLfloat bu0 = FLT_MAX, bu1 = -FLT_MAX, bv0 = FLT_MAX, bv1 = -FLT_MAX;
+        int behind = 0;
+        for(int corner = 0; corner < 8; corner++) {
+            GLfloat x = c.x + ((corner & 1) ? r : -r);
+            GLfloat y = c.y + ((corner & 2) ? r : -r);
+            GLfloat d = -(c.z + ((corner & 4) ? r : -r));
+            if(d <= r * 1e-3f) {  //Behind the light's plane: the box reaches the face edge on that side
+                behind++;
+                if(x > 0) bu1 = 1;  else bu0 = -1;
+                if(y > 0) bv1 = 1;  else bv0 = -1;
+                continue;
+            }
+            bu0 = min(bu0, x / d);  bu1 = max(bu1, x / d);
+            bv0 = min(bv0, y / d);  bv1 = max(bv1, y / d);
+        }
+        if(behind == 8) continue;
+        if(bu1 < -1 || bu0 > 1 || bv1 < -1 || bv0 > 1) continue;  //Not in this face
+        uMin = min(uMin, bu0);  uMax = max(uMax, bu1);
+        vMin = min(vMin, bv0);  vMax = max(vMax, bv1);
+        far = max(far, -c.z + r);
+    }
+    if(far == 0) return false;
+
+    //Two texels of margin for the 2x2 filter, then keep to the face
+    GLfloat du = max(uMax - uMin, 1e-6f) * 2 / size, dv = max(vMax - vMin, 1e-6f) * 2 / size;
+    uMin = max(uMin - du, -1.0f);  uMax = min(uMax + du, 1.0f);
+    vMin = max(vMin - dv, -1.0f);  vMax = min(vMax + dv, 1.0f);
+    GLfloat sx = 2 / (uMax - uMin), sy = 2 / (vMax - vMin);
+    mat4 crop(sx, 0, 0, 0,
+              0, sy, 0, 0,
+              0, 0, 1, 0,
+              -(uMax + uMin) * sx / 2, -(vMax + vMin) * sy / 2, 0, 1);  //Column order: scale, then shift, in clip space
+
+    //Everything inside the Sun is irrelevant, so that bounds the near plane until the casters are known
+    GLfloat near = max((GLfloat) bodies.renderRadius[0], far * 1e-6f);
+    if(near >= far) return false;
+    ViewFrustum frustum;
+    frustum.extract(crop * Perspective(90.0, 1.0, near, far) * view);
+    visible.clear();
+    if(cullSpheres(frustum, casterX.data(), casterY.data(), casterZ.data(), casterR.data(), casterIndex.data(),
+                   casterIndex.size(), visible) == 0)
+        return false;
+
+    //Tighten the near plane to the closest caster, for depth precision
+    GLfloat nearest = far;
+    for(size_t k = 0; k < visible.size(); k++) {
+        int c = visible[k];
+        GLfloat d = casterX[c]*forward[0] + casterY[c]*forward[1] + casterZ[c]*forward[2] - casterR[c];  //Along the face axis
+        nearest = min(nearest, d);
+        masks[c] |= 1 << face;
+    }
+    near = max(near, nearest * 0.99f);
+    matrix = crop * Perspective(90.0, 1.0, near, far) * view;
+    casterDraws += visible.size();
+    return true;
+}
+
+void ShadowMap::render(ProgramCache& programs, DynamicBuffer& stream, const BodyStore& bodies, const vector<int>& receivers,
+                       const Mesh& sphere, GLfloat pixelsPerRadian, bool enabled) {
+    ShadowUniforms shadow;
+    facesRendered = 0;  casterDraws = 0;
+    if(!enabled || size <= 0 || !ready(programs)) {
+        uploadShadow(stream, shadow);
+        return;
+    }
+
+    //Casters: every sphere body but the Sun, relative to the light
+    vec3 light = bodies.relPos[0];
+    casterIds.clear();  casterIndex.clear();  casterX.clear();  casterY.clear();  casterZ.clear();  casterR.clear();
+    for(size_t k = 0; k < bodies.sphereIds.size(); k++) {
+        if(bodies.sphereIds[k] == 0) continue;
+        casterIndex.push_back((int) casterIds.size());
+        casterIds.push_back(bodies.sphereIds[k]);
+        casterX.push_back(bodies.sphereX[k] - light.x);  casterY.push_back(bodies.sphereY[k] - light.y);
+        casterZ.push_back(bodies.sphereZ[k] - light.z);  casterR.push_back(bodies.sphereR[k]);
+    }
+    if(casterIds.empty()) {
+        uploadShadow(stream, shadow);
+        return;
+    }
+    masks.assign(casterIds.size(), 0);
+    //A body a pixel or two across can't show a shadow, and would only widen the crop
+    receiving.clear();
+    for(size_t k = 0; k < receivers.size(); k++) {
+        int i = receivers[k];
+        if(i == 0) continue;  //The light is inside the Sun
+        if(bodies.renderRadius[i] * pixelsPerRadian >= MIN_RECEIVER_PIXELS * length(bodies.relPos[i])) receiving.push_back(i);
+    }
+    for(int face = 0; face < 6; face++) {
+        if(fitFace(face, bodies, light, shadow.faceMatrix[face])) {
+            shadow.activeFaces |= 1 << face;
+            facesRendered++;
+        }
+    }
+    uploadShadow(stream, shadow);
+    if(shadow.activeFaces == 0) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, size, size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_POLYGON_OFFSET_FILL);  //Slope-scaled bias against self-shadowing
+    glPolygonOffset(2.0, 4.0);
+    glUseProgram(program);
+    glBindVertexArray(sphere.vao);
+
+    //Every caster with a face mask goes out in instanced batches of MAX_SHADOW_CASTERS (one draw for the catalog)
+    CasterUniforms batch;
+    GLsizei count = 0;
+    for(size_t c = 0; c <= casterIds.size(); c++) {
+        if(c < casterIds.size() && masks[c] != 0) {
+            batch.sphere[count] = vec4(casterX[c], casterY[c], casterZ[c], casterR[c]);
+            batch.mask[count++] = masks[c];
+        }
+        if(count == MAX_SHADOW_CASTERS || (c == casterIds.size() && count > 0)) {
+            DynamicSlice slice = stream.upload(&batch, sizeof(CasterUniforms), stream.getUniformAlignment());
+            glBindBufferRange(GL_UNIFORM_BUFFER, CASTER_BINDING, slice.buffer, slice.offset, slice.size);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, sphere.count, GL_UNSIGNED_INT,
+                                              BUFFER_OFFSET(sizeof(GLuint) * sphere.firstIndex), count, sphere.baseVertex);
+            count = 0;
+        }
+    }
+    glDisable(GL_POLYGON_OFFSET_FILL);
+}
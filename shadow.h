@@ -0,0 +1,64 @@
+#ifndef __SHADOW_H__
+#define __SHADOW_H__
+
+#include "bodystore.h"
+#include "dynamicbuffer.h"
+#include "frustum.h"
+#include "mesh.h"
+#include "programcache.h"
+#include "uniforms.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ Omnidirectional shadows from the Sun (body 0), rendered in one pass
+    - Six layers of a depth texture array, one per cube face around the light, all written by a single instanced draw:
+      a geometry shader (gshader_shadow.glsl) sends each caster's triangles to the layers set in its face mask
+    - A plain 90-degree cube face is far too coarse at solar system scale (one texel of a 2048 face is wider than the
+      Earth at 1 AU), so each face's projection is cropped to the bounding boxes of the receivers (the visible sphere
+      bodies big enough on screen to show a shadow) that lie in it, and its depth range to the casters in front of
+      them. Faces without receivers are skipped
+    - Casters are culled per face with cullSpheres() against the cropped face frustum, so a body is only drawn into
+      the layers where it can shadow something on screen
+    - fshader.glsl picks the face by the dominant axis of the light-to-fragment direction and compares through a
+      sampler2DArrayShadow (2x2 PCF); the Shadow block's face mask is 0 when shadows are off
+    - The resolution of each layer is set by init() (--shadows <size>; 0 turns shadows off)
+ ***/
+class ShadowMap {
+public:
+    ShadowMap() : size(0), build(-1), program(0), texture(0), fbo(0), facesRendered(0), casterDraws(0) {}
+
+    void init(ProgramCache& programs, int size);
+    //Fits and renders the layers for this frame's receivers (visible sphere bodies), or just clears the face mask when
+    //shadows are off or their program is still building; either way the Shadow block is written to a slice of stream
+    //and bound, every frame. pixelsPerRadian converts angular size to screen size.
+    //Leaves the shadow framebuffer bound when it draws
+    void render(ProgramCache& programs, DynamicBuffer& stream, const BodyStore& bodies, const vector<int>& receivers,
+                const Mesh& sphere, GLfloat pixelsPerRadian, bool enabled);
+    void bindTexture() const;  //To SHADOW_TEXTURE_UNIT
+
+    int getSize() const { return size; }
+    int getFacesRendered() const { return facesRendered; }  //Last frame's active layers
+    long getCasterDraws() const { return casterDraws; }  //Last frame's caster-layer pairs drawn
+
+private:
+    bool ready(ProgramCache& programs);
+    bool fitFace(int face, const BodyStore& bodies, const vec3& light, mat4& matrix);
+    void uploadShadow(DynamicBuffer& stream, const ShadowUniforms& shadow);
+
+    int size;
+    int build;  //ProgramCache handle
+    GLuint program;
+    GLuint texture, fbo;
+    int facesRendered;
+    long casterDraws;
+
+    //Light-relative bounding spheres of the casters, packed for cullSpheres()
+    vector<int> receiving;  //This frame's receivers
+    vector<int> casterIds, casterIndex, visible;
+    vector<GLfloat> casterX, casterY, casterZ, casterR;
+    vector<int> masks;  //Layers per caster
+};
+
+#endif // __SHADOW_H__
@@ -0,0 +1,28 @@
+/***************************
+ * File: shadowing.glsl:
+ *   Shared by the fragment shaders through #include: the Shadow block
+ *   and the lookup into the Sun's shadow map (shadow.h)
+ ****************************/
+
+layout(std140, row_major) uniform Shadow {  // Once per frame; mirrors ShadowUniforms in uniforms.h
+    mat4 FaceMatrix[6];  // Light-relative world position to the clip space of each layer of ShadowMap
+    int ActiveFaces;     // One bit per face that was rendered this frame; 0 when shadows are off
+};
+uniform sampler2DArrayShadow ShadowMap;  // SHADOW_TEXTURE_UNIT
+
+// lightToVertex: from the light to the point along the world axes, as shade() in lighting.glsl gives it
+float shadowFactor(vec3 lightToVertex)
+{
+    // The face is picked the way a cube map picks it: by the dominant axis of the direction from the light
+    vec3 a = abs(lightToVertex);
+    int face;
+    if (a.x >= a.y && a.x >= a.z) face = lightToVertex.x > 0.0 ? 0 : 1;
+    else if (a.y >= a.z)          face = lightToVertex.y > 0.0 ? 2 : 3;
+    else                          face = lightToVertex.z > 0.0 ? 4 : 5;
+    if ((ActiveFaces & (1 << face)) == 0) return 1.0;
+
+    vec4 clip = FaceMatrix[face] * vec4(lightToVertex, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    if (any(greaterThan(abs(ndc), vec3(1.0)))) return 1.0;  // Outside the fitted region: nothing there casts
+    return texture(ShadowMap, vec4(ndc.xy * 0.5 + 0.5, float(face), ndc.z * 0.5 + 0.5));
+}
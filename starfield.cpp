@@ -0,0 +1,227 @@
+#include "starfield.h"
+#include "kepler.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static const char STARS_MAGIC[4] = { 'S', 'S', 'S', 'T' };
+static const uint32_t STARS_VERSION = 1;
+
+struct StarsHeader {  //16 bytes, so the records after it stay aligned
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t recordBytes;
+};
+
+const double NAKED_EYE_LIMIT = 6.5;  //Faintest magnitude drawn at NAKED_EYE_PIXELS_PER_RADIAN
+const GLfloat MAX_STAR_PIXELS = 4;   //Sprite size of the brightest stars
+
+static bool magnitudeBefore(const StarRecord& s, GLshort millimag) { return s.magnitude < millimag; }
+
+bool StarField::load(ProgramCache& programs, const string& path) {
+    MappedFile file;
+    if(!file.open(path)) return false;  //No catalog is fine: the background stays plain
+    StarsHeader header;
+    if(file.size < sizeof(header)) {
+        cerr << path << ": file too small for a star catalog" << endl;
+        return false;
+    }
+    memcpy(&header, file.data, sizeof(header));
+    if(memcmp(header.magic, STARS_MAGIC, 4) != 0 || header.version != STARS_VERSION ||
+       header.recordBytes != sizeof(StarRecord)) {
+        cerr << path << ": bad magic or unsupported version" << endl;
+        return false;
+    }
+    if(header.count == 0) {
+        cerr << path << ": no stars in the catalog" << endl;
+        return false;
+    }
+    if(file.size < sizeof(header) + (size_t) header.count * sizeof(StarRecord)) {
+        cerr << path << ": truncated star catalog" << endl;
+        return false;
+    }
+    const StarRecord* stars = (const StarRecord*) (file.data + sizeof(header));
+    count = header.count;
+
+    //Sorted brightest first, so each step's prefix is one binary search into the mapping
+    brightest = stars[0].magnitude * 0.001f;
+    GLfloat faintest = stars[count - 1].magnitude * 0.001f;
+    int steps = (int) ceil((faintest - brightest) * INDEX_STEPS_PER_MAGNITUDE) + 1;
+    brighterThan.resize(steps + 1);
+    for(int i = 0; i < steps; i++) {
+        double limit = (brightest + (double) i / INDEX_STEPS_PER_MAGNITUDE) * 1000;
+        GLshort millimag = (GLshort) max(min(limit, 32767.0), -32768.0);
+        brighterThan[i] = (GLint) (lower_bound(stars, stars + count, millimag, magnitudeBefore) - stars);
+    }
+    brighterThan[steps] = (GLint) count;
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(StarRecord) * count, stars, GL_STATIC_DRAW);  //Straight from the mapping
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(StarRecord), BUFFER_OFFSET(0));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(StarRecord), BUFFER_OFFSET(offsetof(StarRecord, magnitude)));
+    glBindVertexArray(0);
+
+    build = programs.request("vshader_stars.glsl", "fshader_stars.glsl");
+    return true;
+}
+
+bool StarField::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    uniforms.reflect(program);
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    return true;
+}
+
+GLfloat StarField::getLimit(GLfloat pixelsPerRadian) const {
+    //Finer pixels split the sky's glow among more of them, so fainter stars stand out: the limit goes up by the ratio
+    //of pixel areas, in magnitudes
+    return (GLfloat) (NAKED_EYE_LIMIT + 5 * log10(pixelsPerRadian / NAKED_EYE_PIXELS_PER_RADIAN));
+}
+
+void StarField::draw(ProgramCache& programs, GLfloat pixelsPerRadian) {
+    starsDrawn = 0;
+    if(count == 0 || !ready(programs)) return;
+    GLfloat limit = getLimit(pixelsPerRadian);
+    int step = (int) ceil((limit - brightest) * INDEX_STEPS_PER_MAGNITUDE);
+    if(step <= 0) return;
+    GLsizei n = brighterThan[min(step, (int) brighterThan.size() - 1)];
+    if(n == 0) return;
+
+    glUseProgram(program);
+    glBindVertexArray(vao);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);  //At depth 1: shows only where nothing was drawn
+    glUniform1f(uniforms.location("Limit"), limit);
+    glUniform1f(uniforms.location("MaxSize"), MAX_STAR_PIXELS);
+    glDrawArrays(GL_POINTS, 0, n);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(0);
+    starsDrawn = n;
+}
+
+//----------------------------------------------------------------------------
+//  Conversion from CSV
+//
+
+//Splits one CSV line into fields; double quotes may wrap a field (and "" inside one is a quote)
+static void splitCSV(const char* p, const char* end, vector<string>& fields) {
+    fields.clear();
+    string field;
+    bool quoted = false;
+    for(; p < end; p++) {
+        if(quoted) {
+            if(*p == '"' && p + 1 < end && p[1] == '"') { field += '"';  p++; }
+            else if(*p == '"') quoted = false;
+            else field += *p;
+        }
+        else if(*p == '"') quoted = true;
+        else if(*p == ',') { fields.push_back(field);  field.clear(); }
+        else if(*p != '\r') field += *p;
+    }
+    fields.push_back(field);
+}
+
+static bool parseField(const vector<string>& fields, int column, double& out) {
+    if(column >= (int) fields.size() || fields[column].empty()) return false;
+    char* end;
+    out = strtod(fields[column].c_str(), &end);
+    return end != fields[column].c_str();
+}
+
+static GLushort octUnit(double v) {
+    return (GLushort) floor((min(max(v, -1.0), 1.0) * 0.5 + 0.5) * 65535 + 0.5);
+}
+
+bool convertStarCatalog(const string& csvPath, const string& binPath) {
+    MappedFile file;
+    if(!file.open(csvPath)) {
+        cerr << "Failed to read " << csvPath << endl;
+        return false;
+    }
+    const char* p = file.data ? file.data : "";
+    const char* end = p + file.size;
+    vector<string> fields;
+    int column[4] = { -1, -1, -1, -1 };  //ra, dec, mag, ci
+    const char* const names[4] = { "ra", "dec", "mag", "ci" };
+    vector<StarRecord> stars;
+    long skipped = 0;
+    for(bool header = true; p < end; header = false) {
+        const char* nl = (const char*) memchr(p, '\n', end - p);
+        if(nl == NULL) nl = end;
+        splitCSV(p, nl, fields);
+        p = nl < end ? nl + 1 : end;
+        if(header) {
+            for(size_t f = 0; f < fields.size(); f++)
+                for(int c = 0; c < 4; c++)
+                    if(fields[f] == names[c]) column[c] = (int) f;
+            for(int c = 0; c < 4; c++) {
+                if(column[c] < 0) {
+                    cerr << csvPath << ": no '" << names[c] << "' column in the header" << endl;
+                    return false;
+                }
+            }
+            continue;
+        }
+        if(fields.size() == 1 && fields[0].empty()) continue;  //Blank line
+        double ra, dec, mag, ci;
+        if(!parseField(fields, column[0], ra) || !parseField(fields, column[1], dec) ||
+           !parseField(fields, column[2], mag) || !parseField(fields, column[3], ci) || mag < -20 || mag > 32) {
+            skipped++;  //The Sun is the only star brighter than -20
+            continue;
+        }
+        dvec3 d = sceneDirection(ra * 15, dec);
+        double sum = fabs(d.x) + fabs(d.y) + fabs(d.z);
+        double ox = d.x / sum, oy = d.y / sum;
+        if(d.z < 0) {  //Lower half folded over the diagonals
+            double fx = (1 - fabs(oy)) * (ox >= 0 ? 1 : -1), fy = (1 - fabs(ox)) * (oy >= 0 ? 1 : -1);
+            ox = fx;  oy = fy;
+        }
+        StarRecord s;
+        s.octX = octUnit(ox);
+        s.octY = octUnit(oy);
+        s.magnitude = (GLshort) floor(mag * 1000 + 0.5);
+        s.colorIndex = (GLshort) floor(min(max(ci, -32.0), 32.0) * 1000 + 0.5);
+        stars.push_back(s);
+    }
+    stable_sort(stars.begin(), stars.end(), [](const StarRecord& a, const StarRecord& b) { return a.magnitude < b.magnitude; });
+
+    StarsHeader header;
+    memcpy(header.magic, STARS_MAGIC, 4);
+    header.version = STARS_VERSION;
+    header.count = (uint32_t) stars.size();
+    header.recordBytes = sizeof(StarRecord);
+    FILE* fp = fopen(binPath.c_str(), "wb");
+    if(fp == NULL) {
+        cerr << "Failed to write " << binPath << endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if(!stars.empty()) ok = ok && fwrite(&stars[0], sizeof(StarRecord), stars.size(), fp) == stars.size();
+    ok = fclose(fp) == 0 && ok;
+    if(!ok) {
+        cerr << "Failed to write " << binPath << endl;
+        return false;
+    }
+    cout << "Wrote " << stars.size() << " stars to " << binPath << " (" << skipped << " rows skipped)" << endl;
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef __STARFIELD_H__
+#define __STARFIELD_H__
+
+#include "Angel-yjc.h"
+#include "programcache.h"
+#include "uniforms.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ Background stars from a binary catalog (stars.bin), drawn as point sprites at infinite distance
+    - The file is a 16-byte header and then one 8-byte StarRecord per star: direction as two 16-bit octahedral
+      coordinates (about 6" apart), then magnitude and B-V color index in thousandths. Directions are on the scene
+      axes (ecliptic of J2000), and stars are sorted brightest first
+    - load() maps the file and hands the records to glBufferData as they are: no parsing and no copy on our side. The
+      vertex shader (vshader_stars.glsl) decodes the fields straight from the vertex attributes, and the mapping is
+      dropped once the static buffer has them
+    - Since the stars are sorted, every magnitude limit is a prefix of the buffer: draw() picks the limit from the
+      pixels per radian (a narrower field of view or a bigger window resolves fainter stars), looks up its prefix in a
+      table built at load time, and draws it with one glDrawArrays
+    - Stars are placed at w = 0 and at depth 1, so they sit behind everything however far the camera goes. They are
+      drawn after the opaque bodies with GL_LEQUAL and without writing depth, so only background pixels shade them, and
+      blended additively
+    - convertStarCatalog() writes the binary from a CSV with ra (hours), dec (degrees), mag and ci columns, as in the
+      HYG database; the Sun's own row, and rows missing any of the four, are skipped
+    - On error load() and convertStarCatalog() print the reason to cerr and return false
+ ***/
+
+struct StarRecord {  //8 bytes; read by the vertex shader as is
+    GLushort octX, octY;  //Octahedral direction, 0..65535 across -1..1
+    GLshort magnitude;    //Thousandths
+    GLshort colorIndex;   //B-V, thousandths
+};
+
+class StarField {
+public:
+    static const int NAKED_EYE_PIXELS_PER_RADIAN = 618;  //The default 512 pixel window at 45 degrees
+    static const int INDEX_STEPS_PER_MAGNITUDE = 10;
+
+    StarField() : build(-1), program(0), vao(0), vbo(0), count(0), starsDrawn(0) {}
+
+    bool load(ProgramCache& programs, const string& path);  //Call with a current context
+    void draw(ProgramCache& programs, GLfloat pixelsPerRadian);
+
+    size_t size() const { return count; }
+    long getStarsDrawn() const { return starsDrawn; }  //Last frame
+    GLfloat getLimit(GLfloat pixelsPerRadian) const;   //Faintest magnitude drawn at that scale
+
+private:
+    bool ready(ProgramCache& programs);
+
+    int build;  //ProgramCache handle
+    GLuint program;
+    UniformCache uniforms;
+    GLuint vao, vbo;
+    size_t count;
+    GLfloat brightest;            //Magnitude of the first star
+    vector<GLint> brighterThan;   //Stars brighter than brightest + i / INDEX_STEPS_PER_MAGNITUDE
+    long starsDrawn;
+};
+
+bool convertStarCatalog(const string& csvPath, const string& binPath);
+
+#endif // __STARFIELD_H__
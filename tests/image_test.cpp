@@ -0,0 +1,71 @@
+/***
+ Round trip of image.cpp's PNG decoder against the files in tests/data
+    - Every image is 37x23 and holds the pattern of expected() below; its rows cycle through the five filter types
+      (row y uses y % 5), so each file exercises all of them
+    - stored.png, fixed.png and dynamic.png are RGB with deflate's three block types (zlib level 0, level 9 with
+      Z_FIXED, level 9); rgba.png is RGBA (four bytes per pixel for the filters) with dynamic blocks
+    - truncated.png is dynamic.png cut two thirds in, through its IDAT chunk; cut_stream.png has a well-formed IDAT
+      chunk holding only the first half of the zlib stream. Both must fail to load rather than read past the data
+ Usage: image_test <tests/data directory>; returns nonzero on a failure
+ ***/
+#include "../image.h"
+#include <iostream>
+
+static const int WIDTH = 37, HEIGHT = 23;
+
+static void expected(int x, int y, bool alpha, unsigned char* rgba) {
+    rgba[0] = (unsigned char) ((x * 7 + y * 3) & 255);
+    rgba[1] = (unsigned char) ((x * y + 11) & 255);
+    rgba[2] = (unsigned char) ((255 - x * 5 - y) & 255);
+    rgba[3] = alpha ? (unsigned char) ((x + y * 9) & 255) : 255;
+}
+
+static bool checkDecodes(const string& dir, const char* name, bool alpha) {
+    Image image;
+    if(!loadImage(dir + "/" + name, image)) {
+        cerr << name << ": failed to load" << endl;
+        return false;
+    }
+    if(image.width != WIDTH || image.height != HEIGHT || image.pixels.size() != (size_t) WIDTH * HEIGHT * 4) {
+        cerr << name << ": " << image.width << "x" << image.height << ", expected " << WIDTH << "x" << HEIGHT << endl;
+        return false;
+    }
+    for(int y = 0; y < HEIGHT; y++) {
+        for(int x = 0; x < WIDTH; x++) {
+            unsigned char want[4];
+            expected(x, y, alpha, want);
+            const unsigned char* got = &image.pixels[((size_t) y * WIDTH + x) * 4];
+            for(int c = 0; c < 4; c++) {
+                if(got[c] != want[c]) {
+                    cerr << name << ": pixel (" << x << ", " << y << ") channel " << c << " is " << (int) got[c]
+                         << ", expected " << (int) want[c] << " (row filter " << y % 5 << ")" << endl;
+                    return false;
+                }
+            }
+        }
+    }
+    cout << name << ": ok" << endl;
+    return true;
+}
+
+static bool checkFails(const string& dir, const char* name) {
+    Image image;
+    if(loadImage(dir + "/" + name, image)) {
+        cerr << name << ": loaded, but the file is damaged" << endl;
+        return false;
+    }
+    cout << name << ": rejected (ok)" << endl;
+    return true;
+}
+
+int main(int argc, const char* argv[]) {
+    string dir = argc > 1 ? argv[1] : "tests/data";
+    bool ok = true;
+    ok = checkDecodes(dir, "stored.png", false) && ok;
+    ok = checkDecodes(dir, "fixed.png", false) && ok;
+    ok = checkDecodes(dir, "dynamic.png", false) && ok;
+    ok = checkDecodes(dir, "rgba.png", true) && ok;
+    ok = checkFails(dir, "truncated.png") && ok;
+    ok = checkFails(dir, "cut_stream.png") && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+#include "text.h"
+#include "uniforms.h"
+#include <algorithm>
+#include <cmath>
+
+const int FIRST_CHAR = 32, LAST_CHAR = 126;
+const int ATLAS_COLUMNS = 16;
+
+//5x7 font for ' ' to '~': five columns per glyph, bit 0 the top row
+static const unsigned char FONT_5X7[LAST_CHAR - FIRST_CHAR + 1][TextRenderer::GLYPH_WIDTH] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14},
+    {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00},
+    {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x08,0x2A,0x1C,0x2A,0x08}, {0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02},
+    {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31},
+    {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03},
+    {0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00},
+    {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06},
+    {0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A},
+    {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41},
+    {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31},
+    {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F},
+    {0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00},
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40},
+    {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20},
+    {0x38,0x44,0x44,0x48,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E},
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00},
+    {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38},
+    {0x7C,0x14,0x14,0x14,0x08}, {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20},
+    {0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C},
+    {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00},
+    {0x00,0x00,0x7F,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}
+};
+
+void TextRenderer::init(ProgramCache& programs) {
+    //Atlas: glyph g in cell (g % ATLAS_COLUMNS, g / ATLAS_COLUMNS), rows top down
+    const int glyphCount = LAST_CHAR - FIRST_CHAR + 1;
+    const int atlasWidth = ATLAS_COLUMNS * CELL_WIDTH;
+    const int atlasHeight = (glyphCount + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS * CELL_HEIGHT;
+    vector<GLubyte> pixels(atlasWidth * atlasHeight, 0);
+    for(int g = 0; g < glyphCount; g++) {
+        int cx = g % ATLAS_COLUMNS * CELL_WIDTH, cy = g / ATLAS_COLUMNS * CELL_HEIGHT;
+        for(int col = 0; col < GLYPH_WIDTH; col++)
+            for(int row = 0; row < GLYPH_HEIGHT; row++)
+                if(FONT_5X7[g][col] & (1 << row)) pixels[(cy + row) * atlasWidth + cx + col] = 255;
+    }
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, &pixels[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &vao);  //Attributes pointed at the frame's glyphs by draw()
+    glBindVertexArray(vao);
+    for(GLuint a = 0; a < 3; a++) {
+        glEnableVertexAttribArray(a);
+        glVertexAttribDivisor(a, 1);
+    }
+    glBindVertexArray(0);
+    build = programs.request("vshader_text.glsl", "fshader_text.glsl");
+}
+
+void TextRenderer::begin(int w, int h, int s) {
+    width = w;  height = h;  scale = max(s, 1);
+    glyphs.clear();
+    rects.clear();
+    culled = 0;
+    gridColumns = (width + GRID_PIXELS - 1) / GRID_PIXELS;
+    gridRows = (height + GRID_PIXELS - 1) / GRID_PIXELS;
+    grid.resize(max(gridColumns * gridRows, 0));
+    for(size_t i = 0; i < grid.size(); i++) grid[i].clear();
+}
+
+void TextRenderer::measure(const string& text, GLfloat& w, GLfloat& h) const {
+    int columns = 0, lines = 1, column = 0;
+    for(size_t i = 0; i < text.size(); i++) {
+        if(text[i] == '\n') { lines++;  column = 0; }
+        else columns = max(columns, ++column);
+    }
+    w = (GLfloat) (columns * CELL_WIDTH * scale);
+    h = (GLfloat) (lines * CELL_HEIGHT * scale);
+}
+
+void TextRenderer::gridRange(const Rect& r, int& c0, int& r0, int& c1, int& r1) const {
+    c0 = max((int) floor(r.x0 / GRID_PIXELS), 0);  r0 = max((int) floor(r.y0 / GRID_PIXELS), 0);
+    c1 = min((int) floor(r.x1 / GRID_PIXELS), gridColumns - 1);  r1 = min((int) floor(r.y1 / GRID_PIXELS), gridRows - 1);
+}
+
+bool TextRenderer::overlaps(const Rect& r) const {
+    int c0, r0, c1, r1;
+    gridRange(r, c0, r0, c1, r1);
+    for(int row = r0; row <= r1; row++) {
+        for(int col = c0; col <= c1; col++) {
+            const vector<int>& bucket = grid[row * gridColumns + col];
+            for(size_t k = 0; k < bucket.size(); k++) {
+                const Rect& o = rects[bucket[k]];
+                if(r.x0 < o.x1 && o.x0 < r.x1 && r.y0 < o.y1 && o.y0 < r.y1) return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TextRenderer::reserve(const Rect& r) {
+    int c0, r0, c1, r1;
+    gridRange(r, c0, r0, c1, r1);
+    int index = (int) rects.size();
+    rects.push_back(r);
+    for(int row = r0; row <= r1; row++)
+        for(int col = c0; col <= c1; col++) grid[row * gridColumns + col].push_back(index);
+}
+
+bool TextRenderer::add(GLfloat x, GLfloat y, const string& text, const vec4& color, bool cull) {
+    x = floor(x);  y = floor(y);  //Whole pixels keep the glyphs sharp
+    GLfloat w, h;
+    measure(text, w, h);
+    Rect r = { x, y, x + w + scale, y + h };  //And a font pixel more of space on the right
+    if(r.x1 <= 0 || r.y1 <= 0 || r.x0 >= width || r.y0 >= height || (cull && overlaps(r))) {
+        culled++;
+        return false;
+    }
+    reserve(r);
+
+    Glyph g;
+    g.padding = 0;
+    for(int c = 0; c < 4; c++) g.color[c] = (GLubyte) (min(max(color[c], 0.0f), 1.0f) * 255 + 0.5f);
+    GLfloat penX = x, penY = y;
+    for(size_t i = 0; i < text.size(); i++) {
+        unsigned char ch = (unsigned char) text[i];
+        if(ch == '\n') { penX = x;  penY += CELL_HEIGHT * scale;  continue; }
+        if(ch != ' ') {
+            g.x = (GLshort) penX;  g.y = (GLshort) penY;
+            g.code = (GLushort) (ch >= FIRST_CHAR && ch <= LAST_CHAR ? ch - FIRST_CHAR : '?' - FIRST_CHAR);
+            glyphs.push_back(g);
+        }
+        penX += CELL_WIDTH * scale;
+    }
+    return true;
+}
+
+void TextRenderer::draw(ProgramCache& programs, DynamicBuffer& stream) {
+    if(glyphs.empty() || vao == 0) return;
+    if(program == 0) {
+        if(programs.failed(build)) return;
+        program = programs.poll(build);
+        if(program == 0) return;
+        UniformCache uniforms;
+        uniforms.reflect(program);
+        viewportLoc = uniforms.location("ViewportSize");
+        scaleLoc = uniforms.location("Scale");
+        glUseProgram(program);
+        glUniform1i(uniforms.location("Atlas"), TEXT_TEXTURE_UNIT);
+        glUniform1i(uniforms.location("AtlasColumns"), ATLAS_COLUMNS);
+    }
+    DynamicSlice slice = stream.upload(&glyphs[0], sizeof(Glyph) * glyphs.size(), 16);
+
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(program);
+    glUniform2f(viewportLoc, (GLfloat) width, (GLfloat) height);
+    glUniform1i(scaleLoc, scale);
+    glActiveTexture(GL_TEXTURE0 + TEXT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slice.buffer);
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(Glyph), BUFFER_OFFSET(slice.offset));
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(Glyph), BUFFER_OFFSET(slice.offset + 2 * sizeof(GLshort)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Glyph), BUFFER_OFFSET(slice.offset + 4 * sizeof(GLshort)));
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) glyphs.size());
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    if(depthTest) glEnable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
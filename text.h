@@ -0,0 +1,72 @@
+#ifndef __TEXT_H__
+#define __TEXT_H__
+
+#include "Angel-yjc.h"
+#include "dynamicbuffer.h"
+#include "programcache.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/***
+ Screen text from a glyph atlas, drawn in one call per frame
+    - The font is a 5x7 pixel bitmap of printable ASCII compiled into text.cpp. init() bakes it once into a small
+      single-channel atlas texture, one CELL_WIDTH x CELL_HEIGHT cell per glyph (the glyph and a pixel of spacing on
+      the right and below)
+    - Between begin() and draw(), add() lays out a block of text (lines split at '\n') at a pixel position from the top
+      left: one 12-byte instance per character, appended to the frame's list. draw() copies them into a slice of the
+      dynamic buffer (dynamicbuffer.h) and draws every glyph quad with one glDrawArraysInstanced
+    - add() first tests the block's rectangle against those already placed this frame (a grid of GRID_PIXELS buckets
+      keeps that to the few nearby), and drops it if they overlap or it is entirely off screen; add in order of
+      importance. Blocks added with cull = false are always drawn, and still keep later ones off them
+    - Glyphs are drawn at an integer scale with a one pixel dark shadow (fshader_text.glsl), so they stay sharp and
+      readable on any background
+    - The program builds in the background (programcache.h); nothing is drawn until it is ready
+ ***/
+class TextRenderer {
+public:
+    static const int GLYPH_WIDTH = 5, GLYPH_HEIGHT = 7;
+    static const int CELL_WIDTH = 6, CELL_HEIGHT = 8;  //Advance and line spacing
+    static const int GRID_PIXELS = 32;
+
+    TextRenderer() : build(-1), program(0), vao(0), atlas(0), viewportLoc(-1), scaleLoc(-1), width(0), height(0),
+                     scale(1), gridColumns(0), gridRows(0), culled(0) {}
+
+    void init(ProgramCache& programs);  //Call with a current context
+    void begin(int width, int height, int scale);  //Starts a frame's text on a window of that size
+    bool add(GLfloat x, GLfloat y, const string& text, const vec4& color, bool cull = true);  //False if culled
+    void draw(ProgramCache& programs, DynamicBuffer& stream);
+
+    void measure(const string& text, GLfloat& w, GLfloat& h) const;  //Size of a block in pixels at the frame's scale
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getScale() const { return scale; }
+    size_t size() const { return glyphs.size(); }  //Glyphs this frame
+    long getCulled() const { return culled; }        //Blocks dropped this frame
+
+private:
+    struct Glyph {  //Per-instance attributes of vshader_text.glsl
+        GLshort x, y;      //Top left corner (pixels)
+        GLushort code;     //Character, indexing the atlas
+        GLushort padding;
+        GLubyte color[4];
+    };
+    struct Rect { GLfloat x0, y0, x1, y1; };
+
+    bool overlaps(const Rect& r) const;
+    void reserve(const Rect& r);
+    void gridRange(const Rect& r, int& c0, int& r0, int& c1, int& r1) const;
+
+    int build;  //ProgramCache handle
+    GLuint program, vao, atlas;
+    GLint viewportLoc, scaleLoc;
+    int width, height, scale;
+    vector<Glyph> glyphs;
+    vector<Rect> rects;           //Placed this frame
+    vector<vector<int> > grid;    //Rects touching each bucket
+    int gridColumns, gridRows;
+    long culled;
+};
+
+#endif // __TEXT_H__
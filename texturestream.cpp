@@ -0,0 +1,254 @@
+#include "texturestream.h"
+#include "glcaps.h"
+#include "threadpool.h"
+#include "uniforms.h"
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <sys/stat.h>
+
+TextureStreamer::TextureStreamer() : compressed(false), residentBytes(0), streamedBytes(0), decodedBytes(0), decodes(0),
+                                     cancelled(false), decoders(NULL) {}
+
+TextureStreamer::~TextureStreamer() {
+    cancelled = true;
+    delete decoders;  //Joins the threads once the running decodes return
+}
+
+int TextureStreamer::init(const string& dir, const BodyStore& bodies, bool compress) {
+    slotOfBody.assign(bodies.size(), -1);
+    for(size_t i = 0; i < bodies.size(); i++) {
+        if(bodies.flags[i] & BODY_POINT) continue;
+        string name = bodies.names[i];
+        for(size_t k = 0; k < name.size(); k++) name[k] = (char) tolower(name[k]);
+        const char* extensions[2] = { ".png", ".ppm" };
+        for(int e = 0; e < 2; e++) {
+            string path = dir + "/" + name + extensions[e];
+            struct stat st;
+            if(stat(path.c_str(), &st) != 0) continue;
+            Streamed s;
+            s.body = (int) i;
+            s.path = path;
+            s.tail = s.held = 0;
+            s.decoding = false;  s.decodable = true;
+            s.texture = s.pending = 0;
+            s.base = s.pendingBase = s.uploadLevel = s.uploadRow = 0;
+            slotOfBody[i] = (int) textures.size();
+            textures.push_back(s);
+            break;
+        }
+    }
+    if(textures.empty()) return 0;
+
+    compressed = compress;
+    if(compress && !hasGLExtension("GL_EXT_texture_compression_s3tc")) {
+        cerr << "Textures: the driver has no BC1 (S3TC) support, uploading them uncompressed" << endl;
+        compressed = false;
+    }
+    //Two threads keep decoding off the cores the frame needs; each decode is a long serial inflate anyway
+    decoders = new ThreadPool(2);
+    for(size_t k = 0; k < textures.size(); k++) queueDecode((int) k);
+    return (int) textures.size();
+}
+
+void TextureStreamer::queueDecode(int slot) {
+    textures[slot].decoding = true;
+    string path = textures[slot].path;
+    bool bc1 = compressed;
+    decoders->enqueue([this, slot, path, bc1] {
+        if(cancelled) return;
+        Decoded d;
+        d.slot = slot;
+        decode(path, bc1, d);
+        lock_guard<mutex> lock(mtx);
+        finished.push_back(d);
+    });
+}
+
+//Decoder thread: the whole chain, finest first, down to 1x1
+void TextureStreamer::decode(const string& path, bool compress, Decoded& out) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Image image;
+    out.ok = loadImage(path, image);
+    while(out.ok) {
+        out.levels.push_back(Level());
+        Level& level = out.levels.back();
+        level.width = image.width;  level.height = image.height;
+        if(compress) compressBC1(image, level.data);
+        else level.data = image.pixels;
+        if(image.width == 1 && image.height == 1) break;
+        Image half;
+        halveImage(image, half);
+        image.pixels.swap(half.pixels);
+        image.width = half.width;  image.height = half.height;
+    }
+    out.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+size_t TextureStreamer::levelBytes(const Level& level) const {
+    return compressed ? bc1Size(level.width, level.height) : (size_t) level.width * level.height * 4;
+}
+
+size_t TextureStreamer::textureBytes(const Streamed& s, int base) const {
+    size_t bytes = 0;
+    for(size_t l = base; l < s.levels.size(); l++) bytes += levelBytes(s.levels[l]);
+    return bytes;
+}
+
+GLuint TextureStreamer::texture(int body) const {
+    int slot = body < (int) slotOfBody.size() ? slotOfBody[body] : -1;
+    return slot < 0 ? 0 : textures[slot].texture;
+}
+
+//Coarsest level with at least pi texels per pixel of diameter; pixels <= 0 means off screen
+int TextureStreamer::wantedLevel(const Streamed& s, double pixels) const {
+    if(pixels <= 0) return s.tail;
+    double need = M_PI * pixels;
+    int level = s.tail;
+    while(level > 0 && s.levels[level].width < need) level--;
+    return level;
+}
+
+//Allocates a texture for levels[base..] (undefined contents) and starts filling it from the coarsest level
+void TextureStreamer::startPending(Streamed& s, int base) {
+    int count = (int) s.levels.size() - base;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);  //A NULL pointer would otherwise mean offset 0 into the buffer
+    glGenTextures(1, &s.pending);
+    glBindTexture(GL_TEXTURE_2D, s.pending);
+    for(int l = 0; l < count; l++) {
+        const Level& level = s.levels[base + l];
+        if(compressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, l, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0,
+                                   (GLsizei) bc1Size(level.width, level.height), NULL);
+        else
+            glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);  //Longitude wraps, latitude stops at the poles
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    s.pendingBase = base;
+    s.uploadLevel = (int) s.levels.size() - 1;
+    s.uploadRow = 0;
+    residentBytes += textureBytes(s, base);
+}
+
+void TextureStreamer::dropPending(Streamed& s) {
+    glDeleteTextures(1, &s.pending);
+    s.pending = 0;
+    residentBytes -= textureBytes(s, s.pendingBase);
+}
+
+//Uploads row bands of the pending texture, coarsest level first, until it is complete or the budget runs out
+bool TextureStreamer::uploadBands(DynamicBuffer& stream, Streamed& s, size_t& budget) {
+    glBindTexture(GL_TEXTURE_2D, s.pending);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    while(s.uploadLevel >= s.pendingBase) {
+        const Level& level = s.levels[s.uploadLevel];
+        //Bands are whole rows, or whole rows of 4x4 blocks
+        int rowsPerUnit = compressed ? 4 : 1;
+        size_t unitBytes = compressed ? (size_t) ((level.width + 3) / 4) * 8 : (size_t) level.width * 4;
+        int unitsLeft = (level.height - s.uploadRow + rowsPerUnit - 1) / rowsPerUnit;
+        int units = (int) min((size_t) unitsLeft, budget / unitBytes);
+        if(units == 0) return false;  //Next frame
+
+        int rows = min(units * rowsPerUnit, level.height - s.uploadRow);
+        size_t bytes = units * unitBytes;
+        const unsigned char* src = &level.data[(s.uploadRow / rowsPerUnit) * unitBytes];
+        const GLvoid* pixels = src;
+        if(stream.isPersistent()) {  //The GL reads the band from this frame's slice, after update() returns
+            DynamicSlice slice = stream.upload(src, bytes, 16);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slice.buffer);
+            pixels = BUFFER_OFFSET(slice.offset);
+        }
+        int glLevel = s.uploadLevel - s.pendingBase;
+        if(compressed)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, glLevel, 0, s.uploadRow, level.width, rows,
+                                      GL_COMPRESSED_RGB_S3TC_DXT1_EXT, (GLsizei) bytes, pixels);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, glLevel, 0, s.uploadRow, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        budget -= bytes;
+        streamedBytes += bytes;
+        s.uploadRow += rows;
+        if(s.uploadRow == level.height) { s.uploadLevel--;  s.uploadRow = 0; }
+    }
+    return true;
+}
+
+void TextureStreamer::update(DynamicBuffer& stream, const BodyStore& bodies, const vector<int>& visible, GLfloat pixelsPerRadian) {
+    if(textures.empty()) return;
+
+    //Finished decodes; only their tails are uploaded at first
+    vector<Decoded> done;
+    {
+        lock_guard<mutex> lock(mtx);
+        done.swap(finished);
+    }
+    for(size_t k = 0; k < done.size(); k++) {
+        Streamed& s = textures[done[k].slot];
+        s.decoding = false;
+        if(!done[k].ok) { s.decodable = false;  continue; }  //loadImage() said why; make do with the levels held
+        decodes++;
+        //A repeat decode brings back the finer levels; the coarser ones are the same, so uploads in progress carry on
+        bool repeat = !s.levels.empty();
+        for(size_t l = s.held; l < s.levels.size(); l++) decodedBytes -= s.levels[l].data.size();
+        s.levels.swap(done[k].levels);
+        s.held = 0;
+        for(size_t l = 0; l < s.levels.size(); l++) decodedBytes += s.levels[l].data.size();
+        if(repeat) continue;
+        s.tail = 0;
+        while(s.tail + 1 < (int) s.levels.size() && s.levels[s.tail].width > TAIL_WIDTH) s.tail++;
+        s.base = (int) s.levels.size();
+        cout << "Decoded " << s.path << " (" << s.levels[0].width << "x" << s.levels[0].height << ", "
+             << s.levels.size() << " levels" << (compressed ? ", BC1" : "") << ") in " << done[k].milliseconds << " ms" << endl;
+    }
+
+    //Size on screen of every visible textured body
+    pixelSize.assign(textures.size(), 0.0);
+    for(size_t k = 0; k < visible.size(); k++) {
+        int slot = visible[k] < (int) slotOfBody.size() ? slotOfBody[visible[k]] : -1;
+        if(slot < 0) continue;
+        double dist = length(bodies.relPos[visible[k]]), r = bodies.renderRadius[visible[k]];
+        pixelSize[slot] = dist > r ? 2 * asin(r / dist) * pixelsPerRadian : 1e9;
+    }
+
+    size_t budget = STREAM_BYTES_PER_FRAME;
+    for(size_t k = 0; k < textures.size(); k++) {
+        Streamed& s = textures[k];
+        if(s.levels.empty()) continue;
+        int need = wantedLevel(s, pixelSize[k]);
+        if(need < s.held) {  //Freed since: decode the file again, and go as fine as the levels held allow meanwhile
+            if(!s.decoding && s.decodable) queueDecode((int) k);
+            need = s.held;
+        }
+        int wanted = s.texture == 0 ? s.tail : need;  //Coarse first
+        if(s.pending != 0 && s.pendingBase != wanted && (wanted < s.pendingBase || wanted >= s.base))
+            dropPending(s);  //Wants more than the texture being filled, or no longer needs it
+        if(s.pending == 0 && (wanted < s.base || wanted >= s.base + 2)) startPending(s, wanted);
+
+        //Free the levels finer than everything the body draws with, is filling, or wants
+        int keep = min(need, s.base);
+        if(s.pending != 0) keep = min(keep, s.pendingBase);
+        for(; s.held < keep; s.held++) {
+            decodedBytes -= s.levels[s.held].data.size();
+            vector<unsigned char>().swap(s.levels[s.held].data);
+        }
+    }
+    glActiveTexture(GL_TEXTURE0 + SURFACE_TEXTURE_UNIT);
+    for(int pass = 0; pass < 2; pass++) {  //Textures with nothing resident go first
+        for(size_t k = 0; k < textures.size() && budget > 0; k++) {
+            Streamed& s = textures[k];
+            if(s.pending == 0 || (pass == 0) != (s.texture == 0)) continue;
+            if(!uploadBands(stream, s, budget)) continue;
+            if(s.texture != 0) {
+                glDeleteTextures(1, &s.texture);
+                residentBytes -= textureBytes(s, s.base);
+            }
+            s.texture = s.pending;
+            s.base = s.pendingBase;
+            s.pending = 0;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
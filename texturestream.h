@@ -0,0 +1,107 @@
+#ifndef __TEXTURESTREAM_H__
+#define __TEXTURESTREAM_H__
+
+#include "Angel-yjc.h"
+#include "bodystore.h"
+#include "dynamicbuffer.h"
+#include "image.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class ThreadPool;
+
+/***
+ Planet textures streamed in the background, with GPU memory following what is on screen
+    - init() looks for <dir>/<body name in lower case>.png (or .ppm) for every sphere body and queues it on a small
+      pool of decoder threads of its own (the frame's worker pool can't be shared: its parallelFor() waits for every
+      queued task, decodes included)
+    - A decoder thread builds the whole mip chain on the CPU (image.h) and, with compression on, encodes every level
+      as BC1. Only the levels a body's textures (resident or filling) and its wanted level are made of stay in memory;
+      finer ones are freed, and the file is decoded again when the body wants them back (drawn with what it has until
+      then), so CPU memory follows the screen too
+    - update() runs once per frame. Each visible body wants the coarsest level that still has about pi texels per
+      pixel of its diameter on screen (an equirectangular map wraps the whole circumference); bodies off screen want
+      only the tail, the levels no wider than TAIL_WIDTH
+    - A body changing level gets a new texture holding the wanted level and every coarser one, filled coarsest first in
+      row bands, at most STREAM_BYTES_PER_FRAME per frame over all bodies; it keeps drawing with its old texture until
+      the new one is complete. Growing happens at once, shrinking only once the wanted level is two levels coarser
+    - Right after a decode only the tail is uploaded, so textures come in coarse first; until then a body is drawn
+      untextured, and startup never waits for an image
+    - Bands are copied into slices of the frame's persistently mapped dynamic buffer (dynamicbuffer.h) and uploaded from
+      there as a pixel unpack buffer; without ARB_buffer_storage they go through plain glTexSubImage2D from the decoded
+      levels, which saves staging them twice
+ ***/
+class TextureStreamer {
+public:
+    static const size_t STREAM_BYTES_PER_FRAME = 4 << 20;
+    static const int TAIL_WIDTH = 64;
+
+    TextureStreamer();
+    ~TextureStreamer();  //Drops the decodes that haven't started and waits for the rest
+
+    //Call with a current context; returns the number of textures found (and queued for decoding)
+    int init(const string& dir, const BodyStore& bodies, bool compress);
+    void update(DynamicBuffer& stream, const BodyStore& bodies, const vector<int>& visible, GLfloat pixelsPerRadian);
+    GLuint texture(int body) const;  //0 until the body's tail is resident
+
+    int getTextureCount() const { return (int) textures.size(); }
+    size_t getResidentBytes() const { return residentBytes; }  //GPU memory held by textures, including ones still filling
+    size_t getStreamedBytes() const { return streamedBytes; }  //Uploaded since init()
+    size_t getDecodedBytes() const { return decodedBytes; }    //CPU memory held by decoded levels
+    long getDecodes() const { return decodes; }                //Finished decodes, including repeats
+
+private:
+    struct Level {
+        int width, height;
+        vector<unsigned char> data;  //RGBA8, or BC1 blocks
+    };
+
+    struct Decoded {  //Handed from a decoder thread to update()
+        int slot;
+        bool ok;
+        double milliseconds;
+        vector<Level> levels;
+    };
+
+    struct Streamed {
+        int body;
+        string path;
+        vector<Level> levels;  //Finest first; empty until decoded
+        int held;  //Finest level whose data is in memory; coarser ones all are
+        bool decoding, decodable;  //A decode is queued or running; the last one didn't fail
+        int tail;  //Coarsest level update() ever drops to
+        GLuint texture;  //Holds levels[base..]
+        int base;        //levels.size() while nothing is resident
+        GLuint pending;  //Texture being filled with levels[pendingBase..], 0 if none
+        int pendingBase, uploadLevel, uploadRow;  //Next band to upload
+    };
+
+    void queueDecode(int slot);
+    static void decode(const string& path, bool compress, Decoded& out);
+    size_t levelBytes(const Level& level) const;
+    size_t textureBytes(const Streamed& s, int base) const;
+    int wantedLevel(const Streamed& s, double pixels) const;
+    void startPending(Streamed& s, int base);
+    void dropPending(Streamed& s);
+    bool uploadBands(DynamicBuffer& stream, Streamed& s, size_t& budget);  //True once the pending texture is complete
+
+    vector<Streamed> textures;
+    vector<int> slotOfBody;  //-1 for bodies without a texture
+    vector<char> onScreen;   //Scratch for update()
+    vector<double> pixelSize;
+    bool compressed;
+    size_t residentBytes, streamedBytes, decodedBytes;
+    long decodes;
+
+    //Decoder threads
+    mutex mtx;
+    vector<Decoded> finished;
+    atomic<bool> cancelled;
+    ThreadPool* decoders;
+};
+
+#endif // __TEXTURESTREAM_H__
@@ -0,0 +1,91 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/***
+ Fixed-size pool of worker threads
+    - enqueue() hands a task to the next idle worker
+    - wait() blocks until every queued task has finished
+    - parallelFor() splits [0, n) into contiguous chunks, one task per chunk, and waits for them
+ ***/
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned numThreads = 0) : active(0), stopping(false) {
+        if(numThreads == 0) numThreads = std::thread::hardware_concurrency();
+        if(numThreads == 0) numThreads = 1;
+        for(unsigned i = 0; i < numThreads; i++) { workers.push_back(std::thread(&ThreadPool::workerLoop, this)); }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for(size_t i = 0; i < workers.size(); i++) { workers[i].join(); }
+    }
+
+    unsigned size() const { return (unsigned) workers.size(); }
+
+    void enqueue(const std::function<void()>& task) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.push(task);
+        }
+        taskReady.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        allDone.wait(lock, [this] { return tasks.empty() && active == 0; });
+    }
+
+    //fn(begin, end) is called once per chunk; chunks never overlap
+    void parallelFor(size_t n, const std::function<void(size_t, size_t)>& fn, size_t numChunks = 0) {
+        if(n == 0) return;
+        if(numChunks == 0) numChunks = workers.size() * 4;
+        if(numChunks > n) numChunks = n;
+        size_t chunk = (n + numChunks - 1) / numChunks;
+        for(size_t begin = 0; begin < n; begin += chunk) {
+            size_t end = (begin + chunk < n) ? begin + chunk : n;
+            enqueue([&fn, begin, end] { fn(begin, end); });
+        }
+        wait();
+    }
+
+private:
+    void workerLoop() {
+        for(;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if(stopping && tasks.empty()) return;
+                task = tasks.front();
+                tasks.pop();
+                active++;
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                active--;
+                if(tasks.empty() && active == 0) allDone.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()> > tasks;
+    std::mutex mtx;
+    std::condition_variable taskReady, allDone;
+    unsigned active;
+    bool stopping;
+};
+
+#endif // __THREADPOOL_H__
@@ -0,0 +1,97 @@
+#include "trails.h"
+
+int OrbitTrails::init(ProgramCache& programs, const BodyStore& bodies, int samples) {
+    length = samples;
+    if(length < 2) return 0;
+    for(size_t i = 0; i < bodies.size(); i++)
+        if(!(bodies.flags[i] & BODY_POINT) && bodies.elements[i].period > 0) slotBody.push_back((int) i);
+    if(slotBody.empty()) return 0;
+
+    //Every position row starts out unused; the color row is written once here, the offsets every draw()
+    size_t slots = slotBody.size();
+    vector<vec4> initial((length + 1) * slots + length, vec4(0.0, 0.0, 0.0, 1.0));
+    for(size_t s = 0; s < slots; s++) initial[length * slots + s] = bodies.colors[slotBody[s]];
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4) * initial.size(), &initial[0], GL_STATIC_DRAW);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenVertexArrays(1, &vao);  //No attributes: everything comes from gl_VertexID
+
+    row.resize(slots);
+    rowEye.resize(length);
+    offsets.resize(length);
+    firsts.resize(slots);
+    counts.resize(slots);
+    build = programs.request("vshader_trails.glsl", "fshader_trails.glsl");
+    return (int) slots;
+}
+
+bool OrbitTrails::ready(ProgramCache& programs) {
+    if(program != 0) return true;
+    if(programs.failed(build)) return false;
+    program = programs.poll(build);
+    if(program == 0) return false;
+    uniforms.reflect(program);
+    uniforms.bindBlock("Camera", CAMERA_BINDING);
+    uniforms.bindBlock("Light", LIGHT_BINDING);
+    glUseProgram(program);
+    glUniform1i(uniforms.location("Samples"), TRAIL_TEXTURE_UNIT);
+    glUniform1i(uniforms.location("Slots"), (GLint) slotBody.size());
+    glUniform1i(uniforms.location("Length"), length);
+    return true;
+}
+
+void OrbitTrails::append(DynamicBuffer& stream, const BodyStore& bodies, const dvec3& eye, double time) {
+    if(slotBody.empty() || (valid > 0 && time == lastTime)) return;  //Redrawn without moving on
+    lastTime = time;
+    for(size_t s = 0; s < slotBody.size(); s++) row[s] = vec4(bodies.relPos[slotBody[s]], 1.0);
+    head = (head + 1) % length;
+    rowEye[head] = eye;
+    valid = min(valid + 1, length);
+    DynamicSlice slice = stream.upload(&row[0], sizeof(vec4) * row.size(), 16);
+    glBindBuffer(GL_COPY_READ_BUFFER, slice.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slice.offset, sizeof(vec4) * row.size() * head, slice.size);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void OrbitTrails::draw(ProgramCache& programs, DynamicBuffer& stream, const dvec3& eye) {
+    if(valid < 2 || !ready(programs)) return;
+    //Vertex k of slot s is gl_VertexID s * length + k; the last `valid` of them, newest last
+    for(size_t s = 0; s < slotBody.size(); s++) {
+        firsts[s] = (GLint) (s * length + length - valid);
+        counts[s] = valid;
+    }
+
+    //Each row's positions are relative to the eye it was appended with; move them to this one in double
+    for(int k = 0; k < valid; k++) {
+        int r = (head - k + length) % length;
+        dvec3 d = rowEye[r] - eye;
+        offsets[r] = vec4((GLfloat) d.x, (GLfloat) d.y, (GLfloat) d.z, 0.0);
+    }
+    size_t offsetStart = sizeof(vec4) * (length + 1) * slotBody.size();
+    DynamicSlice slice = stream.upload(&offsets[0], sizeof(vec4) * offsets.size(), 16);
+    glBindBuffer(GL_COPY_READ_BUFFER, slice.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slice.offset, offsetStart, slice.size);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    glUseProgram(program);
+    glUniform1i(uniforms.location("Head"), head);
+    glActiveTexture(GL_TEXTURE0 + TRAIL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glBindVertexArray(vao);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glMultiDrawArrays(GL_LINE_STRIP, &firsts[0], &counts[0], (GLsizei) slotBody.size());
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,61 @@
+#ifndef __TRAILS_H__
+#define __TRAILS_H__
+
+#include "bodystore.h"
+#include "dynamicbuffer.h"
+#include "programcache.h"
+#include "uniforms.h"
+#include <vector>
+
+using namespace std;
+
+/***
+ Orbit trails: a fading line behind every orbiting sphere body along its recent path
+    - One GPU buffer is a ring of `length` rows, with one position per trailed body in each row; each body owns the
+      same slot (column) in every row. A row of the slots' colors follows, then one offset per ring row. Its size is
+      fixed at init(), however long the simulation runs
+    - append() adds this frame's row: the camera-relative positions of the floating origin (BodyStore::relPos) go into
+      a slice of the dynamic buffer (dynamicbuffer.h) and one glCopyBufferSubData moves the whole row into the ring,
+      overwriting the oldest. The eye the row is relative to is kept in double on the CPU
+    - draw() uploads each row's offset to the current eye (row eye - eye, subtracted in double) and issues one
+      glMultiDrawArrays of line strips, one per slot. No vertex attributes: the vertex shader (vshader_trails.glsl)
+      works out the slot and the sample's age from gl_VertexID, fetches the position and its row's offset through a
+      buffer texture, and fades it out with age. Near the camera both are small, so trails hold still in close-ups of
+      bodies far from the Sun
+    - Point bodies (minor planets) and bodies that don't move (the Sun) have no trail
+    - A trail grows by one sample per frame with a new simulation time, so it covers `length` frames of motion
+ ***/
+class OrbitTrails {
+public:
+    static const int DEFAULT_LENGTH = 256;  //Samples per trail
+
+    OrbitTrails() : length(0), head(-1), valid(0), lastTime(0), build(-1), program(0), buffer(0), texture(0), vao(0) {}
+
+    int init(ProgramCache& programs, const BodyStore& bodies, int length);  //Call with a current context; returns the slots
+    void clear() { valid = 0; }  //Forget every trail (they regrow from the next append())
+    void append(DynamicBuffer& stream, const BodyStore& bodies, const dvec3& eye, double time);  //After cameraRelative()
+    void draw(ProgramCache& programs, DynamicBuffer& stream, const dvec3& eye);
+
+    size_t size() const { return slotBody.size(); }
+
+private:
+    bool ready(ProgramCache& programs);
+
+    int length;
+    int head;   //Row appended last
+    int valid;  //Rows appended since the last clear(), up to length
+    double lastTime;
+    vector<int> slotBody;
+    vector<vec4> row;  //Staging for one row
+    vector<dvec3> rowEye;   //Eye each ring row's positions are relative to
+    vector<vec4> offsets;   //Staging for the rows' offsets to the current eye
+    vector<GLint> firsts;
+    vector<GLsizei> counts;
+
+    int build;  //ProgramCache handle
+    GLuint program;
+    UniformCache uniforms;
+    GLuint buffer, texture, vao;
+};
+
+#endif // __TRAILS_H__
@@ -0,0 +1,47 @@
+#include "uniforms.h"
+#include <vector>
+
+void UniformCache::reflect(GLuint prog) {
+    program = prog;
+    locations.clear();
+    blocks.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> name(maxLength + 1);
+    for(GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(prog, i, (GLsizei) name.size(), NULL, &size, &type, &name[0]);
+        GLint loc = glGetUniformLocation(prog, &name[0]);
+        if(loc < 0) continue;  //Block members have no location
+        string key(&name[0]);
+        if(key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0) key.resize(key.size() - 3);  //Arrays are listed as "name[0]"
+        locations[key] = loc;
+    }
+
+    count = 0;  maxLength = 0;
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    name.resize(maxLength + 1);
+    for(GLint i = 0; i < count; i++) {
+        glGetActiveUniformBlockName(prog, i, (GLsizei) name.size(), NULL, &name[0]);
+        blocks[string(&name[0])] = (GLuint) i;
+    }
+}
+
+GLint UniformCache::location(const string& name) const {
+    map<string, GLint>::const_iterator it = locations.find(name);
+    return it == locations.end() ? -1 : it->second;
+}
+
+GLuint UniformCache::blockIndex(const string& name) const {
+    map<string, GLuint>::const_iterator it = blocks.find(name);
+    return it == blocks.end() ? GL_INVALID_INDEX : it->second;
+}
+
+void UniformCache::bindBlock(const string& name, GLuint binding) const {
+    GLuint index = blockIndex(name);
+    if(index != GL_INVALID_INDEX) glUniformBlockBinding(program, index, binding);
+}
@@ -0,0 +1,80 @@
+#ifndef __UNIFORMS_H__
+#define __UNIFORMS_H__
+
+#include "Angel-yjc.h"
+#include <map>
+#include <string>
+
+using namespace std;
+
+/***
+ Shader uniform state
+    - UniformCache reflects a linked program once (right after it is built) and answers location/block lookups from a
+      map, so nothing calls glGetUniformLocation per draw
+    - Camera and light data live in std140 uniform blocks filled once per frame; per-object data is one ObjectUniforms
+      record per body in a single buffer, selected with glBindBufferRange (one offset per draw)
+    - The blocks are declared row_major in the shaders, so Angel's row-major mat4 is copied as is
+    - The structs below mirror the std140 layout of the blocks in vshader.glsl and must be kept in sync with it
+ ***/
+
+enum UniformBinding { CAMERA_BINDING = 0, LIGHT_BINDING = 1, OBJECT_BINDING = 2, SHADOW_BINDING = 3, CASTER_BINDING = 4 };
+enum StorageBinding { OBJECT_STORAGE_BINDING = 0 };  //Shader storage blocks (multidraw.h)
+enum TextureUnit { SHADOW_TEXTURE_UNIT = 0, SURFACE_TEXTURE_UNIT = 1, TRAIL_TEXTURE_UNIT = 2, TEXT_TEXTURE_UNIT = 3,
+                   UPSCALE_TEXTURE_UNIT = 4 };
+enum { MAX_SHADOW_CASTERS = 256 };  //Casters per shadow pass draw; MAX_CASTERS in vshader_shadow.glsl
+
+struct CameraUniforms {  //uniform Camera
+    mat4 projection;
+    mat4 view;
+};
+
+struct LightUniforms {  //uniform Light
+    vec4 position;  //Eye frame
+    GLfloat shininess, constAtt, linearAtt, quadAtt;
+};
+
+struct ShadowUniforms {  //uniform Shadow (fshader.glsl, gshader_shadow.glsl)
+    mat4 faceMatrix[6];  //Light-relative world position to the clip space of each shadow map layer
+    GLint activeFaces;   //Bit per layer rendered this frame
+    GLint pad[3];
+
+    ShadowUniforms() : activeFaces(0) {  //All zero: no layer rendered
+        for(int f = 0; f < 6; f++) faceMatrix[f] = mat4(0.0);
+        pad[0] = pad[1] = pad[2] = 0;
+    }
+};
+
+struct CasterUniforms {  //uniform Casters (vshader_shadow.glsl)
+    vec4 sphere[MAX_SHADOW_CASTERS];  //Light-relative center, radius
+    GLint mask[MAX_SHADOW_CASTERS];   //Layers to draw each caster into; std140 ivec4 array, so packed four to an element
+};
+
+struct ObjectUniforms {  //uniform Object, and the std430 ObjectData array of vshader_mdi.glsl
+    mat4 modelView;
+    GLfloat normalMatrix[3][4];  //std140 mat3: three rows, each padded to a vec4
+    vec4 ambient, diffuse, specular;  //Material products
+    GLint textured;  //Multiply by the body's surface map (texturestream.h)
+    GLint pad[3];
+
+    void setNormalMatrix(const mat3& m) {
+        for(int r = 0; r < 3; r++) { for(int c = 0; c < 3; c++) normalMatrix[r][c] = m[r][c];  normalMatrix[r][3] = 0; }
+    }
+};
+
+class UniformCache {
+public:
+    UniformCache() : program(0) {}
+
+    void reflect(GLuint program);  //Records every active uniform and uniform block of a linked program
+
+    GLint location(const string& name) const;      //-1 if the uniform isn't active
+    GLuint blockIndex(const string& name) const;   //GL_INVALID_INDEX if the block isn't active
+    void bindBlock(const string& name, GLuint binding) const;  //No-op for inactive blocks
+
+private:
+    GLuint program;
+    map<string, GLint> locations;
+    map<string, GLuint> blocks;
+};
+
+#endif // __UNIFORMS_H__
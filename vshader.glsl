@@ -0,0 +1,33 @@
+/***************************
+ * File: vshader.glsl:
+ *   Per-vertex point-light shading (the Sun is the light source)
+ ****************************/
+
+#version 330
+
+layout(location = 0) in vec4 vPosition;  // ATTRIB_POSITION in mesh.h
+layout(location = 1) in vec3 vNormal;    // ATTRIB_NORMAL
+layout(location = 2) in vec2 vTexCoord;  // ATTRIB_TEXCOORD
+out vec4 ambientColor;
+out vec4 directColor;     // Darkened by the shadow map in fshader.glsl
+out vec3 lightToVertex;
+out vec2 texCoord;
+flat out int textured;
+
+#include "lighting.glsl"
+
+layout(std140, row_major) uniform Object {  // One record per body, selected by offset
+    mat4 model_view;
+    mat3 normal_matrix;
+    vec4 AmbientProduct, DiffuseProduct, SpecularProduct;
+    int Textured;
+};
+
+void main()
+{
+    gl_Position = projection * model_view * vPosition;
+    shade(vPosition, vNormal, model_view, normal_matrix, AmbientProduct, DiffuseProduct, SpecularProduct,
+          ambientColor, directColor, lightToVertex);
+    texCoord = vTexCoord;
+    textured = Textured;
+}
@@ -0,0 +1,38 @@
+/***************************
+ * File: vshader_impostor.glsl:
+ *   Impostors (impostors.h): one camera-facing quad per instance, made
+ *   from gl_VertexID, just covering the silhouette of the instance's
+ *   sphere; fshader_impostor.glsl ray-casts the sphere inside it
+ ****************************/
+
+#version 330
+
+layout(location = 0) in vec4 iSphere;    // Eye-space center, radius; one per instance
+layout(location = 1) in vec4 iAmbient;   // Material products, as in the Object block of vshader.glsl
+layout(location = 2) in vec4 iDiffuse;
+layout(location = 3) in vec4 iSpecular;
+out vec2 quadCoord;        // On the quad, in sphere radii from the center
+flat out vec4 sphere;
+flat out mat3 basis;       // Quad axes and the direction away from the camera, in eye space
+flat out vec4 ambientProduct, diffuseProduct, specularProduct;
+
+#include "lighting.glsl"
+
+void main()
+{
+    vec3 w = normalize(iSphere.xyz);
+    vec3 u = normalize(cross(abs(w.y) < 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), w));
+    vec3 v = cross(w, u);
+    // Through the center and square to the line of sight, the cone of rays grazing the sphere is d/sqrt(d*d - r*r)
+    // radii across
+    float d = length(iSphere.xyz) / iSphere.w;
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    quadCoord = corner * (d / sqrt(d * d - 1.0));
+    gl_Position = projection * vec4(iSphere.xyz + (quadCoord.x * u + quadCoord.y * v) * iSphere.w, 1.0);
+
+    sphere = iSphere;
+    basis = mat3(u, v, w);
+    ambientProduct = iAmbient;
+    diffuseProduct = iDiffuse;
+    specularProduct = iSpecular;
+}
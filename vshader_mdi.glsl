@@ -0,0 +1,41 @@
+/***************************
+ * File: vshader_mdi.glsl:
+ *   vshader.glsl for the multi-draw-indirect path (multidraw.h): the
+ *   per-object data comes from a storage buffer indexed by draw id
+ ****************************/
+
+#version 430
+#extension GL_ARB_shader_draw_parameters : require
+
+layout(location = 0) in vec4 vPosition;  // ATTRIB_POSITION in mesh.h
+layout(location = 1) in vec3 vNormal;    // ATTRIB_NORMAL
+layout(location = 2) in vec2 vTexCoord;  // ATTRIB_TEXCOORD
+out vec4 ambientColor;
+out vec4 directColor;     // Darkened by the shadow map in fshader.glsl
+out vec3 lightToVertex;
+out vec2 texCoord;
+flat out int textured;
+
+#include "lighting.glsl"
+
+struct ObjectData {  // Same layout as the Object block of vshader.glsl
+    mat4 model_view;
+    mat3 normal_matrix;
+    vec4 AmbientProduct, DiffuseProduct, SpecularProduct;
+    int Textured;
+};
+
+layout(std430, row_major, binding = 0) readonly buffer Objects {  // OBJECT_STORAGE_BINDING; one record per draw
+    ObjectData objects[];
+};
+
+void main()
+{
+    ObjectData obj = objects[gl_DrawIDARB];
+    gl_Position = projection * obj.model_view * vPosition;
+    shade(vPosition, vNormal, obj.model_view, obj.normal_matrix,
+          obj.AmbientProduct, obj.DiffuseProduct, obj.SpecularProduct,
+          ambientColor, directColor, lightToVertex);
+    texCoord = vTexCoord;
+    textured = obj.Textured;
+}
@@ -0,0 +1,19 @@
+/***************************
+ * File: vshader_overlay.glsl:
+ *   Flat-colored 2D quads in window pixels (profiler overlay)
+ ****************************/
+
+#version 330
+
+layout(location = 0) in vec2 vPosition;  // Pixels from the top left corner
+layout(location = 1) in vec4 vColor;
+
+uniform vec2 ViewportSize;  // Pixels
+
+out vec4 color;
+
+void main()
+{
+    gl_Position = vec4(vPosition.x / ViewportSize.x * 2.0 - 1.0, 1.0 - vPosition.y / ViewportSize.y * 2.0, 0.0, 1.0);
+    color = vColor;
+}
@@ -0,0 +1,19 @@
+/***************************
+ * File: vshader_proxy.glsl:
+ *   Occlusion proxies (occlusion.h): the box around a body's bounding
+ *   sphere as a 14-vertex triangle strip made from gl_VertexID, so no
+ *   vertex buffer is needed
+ ****************************/
+
+#version 330
+
+#include "lighting.glsl"
+
+uniform vec4 Sphere;  // Camera-relative center and radius, scene axes
+
+void main()
+{
+    int b = 1 << gl_VertexID;
+    vec3 corner = vec3((0x287a & b) != 0, (0x02af & b) != 0, (0x31e3 & b) != 0);
+    gl_Position = projection * view * vec4(Sphere.xyz + (corner * 2.0 - 1.0) * Sphere.w, 1.0);
+}
@@ -0,0 +1,40 @@
+/***************************
+ * File: vshader_rings.glsl:
+ *   Ring particles (rings.h) as point sprites: each vertex is a
+ *   radius/phase pair, moved along its circular Keplerian orbit from
+ *   the simulation time
+ ****************************/
+
+#version 330
+
+layout(location = 0) in vec2 vParticle;  // ATTRIB_POSITION: radius across the rings (0..1), starting phase (turns)
+
+#include "lighting.glsl"
+
+uniform mat4 ModelView;     // Ring plane (x, z) to eye; scaled by the planet's displayed radius
+uniform float InnerRadius;  // Planet radii
+uniform float RadiusSpan;
+uniform float MeanMotion;   // Radians per year one planet radius out; falls off as r^-1.5
+uniform float Time;         // Years since J2000
+uniform float Coverage;     // Pixels of full coverage each drawn particle stands for
+uniform vec4 RingColor;
+
+out vec4 color;
+
+void main()
+{
+    float r = InnerRadius + vParticle.x * RadiusSpan;
+    // Counterclockwise seen from the spin pole (+y); mod keeps sin/cos within their accurate range
+    float theta = 6.2831853 * vParticle.y + mod(MeanMotion * pow(r, -1.5) * Time, 6.2831853);
+    vec4 pos = ModelView * vec4(r * cos(theta), 0.0, -r * sin(theta), 1.0);
+    gl_Position = projection * pos;
+
+    // Coverage beyond one pixel grows the sprite instead of saturating its alpha
+    gl_PointSize = max(1.0, sqrt(Coverage));
+    float alpha = min(Coverage / (gl_PointSize * gl_PointSize), 1.0);
+
+    // A thin sheet lit from either side: brighter the more squarely the Sun faces it
+    vec3 N = normalize(mat3(ModelView) * vec3(0.0, 1.0, 0.0));
+    vec3 L = normalize(LightPosition.xyz - pos.xyz);
+    color = vec4(RingColor.rgb * (0.3 + 0.7 * abs(dot(N, L))), alpha);
+}
@@ -0,0 +1,26 @@
+/***************************
+ * File: vshader_shadow.glsl:
+ *   Shadow pass (shadow.h): one instance of the sphere mesh per caster,
+ *   placed relative to the light; gshader_shadow.glsl projects it
+ ****************************/
+
+#version 330
+
+#define MAX_CASTERS 256  // MAX_SHADOW_CASTERS in uniforms.h
+
+layout(location = 0) in vec4 vPosition;  // ATTRIB_POSITION in mesh.h
+
+layout(std140) uniform Casters {  // One batch of casters; mirrors CasterUniforms in uniforms.h
+    vec4 Sphere[MAX_CASTERS];       // Light-relative center and radius
+    ivec4 Mask[MAX_CASTERS / 4];    // Faces each caster is drawn into, four casters per ivec4
+};
+
+out vec3 lightToVertex;
+flat out int faceMask;
+
+void main()
+{
+    vec4 s = Sphere[gl_InstanceID];
+    lightToVertex = s.xyz + s.w * vPosition.xyz;
+    faceMask = Mask[gl_InstanceID / 4][gl_InstanceID % 4];
+}
@@ -0,0 +1,44 @@
+/***************************
+ * File: vshader_stars.glsl:
+ *   Background stars (starfield.h) as point sprites at infinite
+ *   distance, decoded straight from the 8-byte catalog records
+ ****************************/
+
+#version 330
+
+layout(location = 0) in vec2 vDirection;  // Octahedral, 0..1 (normalized unsigned shorts)
+layout(location = 1) in vec2 vMagColor;   // Magnitude and B-V, thousandths
+
+#include "lighting.glsl"
+
+uniform float Limit;    // Faintest magnitude drawn
+uniform float MaxSize;  // Pixels across the brightest sprites may grow to
+
+out vec4 color;
+
+// Blue-white to red along B-V
+vec3 starColor(float bv)
+{
+    const vec3 blue = vec3(0.62, 0.71, 1.0), white = vec3(0.95, 0.96, 1.0), yellow = vec3(1.0, 0.93, 0.80);
+    const vec3 orange = vec3(1.0, 0.80, 0.60), red = vec3(1.0, 0.64, 0.42);
+    if (bv < 0.0) return mix(blue, white, clamp((bv + 0.4) / 0.4, 0.0, 1.0));
+    if (bv < 0.6) return mix(white, yellow, bv / 0.6);
+    if (bv < 1.2) return mix(yellow, orange, (bv - 0.6) / 0.6);
+    return mix(orange, red, clamp((bv - 1.2) / 0.8, 0.0, 1.0));
+}
+
+void main()
+{
+    vec2 e = vDirection * 2.0 - 1.0;
+    vec3 dir = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (dir.z < 0.0) dir.xy = (1.0 - abs(dir.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    // A direction (w = 0) is where the camera can never reach; z = w puts it on the far plane
+    vec4 clip = projection * vec4(mat3(view) * normalize(dir), 0.0);
+    gl_Position = clip.xyww;
+
+    // A star at the limit is faint; each magnitude brighter is 2.512 times the light, which first fills the pixel and
+    // then grows the sprite
+    float coverage = 0.15 * pow(10.0, 0.4 * (Limit - vMagColor.x * 0.001));
+    gl_PointSize = clamp(sqrt(coverage), 1.0, MaxSize);
+    color = vec4(starColor(vMagColor.y * 0.001), min(coverage / (gl_PointSize * gl_PointSize), 1.0));
+}
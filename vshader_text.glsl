@@ -0,0 +1,32 @@
+/***************************
+ * File: vshader_text.glsl:
+ *   Screen text (text.h): one quad per glyph instance, made from
+ *   gl_VertexID and covering the glyph's atlas cell at Scale pixels
+ *   per font pixel
+ ****************************/
+
+#version 330
+
+layout(location = 0) in vec2 iCorner;  // Top left corner, in pixels from the top left of the window
+layout(location = 1) in uint iCode;    // Glyph in the atlas
+layout(location = 2) in vec4 iColor;
+
+uniform vec2 ViewportSize;  // Pixels
+uniform int Scale;
+uniform int AtlasColumns;
+
+out vec2 cellCoord;          // In font pixels from the cell's top left
+flat out ivec2 cellOrigin;   // Atlas texel of the cell's top left
+flat out vec4 color;
+
+const vec2 CELL = vec2(6.0, 8.0);  // TextRenderer::CELL_WIDTH, CELL_HEIGHT
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    cellCoord = corner * CELL;
+    cellOrigin = ivec2(int(iCode) % AtlasColumns, int(iCode) / AtlasColumns) * ivec2(CELL);
+    color = iColor;
+    vec2 p = iCorner + cellCoord * float(Scale);
+    gl_Position = vec4(p.x / ViewportSize.x * 2.0 - 1.0, 1.0 - p.y / ViewportSize.y * 2.0, 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+/***************************
+ * File: vshader_trails.glsl:
+ *   Orbit trails (trails.h): the slot and age of each vertex come from
+ *   gl_VertexID, the position from the ring of rows in Samples,
+ *   made relative to the camera by its row's offset
+ ****************************/
+
+#version 330
+
+#include "lighting.glsl"
+
+uniform samplerBuffer Samples;  // TRAIL_TEXTURE_UNIT: Length rows of Slots positions, a row of colors, then
+                                // Length offsets taking each row's positions to the current camera
+uniform int Slots;
+uniform int Length;
+uniform int Head;               // Row appended last
+
+out vec4 color;
+
+void main()
+{
+    int slot = gl_VertexID / Length;
+    int age = Length - 1 - gl_VertexID % Length;  // Rows back from Head; 0 is this frame's
+    int row = (Head - age + Length) % Length;
+    vec3 pos = texelFetch(Samples, row * Slots + slot).xyz + texelFetch(Samples, (Length + 1) * Slots + row).xyz;
+    gl_Position = projection * view * vec4(pos, 1.0);
+    color = texelFetch(Samples, Length * Slots + slot);
+    color.a = 1.0 - float(age) / float(Length);
+}
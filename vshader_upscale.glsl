@@ -0,0 +1,18 @@
+/***************************
+ * File: vshader_upscale.glsl:
+ *   Dynamic resolution (resolution.h): one triangle covering the
+ *   window, made from gl_VertexID
+ ****************************/
+
+#version 330
+
+uniform vec2 Region;  // Part of the scene texture drawn this frame
+
+out vec2 texCoord;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0;  // (0,0), (2,0), (0,2)
+    texCoord = corner * Region;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}